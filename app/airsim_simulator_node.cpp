@@ -26,7 +26,12 @@ int main(int argc, char** argv) {
   ros::NodeHandle nh_private("~");
   signal(SIGINT, sigintHandler);
   the_simulator =
-      std::make_unique<unreal_airsim::AirsimSimulator>(nh, nh_private);
+      unreal_airsim::AirsimSimulator::createFromRos(nh, nh_private);
+  if (!the_simulator) {
+    LOG(ERROR) << "Failed to set up the simulator, shutting down.";
+    ros::shutdown();
+    return 1;
+  }
 
   int n_threads;
   nh_private.param("n_threads", n_threads,
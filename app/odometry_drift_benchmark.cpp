@@ -0,0 +1,117 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <minkindr_conversions/kindr_msg.h>
+
+#include "unreal_airsim/simulator_processing/odometry_drift_simulator/odometry_drift_simulator.h"
+
+/***
+ * Microbenchmark of the conversion of ground truth sensor poses to drifted
+ * sensor poses, as done by the sensor timers for every frame. Compares the
+ * msg based conversion to the typed batched one. Both produce the ground
+ * truth and drifted TransformStamped msgs of every sensor, as required for
+ * publishing. Does not require a ROS master.
+ */
+
+DEFINE_int32(num_frames, 100000, "Number of frames to convert.");
+DEFINE_int32(num_sensors, 4, "Number of sensors per frame.");
+DEFINE_int32(num_ticks, 500, "Number of drift simulator ticks (at 100Hz).");
+
+using unreal_airsim::OdometryDriftSimulator;
+using Transformation = OdometryDriftSimulator::Transformation;
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  google::ParseCommandLineFlags(&argc, &argv, false);
+
+  // Setup a drift simulator with some noise and a filled history.
+  OdometryDriftSimulator::Config config;
+  for (auto& kv : config.velocity_noise) {
+    kv.second.stddev = 0.05;
+  }
+  for (auto& kv : config.pose_noise) {
+    kv.second.stddev = 0.01;
+  }
+  OdometryDriftSimulator drift_simulator(config);
+  drift_simulator.setFrameNames("odom", "airsim_drone");
+  for (int i = 1; i <= FLAGS_num_ticks; ++i) {
+    Transformation::Vector6 pose;
+    pose << 0.01 * i, 0.02 * i, 1.0, 0.0, 0.0, 0.001 * i;
+    drift_simulator.tick(Transformation::exp(pose), ros::Time(0.01 * i));
+  }
+  const double t_end = 0.01 * FLAGS_num_ticks;
+
+  // Sensor poses to convert.
+  OdometryDriftSimulator::TransformationVector sensor_poses;
+  for (int i = 0; i < FLAGS_num_sensors; ++i) {
+    Transformation::Vector6 pose;
+    pose << 1.0 + i, 2.0, 1.5, 0.1 * i, 0.2, 0.3;
+    sensor_poses.push_back(Transformation::exp(pose));
+  }
+  std::vector<std::string> frame_names;
+  for (int i = 0; i < FLAGS_num_sensors; ++i) {
+    frame_names.push_back("sensor_" + std::to_string(i));
+  }
+
+  // Msg based: build the ground truth msg, convert via msg per sensor.
+  double checksum_msg = 0.0;
+  auto start = std::chrono::steady_clock::now();
+  for (int f = 0; f < FLAGS_num_frames; ++f) {
+    const ros::Time stamp(t_end - 1.0 + (f % 100) * 0.0101);
+    for (int i = 0; i < FLAGS_num_sensors; ++i) {
+      geometry_msgs::TransformStamped ground_truth_msg;
+      ground_truth_msg.header.stamp = stamp;
+      ground_truth_msg.header.frame_id = "odom";
+      ground_truth_msg.child_frame_id = frame_names[i] + "_ground_truth";
+      tf::transformKindrToMsg(sensor_poses[i], &ground_truth_msg.transform);
+      geometry_msgs::TransformStamped simulated_msg =
+          drift_simulator.convertGroundTruthToDriftedPoseMsg(ground_truth_msg);
+      simulated_msg.child_frame_id = frame_names[i];
+      checksum_msg += simulated_msg.transform.translation.x;
+    }
+  }
+  const double time_msg =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+
+  // Typed: batched conversion, msgs are only created for publishing.
+  double checksum_typed = 0.0;
+  OdometryDriftSimulator::TransformationVector simulated_poses;
+  start = std::chrono::steady_clock::now();
+  for (int f = 0; f < FLAGS_num_frames; ++f) {
+    const ros::Time stamp(t_end - 1.0 + (f % 100) * 0.0101);
+    drift_simulator.convertGroundTruthToDriftedPoses(sensor_poses, stamp,
+                                                     &simulated_poses);
+    for (int i = 0; i < FLAGS_num_sensors; ++i) {
+      geometry_msgs::TransformStamped msg;
+      msg.header.stamp = stamp;
+      msg.header.frame_id = "odom";
+      msg.child_frame_id = frame_names[i] + "_ground_truth";
+      tf::transformKindrToMsg(sensor_poses[i], &msg.transform);
+      msg.child_frame_id = frame_names[i];
+      tf::transformKindrToMsg(simulated_poses[i], &msg.transform);
+      checksum_typed += msg.transform.translation.x;
+    }
+  }
+  const double time_typed =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+
+  const double num_conversions =
+      static_cast<double>(FLAGS_num_frames) * FLAGS_num_sensors;
+  std::cout << "Converted " << FLAGS_num_frames << " frames of "
+            << FLAGS_num_sensors << " sensors.\n"
+            << "  msg based: " << time_msg / num_conversions * 1e9
+            << " ns/sensor\n"
+            << "  typed:     " << time_typed / num_conversions * 1e9
+            << " ns/sensor (" << time_msg / time_typed << "x)\n"
+            << "  mean deviation: "
+            << std::abs(checksum_msg - checksum_typed) / num_conversions
+            << " m" << std::endl;
+  return 0;
+}
@@ -0,0 +1,393 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "3rd_party/csv.h"
+#include "unreal_airsim/simulator_processing/odometry_drift_simulator/odometry_drift_simulator.h"
+
+/***
+ * Offline Monte-Carlo evaluation of the OdometryDriftSimulator. Replays a
+ * recorded ground truth trajectory through many drift realizations with
+ * independent random streams in parallel and writes the statistics of the
+ * drift vs. the distance travelled and the ATE/RPE distributions as csv.
+ * Multiple noise configurations can be evaluated at once by separating them
+ * with ';'.
+ * Does not require a ROS master.
+ *
+ * The trajectory is read from a csv file with the header
+ * 'timestamp,x,y,z,qx,qy,qz,qw', stamps in seconds, poses in the simulator
+ * frame (e.g. recorded from the ground truth pose topic).
+ */
+
+DEFINE_string(trajectory, "", "Ground truth trajectory csv file.");
+DEFINE_string(output_directory, ".", "Directory to write the results to.");
+DEFINE_string(velocity_noise_stddev, "0.01,0.01,0.01,0.001",
+              "Stddevs of the velocity noise x,y,z [m/s],yaw [rad/s]. "
+              "Separate multiple configurations by ';'.");
+DEFINE_string(position_noise_stddev, "0,0,0,0,0,0",
+              "Stddevs of the pose noise x,y,z [m],yaw,pitch,roll [rad]. "
+              "Separate multiple configurations by ';'.");
+DEFINE_string(velocity_noise_type, "piecewise_constant",
+              "Velocity noise model of all axes, one of piecewise_constant, "
+              "gauss_markov, random_walk.");
+DEFINE_double(velocity_noise_frequency_hz, 1.0,
+              "Rate at which piecewise_constant velocity noise is resampled.");
+DEFINE_double(velocity_noise_correlation_time, 1.0,
+              "Correlation time of gauss_markov velocity noise [s].");
+DEFINE_int32(num_realizations, 1000, "Realizations per configuration.");
+DEFINE_int32(num_threads, 0, "Worker threads, 0 uses all cores.");
+DEFINE_int32(seed, 0, "Non-negative base seed, realization i uses the i-th "
+                      "independent stream (RandomEngine::jump()) of it.");
+DEFINE_double(distance_bin_size, 1.0,
+              "Bin size of the drift vs. distance statistics [m].");
+DEFINE_double(rpe_distance, 5.0,
+              "Distance travelled between the poses of the RPE [m].");
+
+using unreal_airsim::BiasNoiseModel;
+using unreal_airsim::OdometryDriftSimulator;
+using Transformation = OdometryDriftSimulator::Transformation;
+
+namespace {
+
+struct Trajectory {
+  std::vector<ros::Time> stamps;
+  OdometryDriftSimulator::TransformationVector poses;
+  std::vector<double> distances;  // travelled up to each pose
+};
+
+struct RealizationResult {
+  int seed = 0;
+  std::vector<double> bin_position_error;  // m, NaN if the bin is empty
+  std::vector<double> bin_yaw_error;       // rad
+  double ate = 0.0;                        // RMSE m
+  double rpe_translation = 0.0;            // RMSE m
+  double rpe_rotation = 0.0;               // RMSE rad
+};
+
+bool readTrajectory(const std::string& file_name, Trajectory* trajectory) {
+  io::CSVReader<8> in(file_name);
+  in.read_header(io::ignore_extra_column, "timestamp", "x", "y", "z", "qx",
+                 "qy", "qz", "qw");
+  double t, x, y, z, qx, qy, qz, qw;
+  while (in.read_row(t, x, y, z, qx, qy, qz, qw)) {
+    Eigen::Quaterniond rotation(qw, qx, qy, qz);
+    rotation.normalize();
+    const Transformation pose(Transformation::Rotation(rotation),
+                              Transformation::Position(x, y, z));
+    double distance = 0.0;
+    if (!trajectory->poses.empty()) {
+      if (t <= trajectory->stamps.back().toSec()) {
+        LOG(WARNING) << "Skipping non-increasing stamp " << t << ".";
+        continue;
+      }
+      distance = trajectory->distances.back() +
+                 (pose.getPosition() - trajectory->poses.back().getPosition())
+                     .norm();
+    }
+    trajectory->stamps.emplace_back(t);
+    trajectory->poses.push_back(pose);
+    trajectory->distances.push_back(distance);
+  }
+  return trajectory->poses.size() >= 2;
+}
+
+bool parseStddevs(const std::string& list, size_t size,
+                  std::vector<std::vector<double>>* configs) {
+  std::stringstream configs_stream(list);
+  std::string config;
+  while (std::getline(configs_stream, config, ';')) {
+    std::vector<double> values;
+    std::stringstream values_stream(config);
+    std::string value;
+    while (std::getline(values_stream, value, ',')) {
+      values.push_back(std::stod(value));
+    }
+    if (values.size() != size) {
+      LOG(ERROR) << "Expected " << size << " stddevs but got '" << config
+                 << "'.";
+      return false;
+    }
+    configs->push_back(values);
+  }
+  return !configs->empty();
+}
+
+double yawOf(const Transformation& pose) {
+  const Eigen::Quaterniond& q = pose.getEigenQuaternion();
+  return std::atan2(2.0 * (q.w() * q.z() + q.x() * q.y()),
+                    1.0 - 2.0 * (q.y() * q.y() + q.z() * q.z()));
+}
+
+double wrapAngle(double angle) {
+  return std::atan2(std::sin(angle), std::cos(angle));
+}
+
+RealizationResult runRealization(const OdometryDriftSimulator::Config& config,
+                                 const Trajectory& trajectory,
+                                 const std::vector<size_t>& rpe_partners,
+                                 size_t num_bins) {
+  RealizationResult result;
+  result.seed = config.seed;
+  OdometryDriftSimulator drift_simulator(config);
+  OdometryDriftSimulator::TransformationVector simulated_poses;
+  simulated_poses.reserve(trajectory.poses.size());
+  for (size_t i = 0; i < trajectory.poses.size(); ++i) {
+    drift_simulator.tick(trajectory.poses[i], trajectory.stamps[i]);
+    simulated_poses.push_back(drift_simulator.getSimulatedPose());
+  }
+
+  // Drift vs. distance and ATE. The drift simulator starts without drift,
+  // so the trajectories are aligned by construction.
+  std::vector<double> position_sum(num_bins, 0.0);
+  std::vector<double> yaw_sum(num_bins, 0.0);
+  std::vector<int> count(num_bins, 0);
+  double squared_error_sum = 0.0;
+  for (size_t i = 0; i < trajectory.poses.size(); ++i) {
+    const double position_error = (simulated_poses[i].getPosition() -
+                                   trajectory.poses[i].getPosition())
+                                      .norm();
+    const double yaw_error = std::abs(
+        wrapAngle(yawOf(simulated_poses[i]) - yawOf(trajectory.poses[i])));
+    const size_t bin = std::min(
+        num_bins - 1, static_cast<size_t>(trajectory.distances[i] /
+                                          FLAGS_distance_bin_size));
+    position_sum[bin] += position_error;
+    yaw_sum[bin] += yaw_error;
+    count[bin]++;
+    squared_error_sum += position_error * position_error;
+  }
+  result.ate = std::sqrt(squared_error_sum / trajectory.poses.size());
+  result.bin_position_error.resize(num_bins);
+  result.bin_yaw_error.resize(num_bins);
+  for (size_t bin = 0; bin < num_bins; ++bin) {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    result.bin_position_error[bin] =
+        count[bin] > 0 ? position_sum[bin] / count[bin] : nan;
+    result.bin_yaw_error[bin] =
+        count[bin] > 0 ? yaw_sum[bin] / count[bin] : nan;
+  }
+
+  // RPE over the pose pairs that are rpe_distance apart.
+  double translation_sum = 0.0;
+  double rotation_sum = 0.0;
+  size_t num_pairs = 0;
+  for (size_t i = 0; i < rpe_partners.size(); ++i) {
+    const size_t j = rpe_partners[i];
+    const Transformation delta_ground_truth =
+        trajectory.poses[i].inverse() * trajectory.poses[j];
+    const Transformation delta_simulated =
+        simulated_poses[i].inverse() * simulated_poses[j];
+    const Transformation error =
+        delta_ground_truth.inverse() * delta_simulated;
+    translation_sum += error.getPosition().squaredNorm();
+    const double angle = Eigen::AngleAxisd(error.getEigenQuaternion()).angle();
+    rotation_sum += angle * angle;
+    num_pairs++;
+  }
+  if (num_pairs > 0) {
+    result.rpe_translation = std::sqrt(translation_sum / num_pairs);
+    result.rpe_rotation = std::sqrt(rotation_sum / num_pairs);
+  }
+  return result;
+}
+
+// Mean, stddev, median and 95th percentile of the finite values.
+std::vector<double> computeStatistics(std::vector<double> values) {
+  values.erase(std::remove_if(values.begin(), values.end(),
+                              [](double v) { return !std::isfinite(v); }),
+               values.end());
+  if (values.empty()) {
+    return {0.0, 0.0, 0.0, 0.0};
+  }
+  double sum = 0.0;
+  double squared_sum = 0.0;
+  for (double v : values) {
+    sum += v;
+    squared_sum += v * v;
+  }
+  const double mean = sum / values.size();
+  const double stddev =
+      std::sqrt(std::max(0.0, squared_sum / values.size() - mean * mean));
+  auto percentile = [&values](double p) {
+    auto it = values.begin() + static_cast<size_t>(p * (values.size() - 1));
+    std::nth_element(values.begin(), it, values.end());
+    return *it;
+  };
+  return {mean, stddev, percentile(0.5), percentile(0.95)};
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  google::ParseCommandLineFlags(&argc, &argv, false);
+  google::InstallFailureSignalHandler();
+  FLAGS_alsologtostderr = true;
+
+  // Inputs
+  Trajectory trajectory;
+  if (FLAGS_trajectory.empty() || !readTrajectory(FLAGS_trajectory,
+                                                  &trajectory)) {
+    LOG(ERROR) << "Could not read a trajectory of at least 2 poses from '"
+               << FLAGS_trajectory << "'.";
+    return 1;
+  }
+  std::vector<std::vector<double>> velocity_stddevs, position_stddevs;
+  if (!parseStddevs(FLAGS_velocity_noise_stddev, 4, &velocity_stddevs) ||
+      !parseStddevs(FLAGS_position_noise_stddev, 6, &position_stddevs)) {
+    return 1;
+  }
+  if (position_stddevs.size() == 1) {
+    position_stddevs.resize(velocity_stddevs.size(), position_stddevs[0]);
+  } else if (velocity_stddevs.size() == 1) {
+    velocity_stddevs.resize(position_stddevs.size(), velocity_stddevs[0]);
+  }
+  if (velocity_stddevs.size() != position_stddevs.size()) {
+    LOG(ERROR) << "The number of velocity and position noise configurations "
+                  "does not match.";
+    return 1;
+  }
+  if (FLAGS_seed < 0) {
+    LOG(ERROR) << "The seed must be non-negative.";
+    return 1;
+  }
+  if (FLAGS_num_realizations <= 0 || FLAGS_distance_bin_size <= 0.0) {
+    LOG(ERROR) << "num_realizations and distance_bin_size must be positive.";
+    return 1;
+  }
+  const size_t num_configs = velocity_stddevs.size();
+  const size_t num_realizations = FLAGS_num_realizations;
+  const size_t num_bins =
+      static_cast<size_t>(trajectory.distances.back() /
+                          FLAGS_distance_bin_size) +
+      1;
+
+  // The pose pairs for the RPE, shared by all realizations.
+  std::vector<size_t> rpe_partners;
+  for (size_t i = 0, j = 0; i < trajectory.poses.size(); ++i) {
+    j = std::max(j, i);
+    while (j < trajectory.poses.size() &&
+           trajectory.distances[j] - trajectory.distances[i] <
+               FLAGS_rpe_distance) {
+      j++;
+    }
+    if (j == trajectory.poses.size()) {
+      break;
+    }
+    rpe_partners.push_back(j);
+  }
+
+  std::vector<OdometryDriftSimulator::Config> configs(num_configs);
+  for (size_t c = 0; c < num_configs; ++c) {
+    OdometryDriftSimulator::Config& config = configs[c];
+    config.velocity_noise_frequency_hz = FLAGS_velocity_noise_frequency_hz;
+    config.history_size = 1;  // Poses are only converted at the ticks.
+    const char* velocity_axes[] = {"x", "y", "z", "yaw"};
+    for (int i = 0; i < 4; ++i) {
+      BiasNoiseModel::Config& axis = config.velocity_noise[velocity_axes[i]];
+      axis.type = FLAGS_velocity_noise_type;
+      axis.stddev = velocity_stddevs[c][i];
+      axis.correlation_time = FLAGS_velocity_noise_correlation_time;
+    }
+    const char* pose_axes[] = {"x", "y", "z", "yaw", "pitch", "roll"};
+    for (int i = 0; i < 6; ++i) {
+      config.pose_noise[pose_axes[i]].stddev = position_stddevs[c][i];
+    }
+    if (!config.isValid()) {
+      LOG(ERROR) << "Noise configuration " << c << " is invalid.";
+      return 1;
+    }
+  }
+
+  // Run all realizations in parallel.
+  const size_t num_jobs = num_configs * num_realizations;
+  std::vector<RealizationResult> results(num_jobs);
+  std::atomic<size_t> next_job(0);
+  int num_threads = FLAGS_num_threads > 0
+                        ? FLAGS_num_threads
+                        : std::max(1u, std::thread::hardware_concurrency());
+  LOG(INFO) << "Running " << num_realizations << " realizations of "
+            << num_configs << " configuration(s) over "
+            << trajectory.poses.size() << " poses ("
+            << trajectory.distances.back() << "m) on " << num_threads
+            << " threads.";
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&]() {
+      size_t job;
+      while ((job = next_job.fetch_add(1)) < num_jobs) {
+        OdometryDriftSimulator::Config config = configs[job / num_realizations];
+        config.seed = FLAGS_seed;
+        config.stream = static_cast<int>(job % num_realizations);
+        results[job] =
+            runRealization(config, trajectory, rpe_partners, num_bins);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  LOG(INFO) << "Finished in "
+            << std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                             start)
+                   .count()
+            << "s.";
+
+  // Write the results.
+  std::ofstream drift_file(FLAGS_output_directory + "/drift_vs_distance.csv");
+  std::ofstream error_file(FLAGS_output_directory + "/ate_rpe.csv");
+  if (!drift_file.is_open() || !error_file.is_open()) {
+    LOG(ERROR) << "Could not write to '" << FLAGS_output_directory << "'.";
+    return 1;
+  }
+  drift_file << "config,distance,position_mean,position_stddev,"
+                "position_median,position_p95,yaw_mean,yaw_stddev,yaw_median,"
+                "yaw_p95\n";
+  error_file << "config,realization,seed,ate,rpe_translation,rpe_rotation\n";
+  for (size_t c = 0; c < num_configs; ++c) {
+    const RealizationResult* config_results = &results[c * num_realizations];
+    for (size_t bin = 0; bin < num_bins; ++bin) {
+      std::vector<double> position_errors, yaw_errors;
+      for (size_t r = 0; r < num_realizations; ++r) {
+        position_errors.push_back(config_results[r].bin_position_error[bin]);
+        yaw_errors.push_back(config_results[r].bin_yaw_error[bin]);
+      }
+      drift_file << c << "," << (bin + 0.5) * FLAGS_distance_bin_size;
+      for (double v : computeStatistics(position_errors)) {
+        drift_file << "," << v;
+      }
+      for (double v : computeStatistics(yaw_errors)) {
+        drift_file << "," << v;
+      }
+      drift_file << "\n";
+    }
+    std::vector<double> ates, rpes;
+    for (size_t r = 0; r < num_realizations; ++r) {
+      error_file << c << "," << r << "," << config_results[r].seed << ","
+                 << config_results[r].ate << ","
+                 << config_results[r].rpe_translation << ","
+                 << config_results[r].rpe_rotation << "\n";
+      ates.push_back(config_results[r].ate);
+      rpes.push_back(config_results[r].rpe_translation);
+    }
+    const std::vector<double> ate = computeStatistics(ates);
+    const std::vector<double> rpe = computeStatistics(rpes);
+    LOG(INFO) << "Config " << c << ": ATE mean " << ate[0] << "m (p95 "
+              << ate[3] << "m), RPE/" << FLAGS_rpe_distance << "m mean "
+              << rpe[0] << "m (p95 " << rpe[3] << "m).";
+  }
+  LOG(INFO) << "Wrote results to '" << FLAGS_output_directory << "'.";
+  return 0;
+}
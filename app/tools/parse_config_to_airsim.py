@@ -80,11 +80,12 @@ class ConfigParser(object):
         self.read_source_config()
         self.setup_target_file()
         self.forward_args(self.yaml_cfg, self.new_cfg, self.np_general)
-        sensor_dict, camera_dict = self.parse_sensors()
-        vehicle, vehicle_name = self.parse_vehicle()
-        vehicle["Cameras"] = camera_dict
-        vehicle["Sensors"] = sensor_dict
-        self.new_cfg["Vehicles"] = {vehicle_name: vehicle}
+        self.new_cfg["Vehicles"] = {}
+        for vehicle_name, vehicle in self.parse_vehicles():
+            sensor_dict, camera_dict = self.parse_sensors(vehicle_name)
+            vehicle["Cameras"] = camera_dict
+            vehicle["Sensors"] = sensor_dict
+            self.new_cfg["Vehicles"][vehicle_name] = vehicle
         self.write_target_file()
         info = "* Settings parsing finished successfully (%i Warnings, " \
                "%i Errors)! *" % (self.log_counter[1], self.log_counter[2])
@@ -92,29 +93,74 @@ class ConfigParser(object):
         self.log("This process will now terminate. This is intended behavior.")
 
     def write_target_file(self):
-        j = json.dumps(self.new_cfg, indent=2)
-        f = open(self.target_file_path, 'w')
+        ports = self.parse_server_ports()
+        if ports:
+            self.new_cfg["ApiServerPort"] = ports[0]
+        self.write_json(self.new_cfg, self.target_file_path)
+
+        # Additional servers use identical settings except for their port. Use
+        # them via the '-settings=<path>' command line argument of UE4.
+        root, ext = os.path.splitext(self.target_file_path)
+        for port in ports[1:]:
+            cfg = dict(self.new_cfg)
+            cfg["ApiServerPort"] = port
+            self.write_json(cfg, "%s_%i%s" % (root, port, ext))
+
+    def write_json(self, cfg, path):
+        j = json.dumps(cfg, indent=2)
+        f = open(path, 'w')
         print(j, end="", file=f)
         f.close()
-        self.log("Wrote config to target file '%s'." % self.target_file_path)
+        self.log("Wrote config to target file '%s'." % path)
 
-    def parse_vehicle(self):
-        """ Read settings for a (the) vehicle """
+    def parse_server_ports(self):
+        """ Read the ports of all 'airsim_servers', given as 'ip:port' """
+        ports = []
+        if "airsim_servers" not in self.yaml_cfg:
+            return ports
+        for address in self.yaml_cfg["airsim_servers"]:
+            try:
+                ports.append(int(str(address).rsplit(":", 1)[1]))
+            except (IndexError, ValueError):
+                self.log(
+                    "Airsim server '%s' expected as 'ip:port', it will be "
+                    "ignored!" % address, 1)
+        return ports
+
+    def parse_vehicles(self):
+        """ Read settings for all vehicles, as list of (name, settings) """
         # TODO(schmluk): maybe pass on other vehicle settings as well here
-        vehicle = {"VehicleType": "SimpleFlight"}
-        vehicle_name = rospy.get_param("vehicle_name",
-                                       "airsim_drone")  # default
-        self.log("Using vehicle name '%s'." % vehicle_name)
-        return vehicle, vehicle_name
+        if "vehicles" not in self.yaml_cfg:
+            vehicle = {"VehicleType": "SimpleFlight"}
+            vehicle_name = rospy.get_param("vehicle_name",
+                                           "airsim_drone")  # default
+            self.log("Using vehicle name '%s'." % vehicle_name)
+            return [(vehicle_name, vehicle)]
+        result = []
+        # Same order as the simulator, the first vehicle is the default one.
+        for vehicle_name in sorted(self.yaml_cfg["vehicles"]):
+            data = self.yaml_cfg["vehicles"][vehicle_name]
+            if data is None:
+                data = {}
+            vehicle = {"VehicleType": "SimpleFlight"}
+            for key in ["X", "Y", "Z"]:
+                vehicle[key] = data[key] if key in data else 0
+            self.log("Found vehicle '%s' at (%s, %s, %s)." %
+                     (vehicle_name, vehicle["X"], vehicle["Y"], vehicle["Z"]))
+            result.append((vehicle_name, vehicle))
+        return result
 
-    def parse_sensors(self):
-        """ Identify all listed sensors and convert to AirSim settings """
+    def parse_sensors(self, vehicle_name):
+        """ Identify all sensors of a vehicle and convert to AirSim settings """
         sensors = self.yaml_cfg["sensors"]
         sensor_dict = {}
         camera_dict = {}
         for name in sensors:
             data = sensors[name]
             out = {}
+            if "vehicle" in data and data["vehicle"] != vehicle_name:
+                # Sensors without vehicle are mounted on all vehicles.
+                continue
             if not "sensor_type" in data:
                 self.log(
                     "Skipping sensor '%s', no 'sensor_type' given!" % name, 2)
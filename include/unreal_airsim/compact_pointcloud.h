@@ -0,0 +1,67 @@
+#ifndef UNREAL_AIRSIM_COMPACT_POINTCLOUD_H_
+#define UNREAL_AIRSIM_COMPACT_POINTCLOUD_H_
+
+#include <cstddef>
+#include <string>
+
+#include <sensor_msgs/PointCloud2.h>
+
+namespace unreal_airsim {
+
+/***
+ * Compact, quantized point cloud encoding to reduce the bandwidth of point
+ * cloud topics by ~2x. The encoded cloud is a regular PointCloud2 with the
+ * following little endian field layout:
+ *
+ *   offset | name | type  | content
+ *   -------+------+-------+-----------------------------------------------
+ *   0      | x    | INT16 | position in sensor frame, in units of resolution
+ *   2      | y    | INT16 |
+ *   4      | z    | INT16 |
+ *   6      | b    | UINT8 | color (only if the source has an 'rgb' field)
+ *   7      | g    | UINT8 |
+ *   8      | r    | UINT8 |
+ *   6 / 9  | id   | UINT8 | label (only if the source has an 'id' field)
+ *
+ * Wire format of the resolution: PointCloud2 has no slot for metadata, so the
+ * quantization resolution [m] is part of the field list as an additional
+ * UINT8 field with count 0 (i.e. without data) named
+ * 'quantization_resolution=<value>', <value> being a decimal float with
+ * max_digits10 precision. Decoders must identify compact clouds by this field
+ * (see isCompact()), generic consumers skip it as it occupies no bytes of the
+ * point. The default resolution is kDefaultResolution. Positions are
+ * rounded to the nearest multiple of the resolution, the quantization error is
+ * thus bounded by sqrt(3)/2 * resolution. Points beyond +-32767 * resolution on
+ * any axis can not be represented and are dropped.
+ */
+namespace compact_pointcloud {
+
+inline const std::string kResolutionFieldPrefix = "quantization_resolution=";
+constexpr float kDefaultResolution = 0.005f;  // m
+
+struct EncodingStatistics {
+  size_t num_points = 0;    // points in the encoded cloud
+  size_t num_dropped = 0;   // points out of range or invalid
+  float max_error = 0.f;    // largest observed quantization error [m]
+  float error_bound = 0.f;  // theoretical bound on the quantization error [m]
+};
+
+// Encode a cloud with FLOAT32 'x', 'y', 'z' and optional 'rgb' (FLOAT32 or
+// UINT32 packed) and 'id' (UINT8) fields.
+bool encode(const sensor_msgs::PointCloud2& cloud, float resolution,
+            sensor_msgs::PointCloud2* compact,
+            EncodingStatistics* statistics = nullptr);
+
+// Decode a compact cloud to FLOAT32 'x', 'y', 'z' and, if present, FLOAT32
+// 'rgb' and UINT8 'id' fields.
+bool decode(const sensor_msgs::PointCloud2& compact,
+            sensor_msgs::PointCloud2* cloud);
+
+// Whether the cloud uses the compact encoding and its resolution [m].
+bool isCompact(const sensor_msgs::PointCloud2& cloud,
+               float* resolution = nullptr);
+
+}  // namespace compact_pointcloud
+}  // namespace unreal_airsim
+
+#endif  // UNREAL_AIRSIM_COMPACT_POINTCLOUD_H_
@@ -0,0 +1,38 @@
+#ifndef UNREAL_AIRSIM_DEPTH_CAMERA_INTRINSICS_H_
+#define UNREAL_AIRSIM_DEPTH_CAMERA_INTRINSICS_H_
+
+#include <cmath>
+#include <cstdint>
+
+namespace unreal_airsim {
+
+/***
+ * Pinhole intrinsics of a planar depth camera (ImageType::DepthPlanar) with
+ * horizontal fov in degrees, the principal point is the image center.
+ * All back-projections of depth images use this, s.t. they can not drift
+ * apart.
+ */
+struct DepthCameraIntrinsics {
+  float focal_length = 1.f;
+  float vx = 0.f;
+  float vy = 0.f;
+
+  DepthCameraIntrinsics() = default;
+  DepthCameraIntrinsics(uint32_t width, uint32_t height, float fov)
+      : focal_length(static_cast<float>(width) /
+                     (2.0 * std::tan(fov * M_PI / 360.0))),
+        vx(width / 2.0),
+        vy(height / 2.0) {}
+
+  // Camera frame coordinates (x right, y down) of pixel (u, v) at depth z.
+  float backProjectX(int u, float z) const {
+    return (static_cast<float>(u) - vx) * z / focal_length;
+  }
+  float backProjectY(int v, float z) const {
+    return (static_cast<float>(v) - vy) * z / focal_length;
+  }
+};
+
+}  // namespace unreal_airsim
+
+#endif  // UNREAL_AIRSIM_DEPTH_CAMERA_INTRINSICS_H_
@@ -9,6 +9,8 @@
 #include <geometry_msgs/Vector3.h>
 #include <Eigen/Geometry>
 
+#include <cstddef>
+
 namespace unreal_airsim {
 
 /***
@@ -46,6 +48,22 @@ class FrameConverter {
   void rosToAirsim(geometry_msgs::Quaternion* orientation) const;
   void rosToAirsim(geometry_msgs::Pose* pose) const;
 
+  // Batch interfaces for contiguous arrays, e.g. clouds or trajectories. The
+  // axis inversions are folded into the rotation, and the identity and yaw
+  // only setups skip the unused terms. Orientations are normalized silently.
+  void airsimToRos(Eigen::Vector3f* points, size_t num_points) const;
+  void airsimToRos(Eigen::Vector3d* points, size_t num_points) const;
+  void airsimToRos(Eigen::Quaterniond* orientations,
+                   size_t num_orientations) const;
+  void rosToAirsim(Eigen::Vector3f* points, size_t num_points) const;
+  void rosToAirsim(Eigen::Vector3d* points, size_t num_points) const;
+  void rosToAirsim(Eigen::Quaterniond* orientations,
+                   size_t num_orientations) const;
+
+  // Only the axis inversions of interleaved xyz points, for data in airsim
+  // sensor frames (e.g. lidars in 'SensorLocalFrame').
+  static void airsimAxesToRos(float* xyz, size_t num_points);
+
   // transformations
   void transformPointAirsimToRos(double* x, double* y, double* z) const;
   void transformOrientationAirsimToRos(double* w, double* x, double* y,
@@ -57,6 +75,18 @@ class FrameConverter {
  protected:
   Eigen::Matrix3d rotation_;
   Eigen::Matrix3d rot_inverse_;
+
+  // Batch conversions, including the axis inversions.
+  enum class Structure { kAxesOnly, kYawOnly, kGeneral };
+  Structure structure_;
+  Eigen::Matrix3d airsim_to_ros_;
+  Eigen::Matrix3d ros_to_airsim_;
+  Eigen::Matrix3f airsim_to_ros_float_;
+  Eigen::Matrix3f ros_to_airsim_float_;
+  Eigen::Quaterniond rotation_quat_;
+  Eigen::Quaterniond rot_inverse_quat_;
+
+  void updateBatchConversions();
 };
 
 }  // namespace unreal_airsim
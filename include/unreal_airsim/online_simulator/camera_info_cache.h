@@ -0,0 +1,39 @@
+#ifndef UNREAL_AIRSIM_ONLINE_SIMULATOR_CAMERA_INFO_CACHE_H_
+#define UNREAL_AIRSIM_ONLINE_SIMULATOR_CAMERA_INFO_CACHE_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// AirSim
+#include <common/CommonStructs.hpp>
+
+namespace unreal_airsim {
+/***
+ * Stores the camera infos read from UE4 in a text file, s.t. restarts with
+ * identical settings do not need to query every camera again. The infos are
+ * identified by a key, e.g. a hash of the settings, and are only loaded if it
+ * matches.
+ */
+class CameraInfoCache {
+ public:
+  using CameraInfoMap =
+      std::unordered_map<std::string, msr::airlib::CameraInfo>;
+
+  explicit CameraInfoCache(const std::string& file_path);
+
+  // Returns false if the file does not exist, is invalid, or the key differs.
+  bool load(uint64_t key, CameraInfoMap* infos) const;
+
+  // Overwrites the file, returns false if it can not be written.
+  bool save(uint64_t key, const CameraInfoMap& infos) const;
+
+  // 64 bit FNV-1a hash of the settings, stable across builds and platforms.
+  static uint64_t computeKey(const std::string& settings);
+
+ private:
+  const std::string file_path_;
+};
+}  // namespace unreal_airsim
+
+#endif  // UNREAL_AIRSIM_ONLINE_SIMULATOR_CAMERA_INFO_CACHE_H_
@@ -0,0 +1,104 @@
+#ifndef UNREAL_AIRSIM_ONLINE_SIMULATOR_COMMAND_CHANNEL_H_
+#define UNREAL_AIRSIM_ONLINE_SIMULATOR_COMMAND_CHANNEL_H_
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <string>
+
+#include <boost/function.hpp>
+#include <ros/callback_queue.h>
+#include <ros/ros.h>
+#include <std_msgs/Float32.h>
+
+namespace unreal_airsim {
+/***
+ * Serves low latency control commands on a dedicated callback queue and
+ * thread, s.t. they never wait behind the sensor and state callbacks of the
+ * shared spinner. Every subscription only keeps the newest message and
+ * commands that are older than max_command_age when they are served are
+ * dropped. The callbacks issue their RPCs themselves, i.e. on this thread.
+ * The latency from receiving a command until its RPC returned is published on
+ * 'command_latency' (s).
+ */
+class CommandChannel {
+ public:
+  struct Config {
+    double max_command_age = 0.05;  // s
+  };
+
+  struct Statistics {
+    int num_executed = 0;
+    int num_dropped = 0;         // Stale or rejected by the callback
+    double total_latency = 0.0;  // s
+    double max_latency = 0.0;    // s
+  };
+
+  // Callbacks return whether the command was executed.
+  template <typename MsgT>
+  using Callback = std::function<bool(const MsgT&)>;
+
+  CommandChannel(const Config& config, const ros::NodeHandle& nh);
+  virtual ~CommandChannel();
+
+  void start();
+  void stop();
+
+  template <typename MsgT>
+  ros::Subscriber subscribe(const std::string& topic, Callback<MsgT> callback);
+
+  Statistics getAndResetStatistics();
+
+ private:
+  const Config config_;
+  ros::NodeHandle nh_;
+  ros::CallbackQueue queue_;
+  ros::AsyncSpinner spinner_;
+  ros::Publisher latency_pub_;
+
+  std::mutex statistics_mutex_;
+  Statistics statistics_;
+
+  template <typename MsgT>
+  void serve(const ros::MessageEvent<MsgT const>& event,
+             const Callback<MsgT>& callback);
+  void recordExecuted(double latency);
+  void recordDropped();
+};
+
+template <typename MsgT>
+ros::Subscriber CommandChannel::subscribe(const std::string& topic,
+                                          Callback<MsgT> callback) {
+  ros::SubscribeOptions options;
+  options.initByFullCallbackType<const ros::MessageEvent<MsgT const>&>(
+      topic, 1,
+      boost::function<void(const ros::MessageEvent<MsgT const>&)>(
+          [this, callback](const ros::MessageEvent<MsgT const>& event) {
+            serve<MsgT>(event, callback);
+          }));
+  options.callback_queue = &queue_;
+  options.transport_hints = ros::TransportHints().tcpNoDelay();
+  return nh_.subscribe(options);
+}
+
+template <typename MsgT>
+void CommandChannel::serve(const ros::MessageEvent<MsgT const>& event,
+                           const Callback<MsgT>& callback) {
+  const ros::Time receipt_time = event.getReceiptTime();
+  if ((ros::Time::now() - receipt_time).toSec() > config_.max_command_age ||
+      !callback(*event.getConstMessage())) {
+    recordDropped();
+    return;
+  }
+  const double latency =
+      std::max((ros::Time::now() - receipt_time).toSec(), 0.0);
+  recordExecuted(latency);
+  if (latency_pub_.getNumSubscribers() > 0) {
+    std_msgs::Float32 msg;
+    msg.data = latency;
+    latency_pub_.publish(msg);
+  }
+}
+}  // namespace unreal_airsim
+
+#endif  // UNREAL_AIRSIM_ONLINE_SIMULATOR_COMMAND_CHANNEL_H_
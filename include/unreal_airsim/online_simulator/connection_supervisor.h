@@ -0,0 +1,66 @@
+#ifndef UNREAL_AIRSIM_ONLINE_SIMULATOR_CONNECTION_SUPERVISOR_H_
+#define UNREAL_AIRSIM_ONLINE_SIMULATOR_CONNECTION_SUPERVISOR_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace unreal_airsim {
+/***
+ * Watches the connection to the AirSim server on its own thread. Disconnects
+ * are detected by periodically checking all clients or reported by the users
+ * of the clients, e.g. when an RPC throws. The simulation is then paused,
+ * reconnected with exponential backoff and resumed, s.t. a level reload or a
+ * hitch of UE4 does not take down the node and everything downstream of it.
+ */
+class ConnectionSupervisor {
+ public:
+  struct Config {
+    double check_interval = 1.0;   // s
+    double initial_backoff = 0.5;  // s
+    double max_backoff = 10.0;     // s
+  };
+
+  // Provided by the simulator, all are called from the supervisor thread.
+  struct Hooks {
+    std::function<bool()> is_connected;  // Whether all clients are connected.
+    std::function<void()> pause;         // Stop everything using the clients.
+    std::function<bool()> reconnect;     // Recreate and verify all clients.
+    std::function<void()> resume;
+  };
+
+  ConnectionSupervisor(const Config& config, Hooks hooks);
+  virtual ~ConnectionSupervisor();
+
+  void start();
+  void stop();
+
+  // Report a failed RPC, this is thread safe. The connection is verified by
+  // the supervisor, s.t. transient errors do not trigger a reconnect.
+  void reportDisconnect(const std::string& source);
+
+  bool isConnected() const { return is_connected_; }
+  int getNumReconnects() const { return num_reconnects_; }
+
+ private:
+  const Config config_;
+  const Hooks hooks_;
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool is_running_;                // guarded by mutex_
+  bool disconnect_reported_;       // guarded by mutex_
+  std::string reported_source_;    // guarded by mutex_
+  std::atomic<bool> is_connected_;
+  std::atomic<int> num_reconnects_;
+
+  void run();
+  void handleDisconnect(const std::string& source);
+};
+}  // namespace unreal_airsim
+
+#endif  // UNREAL_AIRSIM_ONLINE_SIMULATOR_CONNECTION_SUPERVISOR_H_
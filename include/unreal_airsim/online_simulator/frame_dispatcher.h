@@ -0,0 +1,100 @@
+#ifndef UNREAL_AIRSIM_ONLINE_SIMULATOR_FRAME_DISPATCHER_H_
+#define UNREAL_AIRSIM_ONLINE_SIMULATOR_FRAME_DISPATCHER_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <ros/callback_queue_interface.h>
+#include <ros/ros.h>
+#include <sensor_msgs/Image.h>
+
+namespace unreal_airsim {
+
+/***
+ * Hands images from their in-process producers (sensor timers and simulator
+ * processors) directly to in-process consumers (simulator processors), s.t.
+ * chained processing steps run without ROS serialization and transport in
+ * between. Consumers subscribe to topics through the dispatcher. After setup,
+ * connect() creates regular ROS subscriptions for all topics that are not
+ * produced in this process. Producers call dispatch() instead of publish(),
+ * which queues the frame for the inline consumers and only publishes via ROS
+ * if someone subscribed to the topic. Inline frames are executed on the
+ * callback queue of the consumer's node handle, with the same queue size and
+ * drop-oldest behavior as a ROS subscription.
+ */
+class FrameDispatcher {
+ public:
+  using ImageCallback = std::function<void(const sensor_msgs::ImagePtr&)>;
+
+  FrameDispatcher() = default;
+  virtual ~FrameDispatcher() = default;
+
+  // Setup, these are not thread safe and need to be called before connect().
+  void setInlineProcessing(bool enabled) { inline_processing_ = enabled; }
+  void advertise(const ros::Publisher& publisher);
+  void advertise(const std::string& resolved_topic);
+  void subscribe(const ros::NodeHandle& nh, const std::string& topic,
+                 uint32_t queue_size, const ImageCallback& callback);
+  void connect();
+
+  // Whether the frame published by publisher has any consumers.
+  bool hasSubscribers(const ros::Publisher& publisher) const;
+  bool hasInlineSubscribers(const ros::Publisher& publisher) const;
+  bool hasInlineSubscribers(const std::string& resolved_topic) const;
+
+  // Pass the frame to all inline consumers and publish it if necessary.
+  void dispatch(const ros::Publisher& publisher,
+                const sensor_msgs::ImagePtr& msg) const;
+  // Only pass the frame to the inline consumers, for producers that publish
+  // themselves (e.g. via image_transport).
+  void dispatchInline(const std::string& resolved_topic,
+                      const sensor_msgs::ImagePtr& msg) const;
+
+ private:
+  struct Subscription {
+    ros::NodeHandle nh;
+    std::string topic;  // resolved name
+    uint32_t queue_size;
+    ImageCallback callback;
+    ros::Subscriber subscriber;  // only used if not inline
+  };
+
+  // Pending frames of an inline subscription. Each frame in the queue has
+  // exactly one InlineFrameCallback waiting on the consumer's callback queue.
+  struct InlineSubscription {
+    ImageCallback callback;
+    ros::CallbackQueueInterface* callback_queue;
+    uint32_t queue_size;
+    std::mutex mutex;
+    std::deque<sensor_msgs::ImagePtr> frames;
+  };
+
+  class InlineFrameCallback : public ros::CallbackInterface {
+   public:
+    explicit InlineFrameCallback(
+        std::shared_ptr<InlineSubscription> subscription)
+        : subscription_(std::move(subscription)) {}
+    CallResult call() override;
+
+   private:
+    const std::shared_ptr<InlineSubscription> subscription_;
+  };
+
+  bool inline_processing_ = true;
+  bool is_connected_ = false;
+  std::unordered_set<std::string> produced_topics_;
+  std::vector<Subscription> subscriptions_;
+  std::unordered_map<std::string,
+                     std::vector<std::shared_ptr<InlineSubscription>>>
+      inline_subscriptions_;
+};
+
+}  // namespace unreal_airsim
+
+#endif  // UNREAL_AIRSIM_ONLINE_SIMULATOR_FRAME_DISPATCHER_H_
@@ -0,0 +1,152 @@
+#ifndef UNREAL_AIRSIM_ONLINE_SIMULATOR_MESSAGE_POOL_H_
+#define UNREAL_AIRSIM_ONLINE_SIMULATOR_MESSAGE_POOL_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+namespace unreal_airsim {
+
+struct MessagePoolStatistics {
+  size_t num_hits = 0;       // Served with sufficient capacity
+  size_t num_misses = 0;     // Served with a new buffer
+  size_t current_bytes = 0;  // Data capacity of all messages of the pool
+  size_t peak_bytes = 0;      // Of a single pool, not accumulated
+
+  // Sums the counts and current bytes. The pools peak at different times, so
+  // their peaks do not add up to the peak of the total and are not summed.
+  MessagePoolStatistics& operator+=(const MessagePoolStatistics& other) {
+    num_hits += other.num_hits;
+    num_misses += other.num_misses;
+    current_bytes += other.current_bytes;
+    return *this;
+  }
+};
+
+/***
+ * Recycles messages with large data buffers, e.g. sensor_msgs::Image or
+ * PointCloud2, s.t. producers at high rates do not allocate and page fault
+ * for every frame. Messages are handed out as shared pointers and return to
+ * the pool with their data capacity once the last holder released them, at
+ * most max_pooled are kept. New buffers are pre-faulted. This is thread safe
+ * and the pool may be destroyed before its messages.
+ */
+template <typename MsgT>
+class MessagePool {
+ public:
+  using MsgPtr = boost::shared_ptr<MsgT>;
+
+  explicit MessagePool(size_t max_pooled = 4)
+      : state_(std::make_shared<State>()) {
+    state_->max_pooled = max_pooled;
+  }
+  virtual ~MessagePool() = default;
+
+  // A message with default fields and data of data_size bytes with undefined
+  // content.
+  MsgPtr acquire(size_t data_size);
+
+  // Peak bytes are reset to the current bytes.
+  MessagePoolStatistics getAndResetStatistics();
+
+ private:
+  struct State {
+    std::mutex mutex;
+    size_t max_pooled;
+    std::vector<std::unique_ptr<MsgT>> messages;
+    MessagePoolStatistics statistics;
+
+    void updateBytes(size_t old_capacity, size_t new_capacity) {
+      statistics.current_bytes += new_capacity;
+      statistics.current_bytes -= old_capacity;
+      statistics.peak_bytes =
+          std::max(statistics.peak_bytes, statistics.current_bytes);
+    }
+  };
+  std::shared_ptr<State> state_;
+
+  static void release(const std::weak_ptr<State>& weak_state,
+                      size_t accounted_capacity, MsgT* msg);
+};
+
+template <typename MsgT>
+typename MessagePool<MsgT>::MsgPtr MessagePool<MsgT>::acquire(
+    size_t data_size) {
+  std::unique_ptr<MsgT> msg;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    if (!state_->messages.empty()) {
+      msg = std::move(state_->messages.back());
+      state_->messages.pop_back();
+    }
+  }
+  if (msg) {
+    // Reset all fields but the data.
+    std::vector<uint8_t> data;
+    data.swap(msg->data);
+    *msg = MsgT();
+    msg->data.swap(data);
+  } else {
+    msg = std::make_unique<MsgT>();
+  }
+
+  const size_t old_capacity = msg->data.capacity();
+  const bool is_hit = old_capacity >= data_size;
+  if (!is_hit) {
+    // Resizing a fresh buffer writes, and thus faults, all of its pages.
+    std::vector<uint8_t>().swap(msg->data);
+  }
+  msg->data.resize(data_size);
+  const size_t capacity = msg->data.capacity();
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    if (is_hit) {
+      ++state_->statistics.num_hits;
+    } else {
+      ++state_->statistics.num_misses;
+    }
+    state_->updateBytes(old_capacity, capacity);
+  }
+  std::weak_ptr<State> weak_state = state_;
+  return MsgPtr(msg.release(), [weak_state, capacity](MsgT* released) {
+    release(weak_state, capacity, released);
+  });
+}
+
+template <typename MsgT>
+MessagePoolStatistics MessagePool<MsgT>::getAndResetStatistics() {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  MessagePoolStatistics result = state_->statistics;
+  state_->statistics.num_hits = 0;
+  state_->statistics.num_misses = 0;
+  state_->statistics.peak_bytes = state_->statistics.current_bytes;
+  return result;
+}
+
+template <typename MsgT>
+void MessagePool<MsgT>::release(const std::weak_ptr<State>& weak_state,
+                                size_t accounted_capacity, MsgT* msg) {
+  std::unique_ptr<MsgT> owned(msg);
+  std::shared_ptr<State> state = weak_state.lock();
+  if (!state) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(state->mutex);
+  // Holders may have grown the data.
+  state->updateBytes(accounted_capacity, owned->data.capacity());
+  if (state->messages.size() < state->max_pooled) {
+    state->messages.push_back(std::move(owned));
+  } else {
+    state->updateBytes(owned->data.capacity(), 0);
+  }
+}
+
+}  // namespace unreal_airsim
+
+#endif  // UNREAL_AIRSIM_ONLINE_SIMULATOR_MESSAGE_POOL_H_
@@ -1,15 +1,24 @@
 #ifndef UNREAL_AIRSIM_ONLINE_SIMULATOR_SENSOR_TIMER_H_
 #define UNREAL_AIRSIM_ONLINE_SIMULATOR_SENSOR_TIMER_H_
 
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include <image_transport/image_transport.h>
 #include <ros/ros.h>
+#include <sensor_msgs/CameraInfo.h>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/PointCloud2.h>
 #include <tf2_ros/transform_broadcaster.h>
 
 #include <vehicles/multirotor/api/MultirotorRpcLibClient.hpp>
 
 #include "unreal_airsim/frame_converter.h"
+#include "unreal_airsim/online_simulator/message_pool.h"
+#include "unreal_airsim/shared_memory_image.h"
+#include "unreal_airsim/simulator_processing/odometry_drift_simulator/odometry_drift_simulator.h"
 
 namespace unreal_airsim {
 class AirsimSimulator;
@@ -20,16 +29,38 @@ class AirsimSimulator;
 class SensorTimer {
  public:
   SensorTimer(const ros::NodeHandle& nh, double rate, bool is_private,
-              const std::string& vehicle_name, AirsimSimulator* parent);
+              const std::string& vehicle_name, size_t server_index,
+              size_t client_index, AirsimSimulator* parent);
   virtual ~SensorTimer() = default;
 
   void timerCallback(const ros::TimerEvent&);
+  void trigger();  // Read all sensors now, blocks until published.
 
   double getRate() const;
   bool isPrivate() const;
+  const std::string& getVehicleName() const { return vehicle_name_; }
+  size_t getServerIndex() const { return server_index_; }
   void signalShutdown();
+
+  // Connection handling, see ConnectionSupervisor. The client is only
+  // replaced while the timer is paused.
+  bool isConnected() const;
+  bool reconnect();
+  void pause();
+  void resume();
   void addSensor(const AirsimSimulator& simulator, int sensor_index);
 
+  // Convert an uncompressed airsim image to ROS, the header is not set.
+  static void convertImage(
+      const msr::airlib::ImageCaptureBase::ImageResponse& response,
+      sensor_msgs::Image* msg);
+  // Size of the data of the converted image in bytes.
+  static size_t convertedImageSize(
+      const msr::airlib::ImageCaptureBase::ImageResponse& response);
+
+  // Of the message pools of all sensors, see MessagePool.
+  MessagePoolStatistics getAndResetPoolStatistics();
+
  protected:
   AirsimSimulator* parent_;  // Acces to owner
 
@@ -38,27 +69,65 @@ class SensorTimer {
   double rate_;      // rate of the sensor callback
   bool is_private_;  // whether this timer runs on multiple sensors or a single
                      // one
-  msr::airlib::MultirotorRpcLibClient airsim_client_;
+  std::shared_ptr<msr::airlib::MultirotorRpcLibClient>
+      airsim_client_;  // Shared with other timers, see getSensorClient().
   ros::Timer timer_;
+  std::mutex callback_mutex_;  // Serializes timer callbacks and triggers
   std::string vehicle_name_;
+  size_t server_index_;  // The airsim server this timer reads from, servers
+  // other than the first only render and follow the vehicle poses.
+  size_t client_index_;  // In the sensor client pool of the server
+  std::mutex* render_mutex_;  // of the vehicle on the server, owned by parent
+  Eigen::Vector3d spawn_position_;  // of the vehicle, in airsim coordinates
+  OdometryDriftSimulator* odometry_drift_simulator_;  // of the vehicle
   ros::NodeHandle nh_;
+  image_transport::ImageTransport image_transport_;
   tf2_ros::TransformBroadcaster tf_broadcaster_;
   ros::Publisher transform_pub_;
 
   // methods
+  void createClient();
   void processCameras();
+  void publishCamera(size_t camera_index, const sensor_msgs::ImagePtr& msg);
+  void publishSharedImage(size_t camera_index, const sensor_msgs::Image& msg);
   void processLidars();
   void processImus();
+  void publishSensorTransforms(
+      const std::string& frame_name,
+      const OdometryDriftSimulator::Transformation& ground_truth_pose,
+      const OdometryDriftSimulator::Transformation& simulated_pose,
+      const ros::Time& stamp);
+
+  // Cameras are published via image_transport on the processing pool, s.t.
+  // the timer never waits for encodings, which image_transport only runs for
+  // transports with subscribers. At most one frame per camera is pending,
+  // newer frames replace it.
+  struct CameraPublishQueue {
+    image_transport::CameraPublisher publisher;
+    std::mutex mutex;
+    bool is_publishing = false;  // A task of the pool owns the queue
+    sensor_msgs::ImageConstPtr image;
+    sensor_msgs::CameraInfoConstPtr info;
+    void publishPending();
+  };
 
   // cameras
-  std::vector<ros::Publisher> camera_pubs_;
+  std::vector<image_transport::CameraPublisher> camera_pubs_;
+  std::vector<std::shared_ptr<CameraPublishQueue>> camera_publish_queues_;
+  std::vector<float> camera_fovs_;  // deg
   std::vector<std::string> camera_frame_names_;
   std::vector<msr::airlib::ImageCaptureBase::ImageRequest> image_requests_;
+  std::vector<ros::Publisher> camera_shm_pubs_;  // Invalid if not used
+  std::vector<std::unique_ptr<SharedImageWriter>> camera_shm_writers_;
+  std::vector<int> camera_shm_slots_;
+  std::vector<MessagePool<sensor_msgs::Image>> camera_pools_;
 
   // lidars
   std::vector<ros::Publisher> lidar_pubs_;
   std::vector<std::string> lidar_names_;
   std::vector<std::string> lidar_frame_names_;
+  std::vector<float> lidar_compact_resolutions_;  // 0 if not compact
+  std::vector<MessagePool<sensor_msgs::PointCloud2>> lidar_pools_;
 
   // imus
   std::vector<ros::Publisher> imu_pubs_;
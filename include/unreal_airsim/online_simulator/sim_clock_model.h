@@ -0,0 +1,75 @@
+#ifndef UNREAL_AIRSIM_ONLINE_SIMULATOR_SIM_CLOCK_MODEL_H_
+#define UNREAL_AIRSIM_ONLINE_SIMULATOR_SIM_CLOCK_MODEL_H_
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+
+namespace unreal_airsim {
+/***
+ * Models the AirSim clock as an affine function of the steady wall clock,
+ * fitted to occasional (wall, sim) samples. This allows publishing sim time at
+ * high rates without querying the simulator for every stamp. The fitted rate
+ * covers the ClockSpeed setting, pauses are detected as samples where the sim
+ * time does not advance. If a sample deviates from the prediction by more than
+ * the resync threshold, the model is resynchronized to it. The returned time
+ * is monotonic, unless the sim time jumps back by more than max_backward_jump,
+ * e.g. after a level reset. If no sample arrives for longer than
+ * max_extrapolation, the time is held at the end of the extrapolation
+ * horizon until the next sample. Not thread safe.
+ */
+class SimClockModel {
+ public:
+  using WallTime = std::chrono::steady_clock::time_point;
+
+  struct Config {
+    int window_size = 10;  // Number of samples used for fitting the rate.
+    double resync_threshold = 0.005;  // s
+    double max_backward_jump = 1.0;   // s
+    double max_extrapolation = 1.0;   // s, wall time since the last sample
+  };
+
+  explicit SimClockModel(const Config& config);
+  SimClockModel() : SimClockModel(Config()) {}
+
+  // Add a sample of the sim time in ns, taken at the given wall time. For
+  // samples read via RPC the wall time should be the middle of the call.
+  void addSample(const WallTime& wall_time, uint64_t sim_time_ns);
+
+  // Sim time in ns predicted for the given wall time, 0 if not initialized.
+  uint64_t getSimTime(const WallTime& wall_time);
+
+  // Whether the last sample is older than max_extrapolation.
+  bool isStale(const WallTime& wall_time) const;
+
+  bool isInitialized() const { return !samples_.empty(); }
+  bool isPaused() const { return is_paused_; }
+  double getRate() const { return is_paused_ ? 0.0 : rate_; }
+  uint64_t getNumResyncs() const { return num_resyncs_; }
+
+ private:
+  Config config_;
+
+  struct Sample {
+    WallTime wall_time;
+    uint64_t sim_time_ns;
+  };
+  std::deque<Sample> samples_;
+
+  // Model: sim = reference_sim + offset + rate * (wall - reference_wall).
+  WallTime reference_wall_time_;
+  uint64_t reference_sim_time_ns_;
+  double offset_;  // s
+  double rate_;    // sim s per wall s, kept as prior across resyncs
+  bool is_paused_;
+  uint64_t num_resyncs_;
+  bool is_stale_;  // Whether the staleness was already reported.
+  uint64_t last_sim_time_ns_;  // Last returned time, for monotonicity.
+
+  void resync(const Sample& sample);
+  void fit();
+  double predict(const WallTime& wall_time) const;  // s since reference
+};
+}  // namespace unreal_airsim
+
+#endif  // UNREAL_AIRSIM_ONLINE_SIMULATOR_SIM_CLOCK_MODEL_H_
@@ -1,11 +1,19 @@
 #ifndef UNREAL_AIRSIM_ONLINE_SIMULATOR_SIMULATOR_H_
 #define UNREAL_AIRSIM_ONLINE_SIMULATOR_SIMULATOR_H_
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <thread>
 #include <vector>
 
+#include <geometry_msgs/PoseStamped.h>
+#include <geometry_msgs/TwistStamped.h>
+#include <nav_msgs/Path.h>
 #include <ros/ros.h>
 #include <std_msgs/Time.h>
 #include <tf2_ros/static_transform_broadcaster.h>
@@ -15,16 +23,27 @@
 #include <common/CommonStructs.hpp>
 #include <vehicles/multirotor/api/MultirotorRpcLibClient.hpp>
 
+#include "unreal_airsim/RenderViewpoints.h"
+#include "unreal_airsim/compact_pointcloud.h"
 #include "unreal_airsim/frame_converter.h"
+#include "unreal_airsim/online_simulator/camera_info_cache.h"
+#include "unreal_airsim/online_simulator/command_channel.h"
+#include "unreal_airsim/online_simulator/connection_supervisor.h"
+#include "unreal_airsim/online_simulator/frame_dispatcher.h"
 #include "unreal_airsim/online_simulator/sensor_timer.h"
+#include "unreal_airsim/online_simulator/sim_clock_model.h"
 #include "unreal_airsim/simulator_processing/processor_base.h"
+#include "unreal_airsim/simulator_processing/work_stealing_pool.h"
 
 #include "unreal_airsim/simulator_processing/odometry_drift_simulator/odometry_drift_simulator.h"
 
 namespace unreal_airsim {
 /***
  * This class implements a simulation interface with airsim.
- * Current application case is for a single Multirotor Vehicle.
+ * It simulates one or more Multirotor Vehicles, which share the RPC clients.
+ * The cameras can be sharded across multiple AirSim servers running the same
+ * map: the first server simulates the physics, the others are paused and only
+ * render, with their vehicles following the poses of the first one.
  */
 class AirsimSimulator {
  public:
@@ -34,17 +53,58 @@ class AirsimSimulator {
   struct Config {
     // general settings
     double state_refresh_rate = 100;  // hz
+    double collision_check_rate = 100;  // hz, polled separately from the
+    // state, 0 to disable.
     int time_publisher_interval =
         2;  // ms, this is the interval (in wall-time) in which the airsim time
             // is published as sim_time, i.e. 500 Hz. This only happens if
             // use_sim_time=true during launch.
+    int time_sync_interval = 200;  // ms, interval in which the published
+    // sim_time is synchronized with airsim, in between it is extrapolated.
+    double time_sync_threshold = 0.005;  // s, max deviation of the sim_time
+    // from airsim before it is resynchronized.
     std::string simulator_frame_name = "odom";
+    bool inline_processing = true;  // Pass images between sensors and
+    // processors in-process instead of via ROS where possible.
+    int processing_threads = 0;  // Size of the pool shared by the
+    // processors and camera publishers, 0 uses the number of available cores.
+    double processing_report_interval = 10.0;  // s, periodically log the
+    // execution times of all processors and commands, 0 to disable.
+    double connection_check_interval = 1.0;  // s, verify the connection to
+    // airsim, on disconnects the simulation is paused and reconnected.
+    double reconnect_max_backoff = 10.0;  // s, max wait between reconnects.
+    std::string camera_info_cache_file;  // Reuse the camera infos of previous
+    // runs with identical settings, defaults to
+    // $ROS_HOME/unreal_airsim_camera_infos.txt, empty to disable.
 
-    // vehicle (the multirotor)
-    std::string vehicle_name =
-        "airsim_drone";  // Currently assumes a single drone, multi-vehicle sim
-                         // could be setup
+    // airsim servers, given as 'ip:port'.
+    struct Server {
+      std::string ip = "localhost";
+      uint16_t port = 41451;  // AirSim default (ApiServerPort)
+    };
+    std::vector<Server> servers;  // The first one simulates the vehicles, the
+    // cameras are distributed over all of them.
+    int sensor_clients_per_server = 2;  // RPC connections shared round robin
+    // by the sensor timers of all vehicles.
+
+    // vehicles (the multirotors)
+    std::string vehicle_name = "airsim_drone";  // The single vehicle if no
+    // 'vehicles' are given, otherwise set to the first of them.
+    struct Vehicle {
+      std::string name;
+      Eigen::Vector3d spawn_position = Eigen::Vector3d::Zero();  // m, X, Y, Z
+      // in airsim coordinates as in settings.json. AirSim reports the poses of
+      // every vehicle relative to its own spawn position.
+    };
+    std::vector<Vehicle> vehicles;
     double velocity = 1.0;  // m/s, for high level movement commands
+    double max_velocity = 10.0;  // m/s, upper bound for timed trajectories
+    std::string command_mode = "fly";  // How command/pose is applied: 'fly'
+    // the vehicle there, or 'teleport' it there and read all of its sensors.
+    double command_max_age = 0.05;  // s, velocity, rate and attitude commands
+    // that could not be served within this time are dropped.
+    double command_hold_time = 0.1;  // s, these commands are applied for this
+    // long, s.t. the vehicle stops if the controller stops.
     msr::airlib::DrivetrainType drive_train_type =
         msr::airlib::DrivetrainType::MaxDegreeOfFreedom;  // this is currently
                                                           // fixed
@@ -52,14 +112,14 @@ class AirsimSimulator {
     // sensors
     bool publish_sensor_transforms = true;  // publish transforms when receiving
     // sensor measurements to guarantee correct tfs.
-    // TODO(schmluk): This is mostly a time syncing problem, maybe easiest to
-    //  publish the body pose based on these readings.
     struct Sensor {
       inline static const std::string TYPE_CAMERA = "Camera";
       inline static const std::string TYPE_LIDAR = "Lidar";
       inline static const std::string TYPE_IMU = "Imu";
       std::string name = "";
       std::string sensor_type = "";
+      std::string vehicle_name;  // The vehicle the sensor is mounted on
+      size_t server = 0;  // Index of the rendering server, cameras only
       std::string output_topic;  // defaults to vehicle_name/sensor_name
       std::string frame_name;    // defaults to vehicle_name/sensor_name
       double rate = 10.0;        // Hz
@@ -69,6 +129,9 @@ class AirsimSimulator {
                   // specific sensor
       Eigen::Vector3d translation;  // T_B_S, default is unit transform
       Eigen::Quaterniond rotation;
+      bool compact_encoding = false;  // Lidar only, publish point clouds in
+      // the compact_pointcloud encoding to reduce bandwidth.
+      double compact_resolution = compact_pointcloud::kDefaultResolution;  // m
     };
     struct Camera : Sensor {
       std::string image_type_str = "Scene";
@@ -76,16 +139,24 @@ class AirsimSimulator {
       msr::airlib::ImageCaptureBase::ImageType image_type =
           msr::airlib::ImageCaptureBase::ImageType::Scene;
       msr::airlib::CameraInfo camera_info;  // The info is read from UE4
+      bool shared_memory = false;  // Also pass the frames through a shared
+      // memory ring for same-host consumers, see shared_memory_image.h. The
+      // descriptors are published on output_topic/shm.
+      int shared_memory_slots = 4;
     };
     std::vector<std::unique_ptr<Sensor>> sensors;
   };
 
-  AirsimSimulator(const ros::NodeHandle& nh, const ros::NodeHandle& nh_private);
+  // Set up and connect the simulator, nullptr if this fails.
+  static std::unique_ptr<AirsimSimulator> createFromRos(
+      const ros::NodeHandle& nh, const ros::NodeHandle& nh_private);
   virtual ~AirsimSimulator() = default;
 
   // ROS callbacks
-  void simStateCallback(const ros::TimerEvent&);
+  void simStateCallback(size_t vehicle_index);
+  void collisionCallback(const ros::TimerEvent&);
   void startupCallback(const ros::TimerEvent&);
+  void processingReportCallback(const ros::WallTimerEvent&);
   void onShutdown();  // called by the sigint handler
 
   // Control
@@ -94,69 +165,215 @@ class AirsimSimulator {
    * mostly low level. If needed, some of these could also be included here, but
    * set pose should do for most purposes.
    */
-  void commandPoseCallback(const geometry_msgs::Pose& msg);
+  void commandPoseCallback(const geometry_msgs::Pose& msg,
+                           size_t vehicle_index);
+  /**
+   * Follow a path given in the drifting odom frame. The path is sent as a
+   * single move command, if the poses are stamped the speed is set to reach
+   * the last pose in time. A new path that starts in the future replaces only
+   * the remaining part of the active one after its start.
+   */
+  void commandTrajectoryCallback(const nav_msgs::Path& msg,
+                                 size_t vehicle_index);
+  /**
+   * Low level setpoints, served by the command channel. Velocities are in the
+   * drifting odom frame with angular.z as yaw rate. Rates are body rates with
+   * linear.z as altitude in the odom frame. Attitudes are the orientation in
+   * the odom frame with position.z as altitude. Return whether the command was
+   * sent.
+   */
+  bool commandVelocityCallback(const geometry_msgs::TwistStamped& msg,
+                               size_t vehicle_index);
+  bool commandRatesCallback(const geometry_msgs::TwistStamped& msg,
+                            size_t vehicle_index);
+  bool commandAttitudeCallback(const geometry_msgs::PoseStamped& msg,
+                               size_t vehicle_index);
+  /**
+   * Render the cameras of a vehicle at a batch of poses, e.g. to evaluate
+   * candidate views. The vehicle is teleported to every pose with physics and
+   * the vehicle's sensors paused and restored afterwards. The next view is
+   * rendered while the previous one is converted.
+   */
+  bool renderViewpointsCallback(RenderViewpoints::Request& request,
+                                RenderViewpoints::Response& response,
+                                size_t vehicle_index);
 
   // Acessors
   const Config& getConfig() const { return config_; }
   const FrameConverter& getFrameConverter() const { return frame_converter_; }
   ros::Time getTimeStamp(msr::airlib::TTimePoint airsim_stamp);
-  OdometryDriftSimulator* getOdometryDriftSimulator() {
-    return &odometry_drift_simulator_;
+  // Defaults to the first vehicle, nullptr if the vehicle does not exist.
+  OdometryDriftSimulator* getOdometryDriftSimulator(
+      const std::string& vehicle_name = "");
+  FrameDispatcher* getFrameDispatcher() { return &frame_dispatcher_; }
+  simulator_processor::WorkStealingPool* getProcessingPool() {
+    return processing_pool_.get();
+  }
+  ConnectionSupervisor* getConnectionSupervisor() {
+    return connection_supervisor_.get();
   }
+  // Client of the sensor client pool of a server, clients are recreated on
+  // reconnects.
+  std::shared_ptr<msr::airlib::MultirotorRpcLibClient> getSensorClient(
+      size_t server_index, size_t client_index);
+  // Latest pose of the vehicle in airsim coordinates relative to its spawn as
+  // simulated by the first server, false if there is none yet. Thread safe.
+  bool getVehiclePose(const std::string& vehicle_name,
+                      msr::airlib::Pose* pose,
+                      msr::airlib::TTimePoint* timestamp);
+  // Held while a vehicle is moved and rendered on a server, s.t. renders of
+  // different timers do not interleave. nullptr for unknown vehicles.
+  std::mutex* getRenderMutex(size_t server_index,
+                             const std::string& vehicle_name);
 
  protected:
+  AirsimSimulator(const ros::NodeHandle& nh, const ros::NodeHandle& nh_private);
+  bool initialize();
+
   // ROS
   ros::NodeHandle nh_;
   ros::NodeHandle nh_private_;
-  ros::Timer sim_state_timer_;
+  ros::Timer collision_timer_;
   ros::Timer startup_timer_;
-  ros::Publisher odom_pub_;
-  ros::Publisher pose_pub_;
-  ros::Publisher collision_pub_;
+  ros::WallTimer processing_report_timer_;
   ros::Publisher sim_is_ready_pub_;
   ros::Publisher time_pub_;
-  ros::Subscriber command_pose_sub_;
   tf2_ros::TransformBroadcaster tf_broadcaster_;
   tf2_ros::StaticTransformBroadcaster static_tf_broadcaster_;
 
-  // Odometry simulator
-  OdometryDriftSimulator odometry_drift_simulator_;
+  // Per vehicle interfaces and odometry simulation, in order of
+  // config_.vehicles
+  struct VehicleInterface {
+    std::string name;
+    Eigen::Vector3d spawn_position;
+    std::unique_ptr<OdometryDriftSimulator> odometry_drift_simulator;
+    ros::Timer state_timer;
+    ros::Publisher odom_pub;
+    ros::Publisher pose_pub;
+    ros::Publisher collision_pub;
+    ros::Subscriber command_pose_sub;
+    ros::Subscriber command_trajectory_sub;
+    ros::Subscriber command_velocity_sub;
+    ros::Subscriber command_rates_sub;
+    ros::Subscriber command_attitude_sub;
+    ros::Publisher pose_reached_pub;  // command_mode 'teleport' only
+    ros::Publisher trajectory_progress_pub;
+    ros::ServiceServer render_viewpoints_srv;
+    msr::airlib::Pose pose;  // latest, guarded by vehicle_poses_mutex_
+    msr::airlib::TTimePoint pose_timestamp = 0;
+    msr::airlib::LandedState landed_state = msr::airlib::LandedState::Landed;
+  };
+  std::vector<VehicleInterface> vehicles_;
+  std::mutex vehicle_poses_mutex_;
+  std::mutex vehicle_state_update_mutex_;  // Serializes updateVehicleState
+  // Per server and vehicle, indexed server * #vehicles + vehicle.
+  std::vector<std::unique_ptr<std::mutex>> render_mutexes_;
+
+  // The trajectory followed by a vehicle, in airsim coordinates relative to
+  // its spawn. The first waypoint is the position when it was commanded.
+  struct Trajectory {
+    std::vector<msr::airlib::Vector3r> waypoints;
+    std::vector<ros::Time> stamps;     // Empty if not time-parameterized
+    std::vector<double> arc_lengths;   // m, from the first waypoint
+    size_t next_waypoint = 1;
+  };
+  std::vector<Trajectory> trajectories_;  // Per vehicle
+  std::mutex trajectories_mutex_;
 
   // Read sim time from AirSim
   std::thread timer_thread_;
+  SimClockModel sim_clock_model_;  // Only used by the time publisher thread
+  bool use_imu_time_ = true;  // Read the sim time from the IMU, same thread
 
   // components
   std::vector<std::unique_ptr<SensorTimer>>
       sensor_timers_;  // These manage the actual sensor reading/publishing
+  std::unique_ptr<simulator_processor::WorkStealingPool>
+      processing_pool_;  // Shared with the camera publishers, outlives the
+                         // processors
   std::vector<std::unique_ptr<simulator_processor::ProcessorBase>>
-      processors_;  // Various post-processing
+      processors_;  // Various post-processing, in topological order
+  FrameDispatcher frame_dispatcher_;  // In-process image passing
 
   // Airsim clients (These can be blocking and thus slowing down tasks if only
-  // one is used)
-  msr::airlib::MultirotorRpcLibClient airsim_state_client_;
-  msr::airlib::MultirotorRpcLibClient airsim_move_client_;
-  msr::airlib::MultirotorRpcLibClient airsim_time_client_;
+  // one is used). They are recreated on reconnects, users hold a shared lock
+  // of clients_mutex_.
+  std::unique_ptr<msr::airlib::MultirotorRpcLibClient> airsim_state_client_;
+  std::unique_ptr<msr::airlib::MultirotorRpcLibClient>
+      airsim_collision_client_;
+  std::unique_ptr<msr::airlib::MultirotorRpcLibClient> airsim_move_client_;
+  std::unique_ptr<msr::airlib::MultirotorRpcLibClient> airsim_time_client_;
+  std::unique_ptr<msr::airlib::MultirotorRpcLibClient>
+      airsim_command_client_;  // Only used by the command channel
+  std::unique_ptr<msr::airlib::MultirotorRpcLibClient>
+      airsim_viewpoint_client_;  // Only used to render viewpoints
+  std::vector<std::unique_ptr<msr::airlib::MultirotorRpcLibClient>>
+      airsim_render_clients_;  // For setup of the additional servers
+  std::vector<std::vector<std::shared_ptr<msr::airlib::MultirotorRpcLibClient>>>
+      sensor_clients_;  // Per server, shared by the sensor timers
+  std::shared_mutex clients_mutex_;
+  std::unique_ptr<ConnectionSupervisor> connection_supervisor_;
+  std::unique_ptr<CommandChannel> command_channel_;
+  std::mutex render_viewpoints_mutex_;  // One batch at a time
+
+  // Startup of the vehicles, runs as state machine in the startup timer.
+  enum class StartupStage { kArming, kTakingOff, kMovingToStart };
+  StartupStage startup_stage_;
+  std::chrono::steady_clock::time_point startup_stage_start_;
 
   // tools
   Config config_;
   FrameConverter frame_converter_;  // the world-to-airsim transformation
 
   // variables
-  bool is_connected_;  // whether the airsim client is connected
-  bool is_running_;   // whether the simulator setup successfully and is working
-  bool is_shutdown_;  // After setting is shutdown no more airsim requests are
-                      // allowed.
+  std::atomic<bool> is_connected_;  // whether the airsim clients are connected
+  std::atomic<bool> is_running_;  // whether the simulator setup successfully
+                                  // and is working
+  std::atomic<bool> is_shutdown_;  // After setting is shutdown no more airsim
+                                   // requests are allowed.
   bool use_sim_time_;  // Publish ros time based on the airsim clock
+  std::vector<std::string> processor_names_;  // Found with the sensors
 
   // setup methods
-  bool setupAirsim();  // Connect to Airsim and verify
+  bool setupAirsim(double timeout);  // Connect to Airsim and verify
   bool setupROS();
   bool readParamsFromRos();
+  bool readServersFromRos();
+  bool readVehiclesFromRos();
+  void setupVehicles();
+  bool readCameraInfos();  // From the cache or UE4
+  uint64_t computeSettingsHash();
   bool initializeSimulationFrame();
   bool startSimTimer();
+  void setupProcessingGraph();
+
+  // connection handling, see ConnectionSupervisor
+  void createClients();
+  bool isAirsimConnected();
+  void pauseSimulation();
+  bool reconnectAirsim();
+  void resumeSimulation();
+  void updateCameraInfos();
+  std::vector<msr::airlib::CameraInfo> fetchCameraInfos(
+      const std::vector<Config::Camera*>& cameras);
 
   // methods
+  void setStartupStage(StartupStage stage);
+  void updateVehicleState(VehicleInterface* vehicle,
+                          const msr::airlib::MultirotorState& state);
+  void updateTrajectoryProgress(size_t vehicle_index,
+                                const msr::airlib::Vector3r& position);
+  void clearTrajectory(size_t vehicle_index);
+  void teleportVehicle(size_t vehicle_index,
+                       const OdometryDriftSimulator::Transformation& T_gt);
+  // Position and yaw of a ground truth pose in airsim coordinates relative to
+  // the spawn of the vehicle.
+  msr::airlib::Pose vehiclePoseRosToAirsim(
+      const VehicleInterface& vehicle,
+      const OdometryDriftSimulator::Transformation& T_gt) const;
+  double altitudeRosToAirsim(const VehicleInterface& vehicle, double z) const;
   void readSimTimeCallback();
+  void publishSimTimeCallback();
 
   // helper methods
   bool readTransformFromRos(const std::string& topic,
@@ -0,0 +1,79 @@
+#ifndef UNREAL_AIRSIM_SHARED_MEMORY_IMAGE_H_
+#define UNREAL_AIRSIM_SHARED_MEMORY_IMAGE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <sensor_msgs/Image.h>
+
+#include "unreal_airsim/SharedImage.h"
+
+namespace unreal_airsim {
+
+/***
+ * Passes images to consumers on the same host through a POSIX shared memory
+ * ring, s.t. only a small SharedImage descriptor is sent via ROS. The writer
+ * copies every frame once into the oldest slot that is not referenced by any
+ * reader, readers map the frames without copying. A slot can not be
+ * overwritten while it is referenced, so readers should release frames
+ * quickly: if all slots are referenced frames are dropped. The reference
+ * counts of crashed readers are not recovered until the writer is recreated.
+ * The segment is created with permissions for the user of the writer only.
+ */
+class SharedImageWriter {
+ public:
+  // Creates the segment, replacing existing ones of the same name. The
+  // segment is unlinked on destruction unless it was replaced meanwhile.
+  SharedImageWriter(const std::string& segment_name, size_t num_slots,
+                    size_t slot_size);
+  virtual ~SharedImageWriter();
+
+  SharedImageWriter(const SharedImageWriter&) = delete;
+  SharedImageWriter& operator=(const SharedImageWriter&) = delete;
+
+  bool isValid() const { return memory_ != nullptr; }
+  size_t getSlotSize() const { return slot_size_; }
+
+  // Copy the image into the ring and describe it, the header is not set.
+  // False if the image does not fit or all slots are referenced.
+  bool write(const sensor_msgs::Image& image, SharedImage* descriptor);
+
+  // Segment name for a topic, e.g. '/unreal_airsim_drone_camera'.
+  static std::string segmentName(const std::string& topic);
+
+ private:
+  const std::string segment_name_;
+  const size_t num_slots_;
+  const size_t slot_size_;
+  size_t mapped_size_ = 0;
+  uint8_t* memory_ = nullptr;
+  uint64_t segment_id_ = 0;
+  uint64_t sequence_ = 0;
+  size_t next_slot_ = 0;
+};
+
+class SharedImageReader {
+ public:
+  SharedImageReader() = default;
+  virtual ~SharedImageReader() = default;
+
+  // Reference the described image data, it is neither unmapped nor overwritten
+  // until the returned pointer is released. Nullptr if the image is no longer
+  // available, e.g. overwritten, or the segment can not be mapped.
+  std::shared_ptr<const uint8_t> read(const SharedImage& descriptor);
+
+ private:
+  struct Mapping;
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<Mapping>> mappings_;
+
+  std::shared_ptr<Mapping> getMapping(const SharedImage& descriptor);
+};
+
+}  // namespace unreal_airsim
+
+#endif  // UNREAL_AIRSIM_SHARED_MEMORY_IMAGE_H_
@@ -1,12 +1,15 @@
 #ifndef UNREAL_AIRSIM_SIMULATOR_PROCESSOR_DEPTH_TO_POINTCLOUD_H_
 #define UNREAL_AIRSIM_SIMULATOR_PROCESSOR_DEPTH_TO_POINTCLOUD_H_
 
+#include "unreal_airsim/depth_camera_intrinsics.h"
 #include "unreal_airsim/simulator_processing/processor_base.h"
 
 // ROS
 #include <ros/ros.h>
 #include <sensor_msgs/Image.h>
+#include <sensor_msgs/PointCloud2.h>
 
+#include <cstdint>
 #include <deque>
 #include <mutex>
 #include <string>
@@ -22,6 +25,9 @@ class DepthToPointcloud : public ProcessorBase {
   virtual ~DepthToPointcloud() = default;
 
   bool setupFromRos(const ros::NodeHandle& nh, const std::string& ns) override;
+  MessagePoolStatistics getAndResetPoolStatistics() override {
+    return cloud_pool_.getAndResetStatistics();
+  }
 
   // ROS callbacks
   void depthImageCallback(const sensor_msgs::ImagePtr& msg);
@@ -35,9 +41,7 @@ class DepthToPointcloud : public ProcessorBase {
   // ROS
   ros::NodeHandle nh_;
   ros::Publisher pub_;
-  ros::Subscriber depth_sub_;
-  ros::Subscriber color_sub_;
-  ros::Subscriber segmentation_sub_;
+  MessagePool<sensor_msgs::PointCloud2> cloud_pool_;
 
   // queues
   std::mutex queue_guard;
@@ -50,15 +54,17 @@ class DepthToPointcloud : public ProcessorBase {
   bool use_segmentation_;
   bool is_setup_;
   float fov_;  // depth cam intrinsics, fov in degrees
-  float focal_length_;
-  float vx_;
-  float vy_;
+  DepthCameraIntrinsics intrinsics_;
 
   // params
   int max_queue_length_;
   float max_depth_;       // points beyond this depth [m] will be discarded
   float max_ray_length_;  // points beyond this ray length [m] will be discarded
   bool use_infrared_compensation_;
+  bool drop_invalid_points_;  // publish only valid points instead of keeping
+                              // discarded points at the origin
+  bool compact_encoding_;     // publish using the compact_pointcloud encoding
+  float compact_resolution_;  // quantization resolution [m]
 
   // methods
   void findMatchingMessagesToPublish(
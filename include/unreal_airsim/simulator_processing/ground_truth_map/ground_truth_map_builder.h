@@ -0,0 +1,75 @@
+#ifndef UNREAL_AIRSIM_SIMULATOR_PROCESSING_GROUND_TRUTH_MAP_GROUND_TRUTH_MAP_BUILDER_H_
+#define UNREAL_AIRSIM_SIMULATOR_PROCESSING_GROUND_TRUTH_MAP_GROUND_TRUTH_MAP_BUILDER_H_
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <ros/ros.h>
+#include <sensor_msgs/Image.h>
+#include <std_srvs/Trigger.h>
+#include <tf2_ros/buffer.h>
+#include <tf2_ros/transform_listener.h>
+
+#include "unreal_airsim/simulator_processing/ground_truth_map/tsdf_layer.h"
+#include "unreal_airsim/simulator_processing/processor_base.h"
+
+namespace unreal_airsim::simulator_processor {
+/***
+ * Integrates the noise-free depth images of a planar depth camera at their
+ * ground truth sensor poses into a TSDF map in the simulator frame. This
+ * serves as reference map to evaluate mapping pipelines against. The map can
+ * be written to file using the '<name>/save_map' service.
+ */
+class GroundTruthMapBuilder : public ProcessorBase {
+ public:
+  GroundTruthMapBuilder() = default;
+  ~GroundTruthMapBuilder() override = default;
+
+  bool setupFromRos(const ros::NodeHandle& nh, const std::string& ns) override;
+
+  // ROS callbacks
+  void depthImageCallback(const sensor_msgs::ImagePtr& msg);
+  bool saveMapCallback(std_srvs::Trigger::Request& request,
+                       std_srvs::Trigger::Response& response);
+
+ protected:
+  // methods
+  // Requires map_guard_ to be locked.
+  void integrateFrame(const sensor_msgs::Image& msg);
+
+  // setup
+  static ProcessorFactory::Registration<GroundTruthMapBuilder> registration_;
+
+  // ROS
+  ros::NodeHandle nh_;
+  ros::ServiceServer save_map_srv_;
+  std::unique_ptr<tf2_ros::Buffer> tf_buffer_;
+  std::unique_ptr<tf2_ros::TransformListener> tf_listener_;
+
+  // map
+  std::mutex map_guard_;  // Also guards the pending frames.
+  std::unique_ptr<TsdfLayer> tsdf_layer_;
+
+  // Frames waiting for their sensor pose, oldest first. Frames are dropped if
+  // their pose did not arrive until a frame kMaxPendingTime [s] newer did.
+  static constexpr size_t kMaxPendingFrames = 10;
+  static constexpr double kMaxPendingTime = 0.5;
+  std::deque<sensor_msgs::ImagePtr> pending_frames_;
+
+  // params
+  std::string sensor_frame_name_;  // ground truth frame of the depth camera
+  std::string output_path_;
+  float save_max_distance_;  // voxels beyond this distance [m] are not saved
+  float fov_;                // depth cam intrinsics, fov in degrees
+
+  // statistics
+  int num_integrated_frames_ = 0;
+  double total_integration_time_ = 0.0;  // s
+  double max_integration_time_ = 0.0;    // s
+};
+
+}  // namespace unreal_airsim::simulator_processor
+
+#endif  // UNREAL_AIRSIM_SIMULATOR_PROCESSING_GROUND_TRUTH_MAP_GROUND_TRUTH_MAP_BUILDER_H_
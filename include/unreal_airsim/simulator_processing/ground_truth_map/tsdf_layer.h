@@ -0,0 +1,110 @@
+#ifndef UNREAL_AIRSIM_SIMULATOR_PROCESSING_GROUND_TRUTH_MAP_TSDF_LAYER_H_
+#define UNREAL_AIRSIM_SIMULATOR_PROCESSING_GROUND_TRUTH_MAP_TSDF_LAYER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <Eigen/Geometry>
+
+namespace unreal_airsim {
+namespace simulator_processor {
+class WorkStealingPool;
+}  // namespace simulator_processor
+
+/***
+ * Hashed, block-sparse truncated signed distance field. Voxels are grouped in
+ * cubic blocks that are only allocated where surfaces are observed. Depth
+ * frames are integrated projectively, i.e. every voxel of a touched block is
+ * projected into the depth image, such that all blocks can be updated
+ * independently and in parallel on the processing pool.
+ */
+class TsdfLayer {
+ public:
+  struct Config {
+    float voxel_size = 0.05f;         // m
+    int voxels_per_side = 16;         // voxels per block side
+    float truncation_distance = 0.2f;  // m, less than a block side
+    float max_weight = 1e4f;
+    float max_depth = 1e6f;  // depth values beyond this [m] are ignored
+    int allocation_stride = 2;  // only every n-th pixel is used to find blocks
+
+    bool isValid() const;
+  };
+
+  struct Voxel {
+    float distance = 0.f;
+    float weight = 0.f;
+  };
+
+  struct Block {
+    Eigen::Vector3i index;
+    std::vector<Voxel> voxels;
+  };
+
+  // Planar depth image (ImageType::DepthPlanar) with pinhole intrinsics.
+  struct DepthFrame {
+    const float* data = nullptr;
+    int width = 0;
+    int height = 0;
+    size_t row_stride = 0;  // in floats
+    float focal_length = 0.f;
+    float vx = 0.f;
+    float vy = 0.f;
+  };
+
+  // Blocks are integrated on the pool if given, else on the calling thread.
+  explicit TsdfLayer(const Config& config,
+                     simulator_processor::WorkStealingPool* pool = nullptr);
+  virtual ~TsdfLayer() = default;
+
+  // Integrate a depth frame taken at pose T_W_C (camera frame is x right, y
+  // down, z depth). Blocks until integrated, the calling thread takes part.
+  void integrateDepthFrame(const DepthFrame& frame,
+                           const Eigen::Isometry3f& T_W_C);
+
+  // Write all observed voxels within max_abs_distance of a surface as binary
+  // PLY point cloud (position, distance, weight). Returns the number of voxels
+  // written or -1 on failure.
+  int64_t saveVoxelsToPly(const std::string& file_name,
+                          float max_abs_distance) const;
+
+  // Returns the voxel containing the point or nullptr if its block is not
+  // allocated.
+  const Voxel* getVoxelPtr(const Eigen::Vector3f& point) const;
+
+  void clear() { blocks_.clear(); }
+  size_t getNumberOfBlocks() const { return blocks_.size(); }
+  size_t getMemorySize() const;
+  const Config& getConfig() const { return config_; }
+
+ private:
+  struct BlockIndexHash {
+    size_t operator()(const Eigen::Vector3i& index) const {
+      // Large primes as in Teschner et al. (2003), "Optimized Spatial
+      // Hashing for Collision Detection of Deformable Objects".
+      return static_cast<size_t>(index.x()) * 73856093u ^
+             static_cast<size_t>(index.y()) * 19349669u ^
+             static_cast<size_t>(index.z()) * 83492791u;
+    }
+  };
+  using BlockMap = std::unordered_map<Eigen::Vector3i, std::unique_ptr<Block>,
+                                      BlockIndexHash>;
+
+  const Config config_;
+  simulator_processor::WorkStealingPool* const pool_;
+  const float block_size_;
+  const int voxels_per_block_;
+  BlockMap blocks_;
+
+  Eigen::Vector3i getBlockIndex(const Eigen::Vector3f& point) const;
+  void integrateBlock(const DepthFrame& frame, const Eigen::Isometry3f& T_C_W,
+                      Block* block) const;
+};
+
+}  // namespace unreal_airsim
+
+#endif  // UNREAL_AIRSIM_SIMULATOR_PROCESSING_GROUND_TRUTH_MAP_TSDF_LAYER_H_
@@ -21,6 +21,9 @@ class InfraredIdCompensation : public ProcessorBase {
   ~InfraredIdCompensation() override = default;
 
   bool setupFromRos(const ros::NodeHandle& nh, const std::string& ns) override;
+  MessagePoolStatistics getAndResetPoolStatistics() override {
+    return image_pool_.getAndResetStatistics();
+  }
 
   // ROS callbacks
   void imageCallback(const sensor_msgs::ImagePtr& msg);
@@ -32,7 +35,7 @@ class InfraredIdCompensation : public ProcessorBase {
   // ROS
   ros::NodeHandle nh_;
   ros::Publisher pub_;
-  ros::Subscriber sub_;
+  MessagePool<sensor_msgs::Image> image_pool_;
 
   // the actual compensation values as measured for the current setup. Values
   // that can not be mapped to are 255, so if anything goes wrong it can be
@@ -0,0 +1,76 @@
+#ifndef UNREAL_AIRSIM_SIMULATOR_PROCESSING_ODOMETRY_DRIFT_SIMULATOR_BIAS_NOISE_MODEL_H_
+#define UNREAL_AIRSIM_SIMULATOR_PROCESSING_ODOMETRY_DRIFT_SIMULATOR_BIAS_NOISE_MODEL_H_
+
+#include <ros/ros.h>
+#include <string>
+
+#include <glog/logging.h>
+
+#include "unreal_airsim/simulator_processing/odometry_drift_simulator/random_engine.h"
+
+namespace unreal_airsim {
+/***
+ * Noise model of a single velocity axis, whose integral is the drift.
+ * - piecewise_constant: N(mean, stddev) samples that are held constant and
+ *   resampled at the velocity_noise_frequency_hz of the drift simulator.
+ * - gauss_markov: first-order Gauss-Markov bias with stationary stddev and
+ *   correlation_time, plus the constant mean.
+ * - random_walk: bias performing a random walk with stddev as diffusion
+ *   [unit/sqrt(s)], plus the constant mean.
+ * The Gauss-Markov and random walk models are discretized exactly for any
+ * time step, i.e. the bias and its integral over the step are sampled from
+ * their joint distribution, s.t. the statistics do not depend on the rate
+ * at which the drift simulator is ticked.
+ */
+class BiasNoiseModel {
+ public:
+  enum class Type { kPiecewiseConstant, kGaussMarkov, kRandomWalk };
+
+  struct Config {
+    // Initialize from ROS params
+    static Config fromRosParams(const ros::NodeHandle& nh);
+
+    std::string type = "piecewise_constant";
+    double mean = 0.0;
+    double stddev = 0.0;
+    double correlation_time = 1.0;  // s, gauss_markov only
+
+    // Validity queries and assertions
+    bool isValid(const std::string& error_msg_prefix = "") const;
+    Config& checkValid() {
+      CHECK(isValid());
+      return *this;
+    }
+
+    // Write config values to stream, e.g. for logging
+    friend std::ostream& operator<<(std::ostream& os, const Config& config);
+  };
+
+  explicit BiasNoiseModel(const Config& config);
+
+  Type getType() const { return type_; }
+  bool isPiecewiseConstant() const {
+    return type_ == Type::kPiecewiseConstant;
+  }
+
+  // Draw the initial bias, from the stationary distribution if it exists.
+  void reset(RandomEngine* engine);
+
+  // Piecewise constant model: scale a standard normal sample.
+  double samplePiecewiseConstant(double standard_normal) const {
+    return standard_normal * config_.stddev + config_.mean;
+  }
+
+  // Gauss-Markov and random walk models: advance the bias by delta_t and
+  // return its integral over the step, given two standard normal samples.
+  double integrate(double delta_t, double standard_normal_1,
+                   double standard_normal_2);
+
+ private:
+  const Config config_;
+  const Type type_;
+  double bias_;  // excluding the mean
+};
+}  // namespace unreal_airsim
+
+#endif  // UNREAL_AIRSIM_SIMULATOR_PROCESSING_ODOMETRY_DRIFT_SIMULATOR_BIAS_NOISE_MODEL_H_
@@ -2,11 +2,12 @@
 #define UNREAL_AIRSIM_SIMULATOR_PROCESSING_ODOMETRY_DRIFT_SIMULATOR_NORMAL_DISTRIBUTION_H_
 
 #include <ros/ros.h>
-#include <random>
 #include <string>
 
 #include <glog/logging.h>
 
+#include "unreal_airsim/simulator_processing/odometry_drift_simulator/random_engine.h"
+
 namespace unreal_airsim {
 class NormalDistribution {
  public:
@@ -39,28 +40,20 @@ class NormalDistribution {
   double getMean() const { return mean_; }
   double getStddev() const { return stddev_; }
 
-  // Return a sample from the normal distribution N(mean_, stddev_)
-  double operator()() {
-    CHECK_GE(stddev_, 0) << "The standard deviation must be non-negative.";
-    // Random engine
-    // TODO(victorr): Add proper random seed handling (and option to provide it)
-    // NOTE: The noise generator is static to ensure that all instances draw
-    //       subsequent (different) numbers from the same pseudo random
-    //       sequence. If the generator is instance specific, there's a risk
-    //       that multiple instances use generators with the same seed and
-    //       output the same sequence.
-    static std::mt19937 noise_generator_;
+  // Return a sample from the normal distribution N(mean_, stddev_), drawn
+  // from the caller's engine s.t. every user has a reproducible stream.
+  double operator()(RandomEngine* engine) const {
+    return fromStandardNormal(engine->standardNormal());
+  }
 
-    // Draw a sample from the standard normal N(0,1) and
-    // scale it using the change of variables formula
-    return normal_distribution_(noise_generator_) * stddev_ + mean_;
+  // Scale a sample of the standard normal N(0,1) using the change of
+  // variables formula, e.g. for batches drawn via fillStandardNormal().
+  double fromStandardNormal(double sample) const {
+    return sample * stddev_ + mean_;
   }
 
  private:
   const double mean_, stddev_;
-
-  // Standard normal distribution
-  std::normal_distribution<double> normal_distribution_;
 };
 }  // namespace unreal_airsim
 
@@ -2,7 +2,10 @@
 #define UNREAL_AIRSIM_SIMULATOR_PROCESSING_ODOMETRY_DRIFT_SIMULATOR_ODOMETRY_DRIFT_SIMULATOR_H_
 
 #include <map>
+#include <memory>
+#include <shared_mutex>
 #include <string>
+#include <vector>
 
 #include <geometry_msgs/PoseStamped.h>
 #include <geometry_msgs/TransformStamped.h>
@@ -11,13 +14,17 @@
 #include <ros/ros.h>
 #include <tf2_ros/transform_broadcaster.h>
 
+#include "unreal_airsim/simulator_processing/odometry_drift_simulator/bias_noise_model.h"
 #include "unreal_airsim/simulator_processing/odometry_drift_simulator/normal_distribution.h"
+#include "unreal_airsim/simulator_processing/odometry_drift_simulator/random_engine.h"
 
 namespace unreal_airsim {
 class OdometryDriftSimulator {
  public:
   using NoiseDistribution = NormalDistribution;
   using Transformation = kindr::minimal::QuatTransformationTemplate<double>;
+  using TransformationVector =
+      std::vector<Transformation, Eigen::aligned_allocator<Transformation>>;
 
   struct Config {
     // Initialize from ROS params
@@ -27,11 +34,22 @@ class OdometryDriftSimulator {
     bool publish_ground_truth_pose = false;
     std::string ground_truth_frame_suffix = "_ground_truth";
 
-    // Params of the distributions used to generate the pose drift and noise
+    // Seed of the drift and noise, negative values draw a random seed
+    int seed = 0;
+    // Independent stream of the seed, derived with RandomEngine::jump(), e.g.
+    // for multiple vehicles or Monte-Carlo realizations. Not read from ROS.
+    int stream = 0;
+
+    // Number of past drift states kept to convert poses at their own stamp
+    int history_size = 500;
+
+    // Params of the models used to generate the pose drift and noise. The
+    // frequency only applies to piecewise_constant velocity noise axes.
     float velocity_noise_frequency_hz = 1;
-    using NoiseConfigMap = std::map<std::string, NoiseDistribution::Config>;
-    NoiseConfigMap velocity_noise = {
+    using BiasNoiseConfigMap = std::map<std::string, BiasNoiseModel::Config>;
+    BiasNoiseConfigMap velocity_noise = {
         {"x", {}}, {"y", {}}, {"z", {}}, {"yaw", {}}};
+    using NoiseConfigMap = std::map<std::string, NoiseDistribution::Config>;
     NoiseConfigMap pose_noise = {{"x", {}},   {"y", {}},     {"z", {}},
                                  {"yaw", {}}, {"pitch", {}}, {"roll", {}}};
 
@@ -54,19 +72,46 @@ class OdometryDriftSimulator {
     started_publishing_ = true;
   }
   void reset();
+  void tick(const Transformation& ground_truth_pose, const ros::Time& stamp);
   void tick(const geometry_msgs::TransformStamped& ground_truth_pose_msg);
 
-  Transformation getSimulatedPose() const { return current_simulated_pose_; }
-  Transformation getGroundTruthPose() const;
-  geometry_msgs::TransformStamped getSimulatedPoseMsg() const;
-  geometry_msgs::TransformStamped getGroundTruthPoseMsg() const {
-    return last_ground_truth_pose_msg_;
+  // Frames of the published pose msgs and TFs, the msg tick() sets these
+  // from the msg.
+  void setFrameNames(const std::string& frame_id,
+                     const std::string& child_frame_id);
+
+  Transformation getSimulatedPose() const {
+    std::shared_lock<std::shared_mutex> lock(state_mutex_);
+    return current_simulated_pose_;
+  }
+  Transformation getGroundTruthPose() const {
+    std::shared_lock<std::shared_mutex> lock(state_mutex_);
+    return current_ground_truth_pose_;
   }
+  geometry_msgs::TransformStamped getSimulatedPoseMsg() const;
+  geometry_msgs::TransformStamped getGroundTruthPoseMsg() const;
 
+  // Conversions using the latest drift state.
   Transformation convertDriftedToGroundTruthPose(
       const Transformation& simulated_pose) const;
   Transformation convertGroundTruthToDriftedPose(
       const Transformation& ground_truth_pose) const;
+
+  // Conversions using the drift state at the given stamp, interpolated
+  // between the ticks. These are thread safe w.r.t. tick().
+  Transformation convertDriftedToGroundTruthPose(
+      const Transformation& simulated_pose, const ros::Time& stamp) const;
+  Transformation convertGroundTruthToDriftedPose(
+      const Transformation& ground_truth_pose, const ros::Time& stamp) const;
+
+  // Convert several poses of the same stamp, e.g. all cameras of a rig, with
+  // a single drift state lookup.
+  void convertGroundTruthToDriftedPoses(
+      const TransformationVector& ground_truth_poses, const ros::Time& stamp,
+      TransformationVector* simulated_poses) const;
+
+  // Conversions using the drift state at the stamp of the msg header, or the
+  // latest drift state if it is not set.
   geometry_msgs::TransformStamped convertDriftedToGroundTruthPoseMsg(
       const geometry_msgs::TransformStamped& simulated_pose_msg) const;
   geometry_msgs::TransformStamped convertGroundTruthToDriftedPoseMsg(
@@ -77,8 +122,12 @@ class OdometryDriftSimulator {
  private:
   // Settings
   const Config config_;
+  const uint64_t seed_;
   bool started_publishing_;
 
+  // Every instance draws from its own engine, reseeded on reset()
+  RandomEngine random_engine_;
+
   // Simulator state
   ros::Time last_velocity_noise_sampling_time_;
   const ros::Duration velocity_noise_sampling_period_;
@@ -87,24 +136,54 @@ class OdometryDriftSimulator {
   Transformation integrated_pose_drift_;
   Transformation current_pose_noise_;
   Transformation current_simulated_pose_;
-  geometry_msgs::TransformStamped last_ground_truth_pose_msg_;
-
-  // Noise distributions
-  struct VelocityNoiseDistributions {
-    explicit VelocityNoiseDistributions(
-        const Config::NoiseConfigMap& velocity_noise_configs);
-    NoiseDistribution x, y, z;
-    NoiseDistribution yaw;
+  Transformation current_ground_truth_pose_;
+  ros::Time current_stamp_;
+  std::string frame_id_;
+  std::string child_frame_id_;
+
+  // Ring buffer of the past drift states, ordered by stamp. The simulator
+  // state above is guarded by the same mutex as it is read by sensor threads.
+  struct DriftState {
+    ros::Time stamp;
+    Transformation drift;
+    Transformation noise;
+  };
+  std::vector<DriftState> drift_history_;
+  size_t drift_history_start_;  // index of the oldest state
+  size_t drift_history_count_;
+  mutable std::shared_mutex state_mutex_;
+  void getDriftStateAt(const ros::Time& stamp, Transformation* drift,
+                       Transformation* noise) const;
+
+  // Noise models
+  struct VelocityNoiseModels {
+    explicit VelocityNoiseModels(
+        const Config::BiasNoiseConfigMap& velocity_noise_configs);
+    BiasNoiseModel x, y, z;
+    BiasNoiseModel yaw;
+    void reset(RandomEngine* engine);
+    // Draw x, y, z, yaw of the piecewise constant axes as one batch, the
+    // other axes are zero
+    Eigen::Vector4d samplePiecewiseConstant(RandomEngine* engine) const;
+    // Integrate x, y, z, yaw of the bias axes over delta_t as one batch, the
+    // other axes are zero
+    Eigen::Vector4d integrateBias(double delta_t, RandomEngine* engine);
+    bool has_bias_axes;
   } velocity_noise_;
   struct PoseNoiseDistributions {
     explicit PoseNoiseDistributions(
         const Config::NoiseConfigMap& pose_noise_configs);
     NoiseDistribution x, y, z;
     NoiseDistribution yaw, pitch, roll;
+    // Draw x, y, z, roll, pitch, yaw as one batch
+    Transformation::Vector6 sample(RandomEngine* engine) const;
   } pose_noise_;
 
-  // Transform publishing
-  mutable tf2_ros::TransformBroadcaster transform_broadcaster_;
+  // Transform publishing, the broadcaster is only created when first used
+  // s.t. the simulator can also run without ROS master.
+  mutable std::unique_ptr<tf2_ros::TransformBroadcaster> transform_broadcaster_;
+  geometry_msgs::TransformStamped toTransformMsg(
+      const Transformation& pose) const;
   void publishSimulatedPoseTf() const;
   void publishGroundTruthPoseTf() const;
 };
@@ -0,0 +1,134 @@
+#ifndef UNREAL_AIRSIM_SIMULATOR_PROCESSING_ODOMETRY_DRIFT_SIMULATOR_RANDOM_ENGINE_H_
+#define UNREAL_AIRSIM_SIMULATOR_PROCESSING_ODOMETRY_DRIFT_SIMULATOR_RANDOM_ENGINE_H_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace unreal_airsim {
+/***
+ * xoshiro256++ pseudo random number generator (Blackman and Vigna), seeded
+ * via splitmix64. It is small enough to be kept per instance, s.t. every
+ * noise source has its own reproducible stream, and about an order of
+ * magnitude faster than std::mt19937. Independent streams for the same seed,
+ * e.g. for parallel Monte-Carlo realizations, are derived with jump().
+ * Satisfies UniformRandomBitGenerator, so it also works with <random>.
+ */
+class RandomEngine {
+ public:
+  using result_type = uint64_t;
+
+  explicit RandomEngine(uint64_t seed = 0, uint64_t stream = 0) {
+    this->seed(seed);
+    for (uint64_t i = 0; i < stream; ++i) {
+      jump();
+    }
+  }
+
+  void seed(uint64_t seed) {
+    uint64_t x = seed;
+    for (uint64_t& s : state_) {
+      s = splitmix64(&x);
+    }
+    has_cached_normal_ = false;
+  }
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  result_type operator()() {
+    const uint64_t result = rotl(state_[0] + state_[3], 23) + state_[0];
+    const uint64_t t = state_[1] << 17;
+    state_[2] ^= state_[0];
+    state_[3] ^= state_[1];
+    state_[1] ^= state_[2];
+    state_[0] ^= state_[3];
+    state_[2] ^= t;
+    state_[3] = rotl(state_[3], 45);
+    return result;
+  }
+
+  // Advance by 2^128 draws, equivalent to starting a non-overlapping stream.
+  void jump() {
+    static constexpr uint64_t kJump[] = {
+        0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa,
+        0x39abdc4529b1661c};
+    uint64_t s[4] = {0, 0, 0, 0};
+    for (uint64_t jump : kJump) {
+      for (int b = 0; b < 64; ++b) {
+        if (jump & (uint64_t{1} << b)) {
+          for (int i = 0; i < 4; ++i) {
+            s[i] ^= state_[i];
+          }
+        }
+        operator()();
+      }
+    }
+    for (int i = 0; i < 4; ++i) {
+      state_[i] = s[i];
+    }
+    has_cached_normal_ = false;
+  }
+
+  // Uniform sample in [0, 1) with 53 bit resolution.
+  double uniform() { return (operator()() >> 11) * 0x1.0p-53; }
+
+  // Standard normal samples via Box-Muller, which yields them in pairs.
+  double standardNormal() {
+    if (has_cached_normal_) {
+      has_cached_normal_ = false;
+      return cached_normal_;
+    }
+    double samples[2];
+    boxMuller(samples);
+    cached_normal_ = samples[1];
+    has_cached_normal_ = true;
+    return samples[0];
+  }
+
+  // Fill n standard normal samples. The spare sample of a pair is kept for
+  // the next draw, s.t. this yields the same sequence as n calls to
+  // standardNormal().
+  void fillStandardNormal(double* samples, size_t n) {
+    size_t i = 0;
+    if (has_cached_normal_ && n > 0) {
+      has_cached_normal_ = false;
+      samples[i++] = cached_normal_;
+    }
+    for (; i + 1 < n; i += 2) {
+      boxMuller(samples + i);
+    }
+    if (i < n) {
+      samples[i] = standardNormal();
+    }
+  }
+
+ private:
+  uint64_t state_[4];
+  double cached_normal_ = 0.0;
+  bool has_cached_normal_ = false;
+
+  static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+  static uint64_t splitmix64(uint64_t* x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+  }
+
+  void boxMuller(double* pair) {
+    const double u1 = 1.0 - uniform();  // (0, 1], avoid log(0)
+    const double u2 = uniform();
+    const double radius = std::sqrt(-2.0 * std::log(u1));
+    const double angle = 2.0 * M_PI * u2;
+    pair[0] = radius * std::cos(angle);
+    pair[1] = radius * std::sin(angle);
+  }
+};
+}  // namespace unreal_airsim
+
+#endif  // UNREAL_AIRSIM_SIMULATOR_PROCESSING_ODOMETRY_DRIFT_SIMULATOR_RANDOM_ENGINE_H_
@@ -1,11 +1,17 @@
 #ifndef UNREAL_AIRSIM_SIMULATOR_PROCESSING_PROCESSOR_BASE_H_
 #define UNREAL_AIRSIM_SIMULATOR_PROCESSING_PROCESSOR_BASE_H_
 
+#include "unreal_airsim/online_simulator/frame_dispatcher.h"
+#include "unreal_airsim/online_simulator/message_pool.h"
+#include "unreal_airsim/simulator_processing/processor_executor.h"
 #include "unreal_airsim/simulator_processing/processor_factory.h"
 
 #include <ros/ros.h>
+#include <sensor_msgs/Image.h>
 
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace unreal_airsim {
 class AirsimSimulator;
@@ -16,17 +22,59 @@ namespace simulator_processor {
 class ProcessorBase {
  public:
   ProcessorBase() = default;
-  virtual ~ProcessorBase() = default;
+  virtual ~ProcessorBase();
 
+  // The node handle uses the processor's own callback queue, which is
+  // executed once the setup succeeded, see ProcessorExecutor.
   virtual bool setupFromRos(
       const ros::NodeHandle& nh,
       const std::string& ns) = 0;  // params can be retrieved as ns+param_name
 
+  // Stop the executor and wait for running callbacks. Needs to be called
+  // before derived members are destroyed that the callbacks may still use.
+  void stopExecutor();
+
+  // Accessors
+  const std::string& getName() const { return name_; }
+  ProcessorExecutor* getExecutor() { return executor_.get(); }
+
+  // The resolved image topics this processor consumes and produces, these
+  // define the processing graph.
+  const std::vector<std::string>& getInputTopics() const {
+    return input_topics_;
+  }
+  const std::vector<std::string>& getOutputTopics() const {
+    return output_topics_;
+  }
+
+  // Of the message pools of the processor's outputs, if any.
+  virtual MessagePoolStatistics getAndResetPoolStatistics() {
+    return MessagePoolStatistics();
+  }
+
  protected:
   // these fields are set by the factory
   friend ProcessorFactory;
   AirsimSimulator* parent_;
   std::string name_;
+  std::unique_ptr<ProcessorExecutor> executor_;
+  bool setupExecutor(const ros::NodeHandle& nh, const std::string& ns);
+
+  // Image in- and outputs. If the source of a subscribed topic runs in this
+  // process, frames are passed on directly without ROS transport, see
+  // FrameDispatcher. Outputs are only published via ROS if subscribed to.
+  // Subscribe only once the setup succeeded, as the callbacks are kept.
+  void subscribeImage(const ros::NodeHandle& nh, const std::string& topic,
+                      uint32_t queue_size,
+                      const FrameDispatcher::ImageCallback& callback);
+  ros::Publisher advertiseImage(ros::NodeHandle* nh, const std::string& topic,
+                                uint32_t queue_size);
+  void publishImage(const ros::Publisher& publisher,
+                    const sensor_msgs::ImagePtr& msg) const;
+
+ private:
+  std::vector<std::string> input_topics_;
+  std::vector<std::string> output_topics_;
 };
 
 }  // namespace simulator_processor
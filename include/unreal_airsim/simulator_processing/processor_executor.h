@@ -0,0 +1,101 @@
+#ifndef UNREAL_AIRSIM_SIMULATOR_PROCESSING_PROCESSOR_EXECUTOR_H_
+#define UNREAL_AIRSIM_SIMULATOR_PROCESSING_PROCESSOR_EXECUTOR_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ros/callback_queue_interface.h>
+#include <ros/ros.h>
+
+#include "unreal_airsim/simulator_processing/work_stealing_pool.h"
+
+namespace unreal_airsim::simulator_processor {
+
+/***
+ * The callback queue of a single processor, s.t. slow processors can not
+ * delay the simulator state and sensor callbacks on the global queue or other
+ * processors. By default the callbacks run one at a time as a stage on the
+ * shared processing pool, so independent processors run in parallel and
+ * frames handed to a downstream processor are picked up by the same worker.
+ * Alternatively, the processor gets its own (optionally pinned) threads.
+ */
+class ProcessorExecutor : public ros::CallbackQueueInterface {
+ public:
+  struct Config {
+    // Initialize from ROS params
+    static Config fromRosParams(const ros::NodeHandle& nh,
+                                const std::string& ns);
+
+    // Dedicated threads, 0 runs on the shared pool. Processors need to be
+    // thread safe if > 1. Defaults to 1 if a cpu_affinity is set.
+    int num_threads = 0;
+    std::vector<int> cpu_affinity;  // Pin threads to these cores if set.
+
+    bool isValid(const std::string& error_msg_prefix = "") const;
+  };
+
+  // Execution times of the callbacks since the last reset.
+  struct Statistics {
+    size_t num_calls = 0;
+    double total_time = 0.0;  // s
+    double max_time = 0.0;    // s
+  };
+
+  ProcessorExecutor(const Config& config, const std::string& name,
+                    WorkStealingPool* pool);
+  ~ProcessorExecutor() override;
+
+  ros::CallbackQueueInterface* getCallbackQueue() { return this; }
+  const Config& getConfig() const { return config_; }
+  bool usesSharedPool() const { return config_.num_threads == 0; }
+  Statistics getAndResetStatistics();
+
+  void start();
+  void stop();
+
+  // ros::CallbackQueueInterface
+  void addCallback(const ros::CallbackInterfacePtr& callback,
+                   uint64_t owner_id) override;
+  void removeByID(uint64_t owner_id) override;
+
+ private:
+  struct Entry {
+    ros::CallbackInterfacePtr callback;
+    uint64_t owner_id;
+  };
+
+  void threadLoop();
+  void applyCpuAffinity();  // Pins the calling thread.
+  void runOnPool();
+  void retryOnPool();
+  void runCallback(const Entry& entry);
+  void requeueRetries();  // Requires mutex_ to be locked.
+
+  const Config config_;
+  const std::string name_;
+  WorkStealingPool* const pool_;
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Entry> callbacks_;
+  // Callbacks that were not ready. They are retried with the next added
+  // callback, or at the latest after kRetryInterval.
+  std::deque<Entry> retry_callbacks_;
+  static constexpr std::chrono::milliseconds kRetryInterval{10};
+  bool is_running_ = false;
+  bool is_scheduled_ = false;  // Whether a pool task is queued or running.
+  bool is_retry_scheduled_ = false;  // Whether a delayed pool retry is due.
+
+  std::mutex statistics_mutex_;
+  Statistics statistics_;
+};
+
+}  // namespace unreal_airsim::simulator_processor
+
+#endif  // UNREAL_AIRSIM_SIMULATOR_PROCESSING_PROCESSOR_EXECUTOR_H_
@@ -0,0 +1,78 @@
+#ifndef UNREAL_AIRSIM_SIMULATOR_PROCESSING_WORK_STEALING_POOL_H_
+#define UNREAL_AIRSIM_SIMULATOR_PROCESSING_WORK_STEALING_POOL_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace unreal_airsim::simulator_processor {
+
+/***
+ * Thread pool shared by the simulator processors. Every worker owns a task
+ * deque. Tasks submitted from a worker are pushed onto its own deque and
+ * popped LIFO, s.t. a stage handing a frame to the next stage keeps working
+ * on warm data. Idle workers steal the oldest tasks from the other workers
+ * and sleep if all deques are empty.
+ */
+class WorkStealingPool {
+ public:
+  using Task = std::function<void()>;
+  using Clock = std::chrono::steady_clock;
+
+  // num_threads <= 0 uses the number of available cores.
+  explicit WorkStealingPool(int num_threads);
+  virtual ~WorkStealingPool();
+
+  // Submit a task for execution, this is thread safe.
+  void submit(Task task);
+
+  // Submit a task for execution once the delay passed, this is thread safe.
+  // Tasks that are not due when the pool is destroyed are dropped.
+  void submitAfter(Clock::duration delay, Task task);
+
+  int getNumThreads() const { return static_cast<int>(workers_.size()); }
+
+ private:
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+    // Mirrors tasks.size(), s.t. empty queues can be skipped without locking
+    // them. Only modified while holding the mutex.
+    std::atomic<size_t> size{0};
+  };
+
+  void workerLoop(size_t index);
+  void timerLoop();
+  bool popTask(size_t index, Task* task);
+  bool hasQueuedTasks() const;
+  size_t getNumQueuedTasks() const;
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  std::vector<std::thread> workers_;
+  std::atomic<size_t> next_queue_;  // Round robin for external submissions.
+  std::atomic<bool> is_running_;
+
+  // Sleeping workers. A worker registers as sleeping before checking the
+  // queues a last time and submit() checks for sleepers after publishing the
+  // task, s.t. either the worker finds the task or it gets woken up.
+  std::mutex wake_mutex_;
+  std::condition_variable wake_cv_;
+  std::atomic<size_t> num_sleeping_;
+
+  // Delayed tasks, ordered by due time.
+  std::mutex timer_mutex_;
+  std::condition_variable timer_cv_;
+  std::multimap<Clock::time_point, Task> delayed_tasks_;  // timer_mutex_
+  std::thread timer_thread_;
+};
+
+}  // namespace unreal_airsim::simulator_processor
+
+#endif  // UNREAL_AIRSIM_SIMULATOR_PROCESSING_WORK_STEALING_POOL_H_
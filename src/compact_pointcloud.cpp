@@ -0,0 +1,239 @@
+#include "unreal_airsim/compact_pointcloud.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include <glog/logging.h>
+
+namespace unreal_airsim::compact_pointcloud {
+
+namespace {
+constexpr int32_t kMaxQuantizedValue = std::numeric_limits<int16_t>::max();
+
+const sensor_msgs::PointField* findField(
+    const sensor_msgs::PointCloud2& cloud, const std::string& name) {
+  for (const auto& field : cloud.fields) {
+    if (field.name == name) {
+      return &field;
+    }
+  }
+  return nullptr;
+}
+
+sensor_msgs::PointField makeField(const std::string& name, uint32_t offset,
+                                  uint8_t datatype, uint32_t count = 1) {
+  sensor_msgs::PointField field;
+  field.name = name;
+  field.offset = offset;
+  field.datatype = datatype;
+  field.count = count;
+  return field;
+}
+
+template <typename T>
+inline T read(const uint8_t* data) {
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+template <typename T>
+inline void write(uint8_t* data, T value) {
+  std::memcpy(data, &value, sizeof(T));
+}
+}  // namespace
+
+bool isCompact(const sensor_msgs::PointCloud2& cloud, float* resolution) {
+  for (const auto& field : cloud.fields) {
+    if (field.count == 0 &&
+        field.name.compare(0, kResolutionFieldPrefix.size(),
+                           kResolutionFieldPrefix) == 0) {
+      float value = std::strtof(
+          field.name.c_str() + kResolutionFieldPrefix.size(), nullptr);
+      if (!(value > 0.f)) {
+        return false;
+      }
+      if (resolution) {
+        *resolution = value;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+bool encode(const sensor_msgs::PointCloud2& cloud, float resolution,
+            sensor_msgs::PointCloud2* compact,
+            EncodingStatistics* statistics) {
+  CHECK_NOTNULL(compact);
+  if (!(resolution > 0.f)) {
+    LOG(ERROR) << "The compact point cloud resolution must be positive.";
+    return false;
+  }
+  const sensor_msgs::PointField* x_field = findField(cloud, "x");
+  const sensor_msgs::PointField* y_field = findField(cloud, "y");
+  const sensor_msgs::PointField* z_field = findField(cloud, "z");
+  if (!x_field || !y_field || !z_field ||
+      x_field->datatype != sensor_msgs::PointField::FLOAT32 ||
+      y_field->datatype != sensor_msgs::PointField::FLOAT32 ||
+      z_field->datatype != sensor_msgs::PointField::FLOAT32 ||
+      cloud.is_bigendian) {
+    LOG(ERROR) << "Compact encoding requires little endian FLOAT32 'x', 'y', "
+                  "'z' fields.";
+    return false;
+  }
+  const sensor_msgs::PointField* rgb_field = findField(cloud, "rgb");
+  const sensor_msgs::PointField* id_field = findField(cloud, "id");
+
+  // Setup the compact layout.
+  std::ostringstream resolution_name;
+  resolution_name.precision(std::numeric_limits<float>::max_digits10);
+  resolution_name << kResolutionFieldPrefix << resolution;
+  compact->header = cloud.header;
+  compact->height = 1;
+  compact->is_bigendian = false;
+  compact->is_dense = true;
+  compact->fields.clear();
+  compact->fields.push_back(makeField("x", 0, sensor_msgs::PointField::INT16));
+  compact->fields.push_back(makeField("y", 2, sensor_msgs::PointField::INT16));
+  compact->fields.push_back(makeField("z", 4, sensor_msgs::PointField::INT16));
+  uint32_t offset = 6;
+  const uint32_t rgb_offset = offset;
+  if (rgb_field) {
+    compact->fields.push_back(
+        makeField("b", offset++, sensor_msgs::PointField::UINT8));
+    compact->fields.push_back(
+        makeField("g", offset++, sensor_msgs::PointField::UINT8));
+    compact->fields.push_back(
+        makeField("r", offset++, sensor_msgs::PointField::UINT8));
+  }
+  const uint32_t id_offset = offset;
+  if (id_field) {
+    compact->fields.push_back(
+        makeField("id", offset++, sensor_msgs::PointField::UINT8));
+  }
+  compact->fields.push_back(makeField(resolution_name.str(), 0,
+                                      sensor_msgs::PointField::UINT8, 0));
+  compact->point_step = offset;
+
+  // Quantize all points.
+  const size_t num_points = cloud.width * cloud.height;
+  compact->data.resize(num_points * compact->point_step);
+  const float inv_resolution = 1.f / resolution;
+  float max_error_squared = 0.f;
+  size_t num_encoded = 0;
+  for (size_t i = 0; i < num_points; ++i) {
+    const uint8_t* in = cloud.data.data() + i * cloud.point_step;
+    const float p[3] = {read<float>(in + x_field->offset),
+                        read<float>(in + y_field->offset),
+                        read<float>(in + z_field->offset)};
+    int32_t q[3];
+    bool is_valid = true;
+    for (int d = 0; d < 3; ++d) {
+      if (!std::isfinite(p[d])) {
+        is_valid = false;
+        break;
+      }
+      const float scaled = std::round(p[d] * inv_resolution);
+      if (std::fabs(scaled) > kMaxQuantizedValue) {
+        is_valid = false;
+        break;
+      }
+      q[d] = static_cast<int32_t>(scaled);
+    }
+    if (!is_valid) {
+      continue;
+    }
+    float error_squared = 0.f;
+    for (int d = 0; d < 3; ++d) {
+      const float error = q[d] * resolution - p[d];
+      error_squared += error * error;
+    }
+    max_error_squared = std::max(max_error_squared, error_squared);
+
+    uint8_t* out = compact->data.data() + num_encoded * compact->point_step;
+    write<int16_t>(out, q[0]);
+    write<int16_t>(out + 2, q[1]);
+    write<int16_t>(out + 4, q[2]);
+    if (rgb_field) {
+      // Packed rgb is stored as b, g, r, (a) in little endian.
+      std::memcpy(out + rgb_offset, in + rgb_field->offset, 3);
+    }
+    if (id_field) {
+      out[id_offset] = in[id_field->offset];
+    }
+    num_encoded++;
+  }
+  compact->width = num_encoded;
+  compact->row_step = compact->width * compact->point_step;
+  compact->data.resize(compact->row_step);
+
+  if (statistics) {
+    statistics->num_points = num_encoded;
+    statistics->num_dropped = num_points - num_encoded;
+    statistics->max_error = std::sqrt(max_error_squared);
+    statistics->error_bound = std::sqrt(3.f) / 2.f * resolution;
+  }
+  return true;
+}
+
+bool decode(const sensor_msgs::PointCloud2& compact,
+            sensor_msgs::PointCloud2* cloud) {
+  CHECK_NOTNULL(cloud);
+  float resolution;
+  if (!isCompact(compact, &resolution)) {
+    LOG(ERROR) << "The point cloud does not use the compact encoding.";
+    return false;
+  }
+  const sensor_msgs::PointField* b_field = findField(compact, "b");
+  const sensor_msgs::PointField* id_field = findField(compact, "id");
+
+  // Setup the decoded layout.
+  cloud->header = compact.header;
+  cloud->height = 1;
+  cloud->width = compact.width * compact.height;
+  cloud->is_bigendian = false;
+  cloud->is_dense = compact.is_dense;
+  cloud->fields.clear();
+  cloud->fields.push_back(makeField("x", 0, sensor_msgs::PointField::FLOAT32));
+  cloud->fields.push_back(makeField("y", 4, sensor_msgs::PointField::FLOAT32));
+  cloud->fields.push_back(makeField("z", 8, sensor_msgs::PointField::FLOAT32));
+  uint32_t offset = 12;
+  const uint32_t rgb_offset = offset;
+  if (b_field) {
+    cloud->fields.push_back(
+        makeField("rgb", offset, sensor_msgs::PointField::FLOAT32));
+    offset += 4;
+  }
+  const uint32_t id_offset = offset;
+  if (id_field) {
+    cloud->fields.push_back(
+        makeField("id", offset++, sensor_msgs::PointField::UINT8));
+  }
+  cloud->point_step = offset;
+  cloud->row_step = cloud->width * cloud->point_step;
+  cloud->data.assign(cloud->row_step, 0);
+
+  for (size_t i = 0; i < cloud->width; ++i) {
+    const uint8_t* in = compact.data.data() + i * compact.point_step;
+    uint8_t* out = cloud->data.data() + i * cloud->point_step;
+    write<float>(out, read<int16_t>(in) * resolution);
+    write<float>(out + 4, read<int16_t>(in + 2) * resolution);
+    write<float>(out + 8, read<int16_t>(in + 4) * resolution);
+    if (b_field) {
+      std::memcpy(out + rgb_offset, in + b_field->offset, 3);
+    }
+    if (id_field) {
+      out[id_offset] = in[id_field->offset];
+    }
+  }
+  return true;
+}
+
+}  // namespace unreal_airsim::compact_pointcloud
@@ -4,23 +4,84 @@
 #include <cmath>
 
 namespace unreal_airsim {
+namespace {
+// Yaw only matrices do not couple z with x and y.
+template <typename Scalar>
+void transformPoints(const Eigen::Matrix<Scalar, 3, 3>& matrix, bool yaw_only,
+                     Eigen::Matrix<Scalar, 3, 1>* points, size_t num_points) {
+  if (yaw_only) {
+    const Scalar m00 = matrix(0, 0), m01 = matrix(0, 1);
+    const Scalar m10 = matrix(1, 0), m11 = matrix(1, 1);
+    const Scalar m22 = matrix(2, 2);
+    for (size_t i = 0; i < num_points; ++i) {
+      const Scalar x = points[i].x();
+      const Scalar y = points[i].y();
+      points[i].x() = m00 * x + m01 * y;
+      points[i].y() = m10 * x + m11 * y;
+      points[i].z() *= m22;
+    }
+    return;
+  }
+  for (size_t i = 0; i < num_points; ++i) {
+    points[i] = matrix * points[i];
+  }
+}
+
+template <typename Scalar>
+void invertAxes(Eigen::Matrix<Scalar, 3, 1>* points, size_t num_points) {
+  for (size_t i = 0; i < num_points; ++i) {
+    points[i].y() = -points[i].y();
+    points[i].z() = -points[i].z();
+  }
+}
+
+void mirrorAndNormalize(Eigen::Quaterniond* orientation) {
+  // This defines a mirroring of q on the YZ-plane.
+  orientation->y() = -orientation->y();
+  orientation->z() = -orientation->z();
+  orientation->normalize();
+}
+}  // namespace
 
 FrameConverter::FrameConverter() { reset(); }
 
 void FrameConverter::reset() {
   rotation_ = Eigen::Matrix3d::Identity();
   rot_inverse_ = Eigen::Matrix3d::Identity();
+  updateBatchConversions();
 }
 
 void FrameConverter::setupFromYaw(double yaw) {
   double yaw_offset = std::fmod(yaw, 2.0 * M_PI);
   rotation_ = Eigen::AngleAxisd(yaw_offset, Eigen::Vector3d::UnitZ());
   rot_inverse_ = rotation_.inverse();
+  updateBatchConversions();
 }
 
 void FrameConverter::setupFromQuat(const Eigen::Quaterniond& quat) {
   rotation_ = quat;
   rot_inverse_ = rotation_.inverse();
+  updateBatchConversions();
+}
+
+void FrameConverter::updateBatchConversions() {
+  const Eigen::Matrix3d axes = Eigen::Vector3d(1.0, -1.0, -1.0).asDiagonal();
+  airsim_to_ros_ = rotation_ * axes;
+  ros_to_airsim_ = axes * rot_inverse_;
+  airsim_to_ros_float_ = airsim_to_ros_.cast<float>();
+  ros_to_airsim_float_ = ros_to_airsim_.cast<float>();
+  rotation_quat_ = Eigen::Quaterniond(rotation_).normalized();
+  rot_inverse_quat_ = rotation_quat_.conjugate();
+
+  // The simulation frame is usually initialized from a (snapped) yaw.
+  constexpr double kTolerance = 1e-9;
+  if (rotation_.isIdentity(kTolerance)) {
+    structure_ = Structure::kAxesOnly;
+  } else if (std::fabs(rotation_(2, 2) - 1.0) < kTolerance) {
+    structure_ = Structure::kYawOnly;
+  } else {
+    structure_ = Structure::kGeneral;
+  }
 }
 
 void FrameConverter::transformPointAirsimToRos(double* x, double* y,
@@ -133,4 +194,77 @@ void FrameConverter::rosToAirsim(geometry_msgs::Pose* pose) const {
   rosToAirsim(&(pose->orientation));
 }
 
+// Batch interfaces
+
+void FrameConverter::airsimToRos(Eigen::Vector3f* points,
+                                 size_t num_points) const {
+  if (structure_ == Structure::kAxesOnly) {
+    invertAxes(points, num_points);
+  } else {
+    transformPoints(airsim_to_ros_float_, structure_ == Structure::kYawOnly,
+                    points, num_points);
+  }
+}
+
+void FrameConverter::airsimToRos(Eigen::Vector3d* points,
+                                 size_t num_points) const {
+  if (structure_ == Structure::kAxesOnly) {
+    invertAxes(points, num_points);
+  } else {
+    transformPoints(airsim_to_ros_, structure_ == Structure::kYawOnly, points,
+                    num_points);
+  }
+}
+
+void FrameConverter::airsimToRos(Eigen::Quaterniond* orientations,
+                                 size_t num_orientations) const {
+  for (size_t i = 0; i < num_orientations; ++i) {
+    mirrorAndNormalize(&orientations[i]);
+  }
+  if (structure_ != Structure::kAxesOnly) {
+    for (size_t i = 0; i < num_orientations; ++i) {
+      orientations[i] = rotation_quat_ * orientations[i];
+    }
+  }
+}
+
+void FrameConverter::rosToAirsim(Eigen::Vector3f* points,
+                                 size_t num_points) const {
+  if (structure_ == Structure::kAxesOnly) {
+    invertAxes(points, num_points);
+  } else {
+    transformPoints(ros_to_airsim_float_, structure_ == Structure::kYawOnly,
+                    points, num_points);
+  }
+}
+
+void FrameConverter::rosToAirsim(Eigen::Vector3d* points,
+                                 size_t num_points) const {
+  if (structure_ == Structure::kAxesOnly) {
+    invertAxes(points, num_points);
+  } else {
+    transformPoints(ros_to_airsim_, structure_ == Structure::kYawOnly, points,
+                    num_points);
+  }
+}
+
+void FrameConverter::rosToAirsim(Eigen::Quaterniond* orientations,
+                                 size_t num_orientations) const {
+  if (structure_ != Structure::kAxesOnly) {
+    for (size_t i = 0; i < num_orientations; ++i) {
+      orientations[i] = rot_inverse_quat_ * orientations[i];
+    }
+  }
+  for (size_t i = 0; i < num_orientations; ++i) {
+    mirrorAndNormalize(&orientations[i]);
+  }
+}
+
+void FrameConverter::airsimAxesToRos(float* xyz, size_t num_points) {
+  for (size_t i = 0; i < 3 * num_points; i += 3) {
+    xyz[i + 1] = -xyz[i + 1];
+    xyz[i + 2] = -xyz[i + 2];
+  }
+}
+
 }  // namespace unreal_airsim
@@ -0,0 +1,88 @@
+#include "unreal_airsim/online_simulator/camera_info_cache.h"
+
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace unreal_airsim {
+namespace {
+const char kHeader[] = "unreal_airsim_camera_info_cache_v1";
+}  // namespace
+
+CameraInfoCache::CameraInfoCache(const std::string& file_path)
+    : file_path_(file_path) {}
+
+bool CameraInfoCache::load(uint64_t key, CameraInfoMap* infos) const {
+  // Format: header, key, then one line per camera as 'name px py pz qw qx qy
+  // qz fov' followed by the 16 entries of the projection matrix.
+  std::ifstream file(file_path_);
+  if (!file.is_open()) {
+    return false;
+  }
+  std::string header;
+  uint64_t file_key;
+  if (!(file >> header >> file_key) || header != kHeader || file_key != key) {
+    return false;
+  }
+  CameraInfoMap result;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    std::istringstream values(line);
+    std::string name;
+    msr::airlib::CameraInfo info;
+    float w, x, y, z;
+    values >> name >> info.pose.position.x() >> info.pose.position.y() >>
+        info.pose.position.z() >> w >> x >> y >> z >> info.fov;
+    for (auto& row : info.proj_mat.matrix) {
+      for (float& value : row) {
+        values >> value;
+      }
+    }
+    if (values.fail()) {
+      return false;
+    }
+    info.pose.orientation = msr::airlib::Quaternionr(w, x, y, z);
+    result[name] = info;
+  }
+  *infos = std::move(result);
+  return true;
+}
+
+bool CameraInfoCache::save(uint64_t key, const CameraInfoMap& infos) const {
+  std::ofstream file(file_path_, std::ios::trunc);
+  if (!file.is_open()) {
+    return false;
+  }
+  file.precision(std::numeric_limits<float>::max_digits10);
+  file << kHeader << "\n" << key << "\n";
+  for (const auto& name_info : infos) {
+    const msr::airlib::CameraInfo& info = name_info.second;
+    file << name_info.first << " " << info.pose.position.x() << " "
+         << info.pose.position.y() << " " << info.pose.position.z() << " "
+         << info.pose.orientation.w() << " " << info.pose.orientation.x()
+         << " " << info.pose.orientation.y() << " "
+         << info.pose.orientation.z() << " " << info.fov;
+    for (const auto& row : info.proj_mat.matrix) {
+      for (float value : row) {
+        file << " " << value;
+      }
+    }
+    file << "\n";
+  }
+  return static_cast<bool>(file);
+}
+
+uint64_t CameraInfoCache::computeKey(const std::string& settings) {
+  uint64_t hash = 14695981039346656037ull;
+  for (const char c : settings) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+}  // namespace unreal_airsim
@@ -0,0 +1,39 @@
+#include "unreal_airsim/online_simulator/command_channel.h"
+
+#include <algorithm>
+
+namespace unreal_airsim {
+
+CommandChannel::CommandChannel(const Config& config, const ros::NodeHandle& nh)
+    : config_(config), nh_(nh), spinner_(1, &queue_) {
+  latency_pub_ = nh_.advertise<std_msgs::Float32>("command_latency", 10);
+}
+
+CommandChannel::~CommandChannel() { stop(); }
+
+void CommandChannel::start() { spinner_.start(); }
+
+void CommandChannel::stop() {
+  // Waits for a running command to finish.
+  spinner_.stop();
+}
+
+CommandChannel::Statistics CommandChannel::getAndResetStatistics() {
+  std::lock_guard<std::mutex> lock(statistics_mutex_);
+  Statistics result = statistics_;
+  statistics_ = Statistics();
+  return result;
+}
+
+void CommandChannel::recordExecuted(double latency) {
+  std::lock_guard<std::mutex> lock(statistics_mutex_);
+  statistics_.num_executed++;
+  statistics_.total_latency += latency;
+  statistics_.max_latency = std::max(statistics_.max_latency, latency);
+}
+
+void CommandChannel::recordDropped() {
+  std::lock_guard<std::mutex> lock(statistics_mutex_);
+  statistics_.num_dropped++;
+}
+}  // namespace unreal_airsim
@@ -0,0 +1,124 @@
+#include "unreal_airsim/online_simulator/connection_supervisor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <string>
+#include <utility>
+
+#include <glog/logging.h>
+
+namespace unreal_airsim {
+namespace {
+std::chrono::milliseconds toDuration(double seconds) {
+  return std::chrono::milliseconds(static_cast<int64_t>(seconds * 1000.0));
+}
+}  // namespace
+
+ConnectionSupervisor::ConnectionSupervisor(const Config& config, Hooks hooks)
+    : config_(config),
+      hooks_(std::move(hooks)),
+      is_running_(false),
+      disconnect_reported_(false),
+      is_connected_(true),
+      num_reconnects_(0) {}
+
+ConnectionSupervisor::~ConnectionSupervisor() { stop(); }
+
+void ConnectionSupervisor::start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (is_running_) {
+    return;
+  }
+  is_running_ = true;
+  thread_ = std::thread(&ConnectionSupervisor::run, this);
+}
+
+void ConnectionSupervisor::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!is_running_) {
+      return;
+    }
+    is_running_ = false;
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void ConnectionSupervisor::reportDisconnect(const std::string& source) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (disconnect_reported_ || !is_connected_) {
+      return;
+    }
+    disconnect_reported_ = true;
+    reported_source_ = source;
+  }
+  cv_.notify_all();
+}
+
+void ConnectionSupervisor::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (is_running_) {
+    cv_.wait_for(lock, toDuration(config_.check_interval),
+                 [this]() { return !is_running_ || disconnect_reported_; });
+    if (!is_running_) {
+      break;
+    }
+    const std::string source = disconnect_reported_ ? reported_source_ : "";
+    lock.unlock();
+    bool is_connected = false;
+    try {
+      is_connected = hooks_.is_connected();
+    } catch (const std::exception&) {
+      is_connected = false;
+    }
+    if (!is_connected) {
+      handleDisconnect(source);
+    } else if (!source.empty()) {
+      LOG(WARNING) << "RPC failed (" << source
+                   << ") but the Airsim server is still connected.";
+    }
+    lock.lock();
+    disconnect_reported_ = false;
+  }
+}
+
+void ConnectionSupervisor::handleDisconnect(const std::string& source) {
+  is_connected_ = false;
+  LOG(WARNING) << "Lost the connection to the Airsim server"
+               << (source.empty() ? "" : " (" + source + ")")
+               << ", pausing the simulation and reconnecting.";
+  hooks_.pause();
+  double backoff = config_.initial_backoff;
+  int attempt = 0;
+  while (true) {
+    attempt++;
+    bool success = false;
+    try {
+      success = hooks_.reconnect();
+    } catch (const std::exception& e) {
+      LOG(WARNING) << "Reconnecting failed: " << e.what();
+    }
+    if (success) {
+      break;
+    }
+    LOG(WARNING) << "Reconnection attempt " << attempt << " failed, retrying "
+                 << "in " << backoff << "s.";
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait_for(lock, toDuration(backoff), [this]() { return !is_running_; });
+    if (!is_running_) {
+      return;
+    }
+    backoff = std::min(2.0 * backoff, config_.max_backoff);
+  }
+  hooks_.resume();
+  is_connected_ = true;
+  num_reconnects_++;
+  LOG(INFO) << "Reconnected to the Airsim server after " << attempt
+            << " attempt(s), resuming the simulation.";
+}
+}  // namespace unreal_airsim
@@ -0,0 +1,120 @@
+#include "unreal_airsim/online_simulator/frame_dispatcher.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+#include <boost/function.hpp>
+#include <boost/make_shared.hpp>
+#include <glog/logging.h>
+
+namespace unreal_airsim {
+
+void FrameDispatcher::advertise(const ros::Publisher& publisher) {
+  advertise(publisher.getTopic());
+}
+
+void FrameDispatcher::advertise(const std::string& resolved_topic) {
+  CHECK(!is_connected_) << "FrameDispatcher: advertise() after connect().";
+  produced_topics_.insert(resolved_topic);
+}
+
+void FrameDispatcher::subscribe(const ros::NodeHandle& nh,
+                                const std::string& topic, uint32_t queue_size,
+                                const ImageCallback& callback) {
+  CHECK(!is_connected_) << "FrameDispatcher: subscribe() after connect().";
+  Subscription subscription;
+  subscription.nh = nh;
+  subscription.topic = nh.resolveName(topic);
+  subscription.queue_size = queue_size;
+  subscription.callback = callback;
+  subscriptions_.push_back(subscription);
+}
+
+void FrameDispatcher::connect() {
+  for (Subscription& subscription : subscriptions_) {
+    if (inline_processing_ &&
+        produced_topics_.find(subscription.topic) != produced_topics_.end()) {
+      auto inline_subscription = std::make_shared<InlineSubscription>();
+      inline_subscription->callback = subscription.callback;
+      inline_subscription->callback_queue =
+          subscription.nh.getCallbackQueue();
+      inline_subscription->queue_size =
+          std::max(subscription.queue_size, 1u);
+      inline_subscriptions_[subscription.topic].push_back(
+          std::move(inline_subscription));
+      VLOG(1) << "FrameDispatcher: '" << subscription.topic
+              << "' is consumed in-process.";
+    } else {
+      subscription.subscriber =
+          subscription.nh
+              .subscribe<sensor_msgs::Image, const sensor_msgs::ImagePtr&>(
+                  subscription.topic, subscription.queue_size,
+                  boost::function<void(const sensor_msgs::ImagePtr&)>(
+                      subscription.callback));
+    }
+  }
+  is_connected_ = true;
+}
+
+bool FrameDispatcher::hasInlineSubscribers(
+    const ros::Publisher& publisher) const {
+  return hasInlineSubscribers(publisher.getTopic());
+}
+
+bool FrameDispatcher::hasInlineSubscribers(
+    const std::string& resolved_topic) const {
+  return inline_subscriptions_.find(resolved_topic) !=
+         inline_subscriptions_.end();
+}
+
+bool FrameDispatcher::hasSubscribers(const ros::Publisher& publisher) const {
+  return publisher.getNumSubscribers() > 0 || hasInlineSubscribers(publisher);
+}
+
+void FrameDispatcher::dispatch(const ros::Publisher& publisher,
+                               const sensor_msgs::ImagePtr& msg) const {
+  dispatchInline(publisher.getTopic(), msg);
+  if (publisher.getNumSubscribers() > 0) {
+    publisher.publish(msg);
+  }
+}
+
+void FrameDispatcher::dispatchInline(const std::string& resolved_topic,
+                                     const sensor_msgs::ImagePtr& msg) const {
+  auto it = inline_subscriptions_.find(resolved_topic);
+  if (it != inline_subscriptions_.end()) {
+    for (const std::shared_ptr<InlineSubscription>& subscription :
+         it->second) {
+      std::lock_guard<std::mutex> lock(subscription->mutex);
+      subscription->frames.push_back(msg);
+      if (subscription->frames.size() > subscription->queue_size) {
+        // The callback of the dropped frame will consume the newest one.
+        subscription->frames.pop_front();
+        LOG_EVERY_N(WARNING, 100)
+            << "FrameDispatcher: consumer of '" << resolved_topic
+            << "' can not keep up, dropped frames.";
+      } else {
+        subscription->callback_queue->addCallback(
+            boost::make_shared<InlineFrameCallback>(subscription));
+      }
+    }
+  }
+}
+
+ros::CallbackInterface::CallResult
+FrameDispatcher::InlineFrameCallback::call() {
+  sensor_msgs::ImagePtr msg;
+  {
+    std::lock_guard<std::mutex> lock(subscription_->mutex);
+    if (subscription_->frames.empty()) {
+      return Success;
+    }
+    msg = subscription_->frames.front();
+    subscription_->frames.pop_front();
+  }
+  subscription_->callback(msg);
+  return Success;
+}
+
+}  // namespace unreal_airsim
@@ -1,35 +1,55 @@
 #include "unreal_airsim/online_simulator/sensor_timer.h"
 
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
-#include <cv_bridge/cv_bridge.h>
 #include <geometry_msgs/TransformStamped.h>
 #include <glog/logging.h>
+#include <minkindr_conversions/kindr_msg.h>
 #include <sensor_msgs/Image.h>
 #include <sensor_msgs/Imu.h>
 #include <sensor_msgs/PointCloud2.h>
 
+#include "unreal_airsim/compact_pointcloud.h"
 #include "unreal_airsim/online_simulator/simulator.h"
 
 namespace unreal_airsim {
 
 SensorTimer::SensorTimer(const ros::NodeHandle& nh, double rate,
                          bool is_private, const std::string& vehicle_name,
+                         size_t server_index, size_t client_index,
                          AirsimSimulator* parent)
     : nh_(nh),
+      image_transport_(nh),
       is_private_(is_private),
       rate_(rate),
       vehicle_name_(vehicle_name),
+      server_index_(server_index),
+      client_index_(client_index),
       is_shutdown_(false),
       parent_(parent) {
+  createClient();
+  spawn_position_ = Eigen::Vector3d::Zero();
+  for (const auto& vehicle : parent_->getConfig().vehicles) {
+    if (vehicle.name == vehicle_name_) {
+      spawn_position_ = vehicle.spawn_position;
+    }
+  }
+  odometry_drift_simulator_ = parent_->getOdometryDriftSimulator(vehicle_name_);
+  CHECK_NOTNULL(odometry_drift_simulator_);
+  render_mutex_ = parent_->getRenderMutex(server_index_, vehicle_name_);
+  CHECK_NOTNULL(render_mutex_);
   timer_ = nh_.createTimer(ros::Duration(1.0 / rate),
                            &SensorTimer::timerCallback, this);
   if (parent_->getConfig().publish_sensor_transforms) {
     transform_pub_ = nh_.advertise<geometry_msgs::TransformStamped>(
-        parent_->getConfig().vehicle_name + "sensor_ground_truth_transforms",
-        100);
+        vehicle_name_ + "sensor_ground_truth_transforms", 100);
   }
 }
 
@@ -38,12 +58,52 @@ bool SensorTimer::isPrivate() const { return is_private_; }
 
 void SensorTimer::signalShutdown() { is_shutdown_ = true; }
 
+void SensorTimer::trigger() { timerCallback(ros::TimerEvent()); }
+
 void SensorTimer::timerCallback(const ros::TimerEvent&) {
-  processCameras();
-  processLidars();
-  processImus();
+  std::lock_guard<std::mutex> lock(callback_mutex_);
+  if (!isConnected()) {
+    // Don't block on a dead client, the supervisor pauses this timer.
+    parent_->getConnectionSupervisor()->reportDisconnect(
+        "sensor timer client disconnected");
+    return;
+  }
+  try {
+    processCameras();
+    processLidars();
+    processImus();
+  } catch (const std::exception& e) {
+    parent_->getConnectionSupervisor()->reportDisconnect(
+        "sensor timer at " + std::to_string(rate_) + "Hz: " + e.what());
+  }
+}
+
+bool SensorTimer::isConnected() const {
+  return airsim_client_->getConnectionState() ==
+         msr::airlib::RpcLibClientBase::ConnectionState::Connected;
 }
 
+void SensorTimer::createClient() {
+  airsim_client_ = parent_->getSensorClient(server_index_, client_index_);
+}
+
+bool SensorTimer::reconnect() {
+  // AirLib clients can not reconnect, the simulator recreated the pool.
+  std::lock_guard<std::mutex> lock(callback_mutex_);
+  createClient();
+  for (int i = 0; i < 10 && !isConnected(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  return isConnected();
+}
+
+void SensorTimer::pause() {
+  // Stopping the timer waits for a running callback to finish.
+  timer_.stop();
+}
+
+void SensorTimer::resume() { timer_.start(); }
+
 void SensorTimer::addSensor(const AirsimSimulator& simulator,
                             int sensor_index) {
   AirsimSimulator::Config::Sensor* sensor =
@@ -51,7 +111,11 @@ void SensorTimer::addSensor(const AirsimSimulator& simulator,
   if (sensor->sensor_type == AirsimSimulator::Config::Sensor::TYPE_CAMERA) {
     auto camera = (AirsimSimulator::Config::Camera*)sensor;
     camera_pubs_.push_back(
-        nh_.advertise<sensor_msgs::Image>(camera->output_topic, 5));
+        image_transport_.advertiseCamera(camera->output_topic, 5));
+    parent_->getFrameDispatcher()->advertise(camera_pubs_.back().getTopic());
+    camera_publish_queues_.push_back(std::make_shared<CameraPublishQueue>());
+    camera_publish_queues_.back()->publisher = camera_pubs_.back();
+    camera_fovs_.push_back(camera->camera_info.fov);
     camera_frame_names_.push_back(camera->frame_name);
     msr::airlib::ImageCaptureBase::ImageRequest request;
     request.camera_name = camera->name;
@@ -59,12 +123,23 @@ void SensorTimer::addSensor(const AirsimSimulator& simulator,
     request.image_type = camera->image_type;
     request.pixels_as_float = camera->pixels_as_float;
     image_requests_.push_back(request);
+    camera_shm_pubs_.emplace_back();
+    if (camera->shared_memory) {
+      camera_shm_pubs_.back() =
+          nh_.advertise<SharedImage>(camera->output_topic + "/shm", 5);
+    }
+    camera_shm_writers_.emplace_back();
+    camera_shm_slots_.push_back(camera->shared_memory_slots);
+    camera_pools_.emplace_back();
   } else if (sensor->sensor_type ==
              AirsimSimulator::Config::Sensor::TYPE_LIDAR) {
     lidar_pubs_.push_back(
         nh_.advertise<sensor_msgs::PointCloud2>(sensor->output_topic, 5));
     lidar_names_.push_back(sensor->name);
     lidar_frame_names_.push_back(sensor->frame_name);
+    lidar_compact_resolutions_.push_back(
+        sensor->compact_encoding ? sensor->compact_resolution : 0.f);
+    lidar_pools_.emplace_back();
   } else if (sensor->sensor_type == AirsimSimulator::Config::Sensor::TYPE_IMU) {
     imu_pubs_.push_back(
         nh_.advertise<sensor_msgs::Imu>(sensor->output_topic, 5));
@@ -78,92 +153,231 @@ void SensorTimer::processCameras() {
     return;
   }
   if (!image_requests_.empty()) {
+    // Additional servers only render, so move their vehicle to the latest
+    // simulated pose first and stamp the images with the time of that pose.
+    // Timers sharing a server and vehicle hold its render mutex from setting
+    // the pose until the images are rendered, s.t. every image is rendered at
+    // exactly the pose it is stamped with.
+    msr::airlib::TTimePoint pose_timestamp = 0;
+    std::unique_lock<std::mutex> render_lock;
+    if (server_index_ > 0) {
+      render_lock = std::unique_lock<std::mutex>(*render_mutex_);
+      msr::airlib::Pose pose;
+      if (!parent_->getVehiclePose(vehicle_name_, &pose, &pose_timestamp)) {
+        return;
+      }
+      airsim_client_->simSetVehiclePose(pose, true, vehicle_name_);
+    }
+
     // get images from unreal.
     std::vector<msr::airlib::ImageCaptureBase::ImageResponse> responses =
-        airsim_client_.simGetImages(image_requests_, vehicle_name_);
+        airsim_client_->simGetImages(image_requests_, vehicle_name_);
+    if (render_lock.owns_lock()) {
+      render_lock.unlock();
+    }
     ros::Time timestamp = parent_->getTimeStamp(
-        responses[0].time_stamp);  // these are synchronized
+        server_index_ > 0 ? pose_timestamp
+                          : responses[0].time_stamp);  // these are synchronized
+
+    // Compute all sensor poses at once, they share the drift state.
+    OdometryDriftSimulator::TransformationVector ground_truth_poses;
+    OdometryDriftSimulator::TransformationVector simulated_poses;
+    if (parent_->getConfig().publish_sensor_transforms) {
+      ground_truth_poses.reserve(responses.size());
+      for (const auto& response : responses) {
+        // Poses are relative to the spawn of the vehicle.
+        Eigen::Vector3d position =
+            response.camera_position.cast<double>() + spawn_position_;
+        Eigen::Quaterniond rotation =
+            response.camera_orientation.cast<double>();
+        parent_->getFrameConverter().airsimToRos(&position);
+        parent_->getFrameConverter().airsimToRos(&rotation);
+        // Camera frames are x right, y down, z depth
+        rotation = rotation * Eigen::Quaterniond(0.5, -0.5, 0.5, -0.5);
+        rotation.normalize();
+        ground_truth_poses.emplace_back(
+            OdometryDriftSimulator::Transformation::Rotation(rotation),
+            position);
+      }
+      odometry_drift_simulator_->convertGroundTruthToDriftedPoses(
+          ground_truth_poses, timestamp, &simulated_poses);
+    }
 
     // process responses
     for (size_t i = 0; i < responses.size(); ++i) {
-      if (camera_pubs_[i].getNumSubscribers() > 0) {
-        sensor_msgs::ImagePtr msg(new sensor_msgs::Image);
-        if (responses[i].pixels_as_float) {
-          // Encode float images
-          cv::Mat cv_image =
-              cv::Mat(responses[i].height, responses[i].width, CV_32FC1);
-          memcpy(cv_image.data, responses[i].image_data_float.data(),
-                 responses[i].image_data_float.size() * sizeof(float));
-          cv_bridge::CvImage(std_msgs::Header(), "32FC1", cv_image)
-              .toImageMsg(*msg);
-        } else {
-          msg->height = responses[i].height;
-          msg->width = responses[i].width;
-          msg->is_bigendian = 0;
-          if (responses[i].image_type ==
-              msr::airlib::ImageCaptureBase::ImageType::Infrared) {
-            // IR images are published as 1C mono images.
-            msg->step = responses[i].width;
-            msg->encoding = "mono8";
-            msg->data.resize(responses[i].image_data_uint8.size() / 3);
-            for (size_t j = 0; j < msg->data.size(); ++j) {
-              msg->data[j] = responses[i].image_data_uint8[j * 3];
-            }
-          } else {
-            // all others are 3C RGB images.
-            msg->step = responses[i].width * 3;
-            msg->encoding = "bgr8";
-            msg->data = responses[i].image_data_uint8;
-          }
-        }
+      const bool use_shm = camera_shm_pubs_[i] &&
+                           camera_shm_pubs_[i].getNumSubscribers() > 0;
+      const bool use_ros = camera_pubs_[i].getNumSubscribers() > 0;
+      if (use_shm || use_ros ||
+          parent_->getFrameDispatcher()->hasInlineSubscribers(
+              camera_pubs_[i].getTopic())) {
+        sensor_msgs::ImagePtr msg =
+            camera_pools_[i].acquire(convertedImageSize(responses[i]));
+        convertImage(responses[i], msg.get());
         msg->header.stamp = timestamp;
         msg->header.frame_id = camera_frame_names_[i];
 
-        // Ground truth transforms.
+        // Ground truth and robot transforms.
         if (parent_->getConfig().publish_sensor_transforms) {
-          auto rotation =
-              Eigen::Quaterniond(responses[i].camera_orientation.w(),
-                                 responses[i].camera_orientation.x(),
-                                 responses[i].camera_orientation.y(),
-                                 responses[i].camera_orientation.z());
-          parent_->getFrameConverter().airsimToRos(&(rotation));
-          // Camera frames are x right, y down, z depth
-          rotation = rotation * Eigen::Quaterniond(0.5, -0.5, 0.5, -0.5);
-          geometry_msgs::TransformStamped transformStamped;
-          transformStamped.header.stamp = timestamp;
-          transformStamped.header.frame_id =
-              parent_->getConfig().simulator_frame_name;
-          transformStamped.transform.translation.x =
-              responses[i].camera_position[0];
-          transformStamped.transform.translation.y =
-              responses[i].camera_position[1];
-          transformStamped.transform.translation.z =
-              responses[i].camera_position[2];
-          transformStamped.transform.rotation.x = rotation.x();
-          transformStamped.transform.rotation.y = rotation.y();
-          transformStamped.transform.rotation.z = rotation.z();
-          transformStamped.transform.rotation.w = rotation.w();
-          parent_->getFrameConverter().airsimToRos(
-              &(transformStamped.transform.translation));
-          // Publish the ground truth transform.
-          transformStamped.child_frame_id =
-              camera_frame_names_[i] + "_ground_truth";
-          tf_broadcaster_.sendTransform(transformStamped);
-          transform_pub_.publish(transformStamped);
-
-          // Publish the robot transform, use both for naming consistency.
-          transformStamped =
-              parent_->getOdometryDriftSimulator()
-                  ->convertGroundTruthToDriftedPoseMsg(transformStamped);
-          transformStamped.child_frame_id = camera_frame_names_[i];
-          tf_broadcaster_.sendTransform(transformStamped);
-          transform_pub_.publish(transformStamped);
+          publishSensorTransforms(camera_frame_names_[i],
+                                  ground_truth_poses[i], simulated_poses[i],
+                                  timestamp);
+        }
+
+        // Run in-process consumers and publish.
+        parent_->getFrameDispatcher()->dispatchInline(
+            camera_pubs_[i].getTopic(), msg);
+        if (use_ros) {
+          publishCamera(i, msg);
         }
+        if (use_shm) {
+          publishSharedImage(i, *msg);
+        }
+      }
+    }
+  }
+}
+
+void SensorTimer::convertImage(
+    const msr::airlib::ImageCaptureBase::ImageResponse& response,
+    sensor_msgs::Image* msg) {
+  if (response.pixels_as_float) {
+    // Encode float images, copied directly s.t. pooled buffers are reused.
+    msg->height = response.height;
+    msg->width = response.width;
+    msg->is_bigendian = 0;
+    msg->step = response.width * sizeof(float);
+    msg->encoding = "32FC1";
+    msg->data.resize(response.image_data_float.size() * sizeof(float));
+    memcpy(msg->data.data(), response.image_data_float.data(),
+           msg->data.size());
+  } else {
+    msg->height = response.height;
+    msg->width = response.width;
+    msg->is_bigendian = 0;
+    if (response.image_type ==
+        msr::airlib::ImageCaptureBase::ImageType::Infrared) {
+      // IR images are published as 1C mono images.
+      msg->step = response.width;
+      msg->encoding = "mono8";
+      msg->data.resize(response.image_data_uint8.size() / 3);
+      for (size_t j = 0; j < msg->data.size(); ++j) {
+        msg->data[j] = response.image_data_uint8[j * 3];
+      }
+    } else {
+      // all others are 3C RGB images.
+      msg->step = response.width * 3;
+      msg->encoding = "bgr8";
+      msg->data.assign(response.image_data_uint8.begin(),
+                       response.image_data_uint8.end());
+    }
+  }
+}
+
+size_t SensorTimer::convertedImageSize(
+    const msr::airlib::ImageCaptureBase::ImageResponse& response) {
+  if (response.pixels_as_float) {
+    return response.image_data_float.size() * sizeof(float);
+  }
+  if (response.image_type ==
+      msr::airlib::ImageCaptureBase::ImageType::Infrared) {
+    return response.image_data_uint8.size() / 3;
+  }
+  return response.image_data_uint8.size();
+}
+
+MessagePoolStatistics SensorTimer::getAndResetPoolStatistics() {
+  MessagePoolStatistics result;
+  for (auto& pool : camera_pools_) {
+    result += pool.getAndResetStatistics();
+  }
+  for (auto& pool : lidar_pools_) {
+    result += pool.getAndResetStatistics();
+  }
+  return result;
+}
+
+void SensorTimer::publishCamera(size_t camera_index,
+                                const sensor_msgs::ImagePtr& msg) {
+  // Pinhole model of the undistorted UE4 camera.
+  sensor_msgs::CameraInfoPtr info(new sensor_msgs::CameraInfo);
+  info->header = msg->header;
+  info->height = msg->height;
+  info->width = msg->width;
+  info->distortion_model = "plumb_bob";
+  info->D.assign(5, 0.0);
+  const double focal_length =
+      msg->width / (2.0 * std::tan(camera_fovs_[camera_index] * M_PI / 360.0));
+  const double cx = msg->width / 2.0;
+  const double cy = msg->height / 2.0;
+  info->K = {focal_length, 0.0, cx, 0.0, focal_length, cy, 0.0, 0.0, 1.0};
+  info->R = {1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0};
+  info->P = {focal_length, 0.0, cx,  0.0, 0.0, focal_length,
+             cy,           0.0, 0.0, 0.0, 1.0, 0.0};
+
+  const std::shared_ptr<CameraPublishQueue>& queue =
+      camera_publish_queues_[camera_index];
+  {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    LOG_IF_EVERY_N(WARNING, queue->image != nullptr, 100)
+        << "Publishing '" << queue->publisher.getTopic()
+        << "' can not keep up, dropped frames.";
+    queue->image = msg;
+    queue->info = info;
+    if (queue->is_publishing) {
+      return;  // The running task publishes the new frame next.
+    }
+    queue->is_publishing = true;
+  }
+  parent_->getProcessingPool()->submit([queue]() { queue->publishPending(); });
+}
 
-        camera_pubs_[i].publish(msg);
+void SensorTimer::CameraPublishQueue::publishPending() {
+  while (true) {
+    sensor_msgs::ImageConstPtr next_image;
+    sensor_msgs::CameraInfoConstPtr next_info;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (image == nullptr) {
+        is_publishing = false;
+        return;
       }
+      next_image.swap(image);
+      next_info.swap(info);
+    }
+    publisher.publish(next_image, next_info);
+  }
+}
+
+void SensorTimer::publishSharedImage(size_t camera_index,
+                                     const sensor_msgs::Image& msg) {
+  // The ring is sized by the first frame.
+  std::unique_ptr<SharedImageWriter>& writer =
+      camera_shm_writers_[camera_index];
+  if (!writer || writer->getSlotSize() < msg.data.size()) {
+    const std::string topic = camera_shm_pubs_[camera_index].getTopic();
+    writer.reset();  // Release the old segment before the name is reused.
+    writer = std::make_unique<SharedImageWriter>(
+        SharedImageWriter::segmentName(topic),
+        camera_shm_slots_[camera_index], msg.data.size());
+    if (!writer->isValid()) {
+      LOG(ERROR) << "Could not create the shared memory for '" << topic
+                 << "', shared memory is disabled for this camera.";
+      writer.reset();
+      camera_shm_pubs_[camera_index] = ros::Publisher();
+      return;
     }
   }
+  SharedImage descriptor;
+  if (!writer->write(msg, &descriptor)) {
+    LOG_EVERY_N(WARNING, 100)
+        << "All shared memory slots of '"
+        << camera_shm_pubs_[camera_index].getTopic()
+        << "' are referenced by readers, dropped frames.";
+    return;
+  }
+  descriptor.header = msg.header;
+  camera_shm_pubs_[camera_index].publish(descriptor);
 }
 
 void SensorTimer::processLidars() {
@@ -172,12 +386,14 @@ void SensorTimer::processLidars() {
   }
   for (size_t i = 0; i < lidar_names_.size(); ++i) {
     msr::airlib::LidarData lidar_data =
-        airsim_client_.getLidarData(lidar_names_[i], vehicle_name_);
-    sensor_msgs::PointCloud2Ptr msg(new sensor_msgs::PointCloud2);
+        airsim_client_->getLidarData(lidar_names_[i], vehicle_name_);
+    const size_t num_points = lidar_data.point_cloud.size() / 3;
+    sensor_msgs::PointCloud2Ptr msg =
+        lidar_pools_[i].acquire(sizeof(float) * 3 * num_points);
     msg->header.frame_id = lidar_frame_names_[i];
     msg->header.stamp = parent_->getTimeStamp(lidar_data.time_stamp);
     msg->height = 1;
-    msg->width = lidar_data.point_cloud.size() / 3;
+    msg->width = num_points;
     msg->fields.resize(3);
     msg->fields[0].name = "x";
     msg->fields[1].name = "y";
@@ -192,54 +408,80 @@ void SensorTimer::processLidars() {
     msg->is_bigendian = false;
     msg->row_step = msg->point_step * msg->width;
     msg->is_dense = false;
-    std::vector<float> data_std = lidar_data.point_cloud;
-    for (size_t j = 0; j < data_std.size(); j += 3) {
-      // points are in sensor-Frame but with airsim axis
-      data_std[j + 1] *= -1.0;
-      data_std[j + 2] *= -1.0;
-    }
-    auto bytes = reinterpret_cast<const unsigned char*>(&data_std[0]);
-    std::vector<unsigned char> lidar_msg_data(
-        bytes, bytes + sizeof(float) * data_std.size());
-    msg->data = std::move(lidar_msg_data);
+    // points are in sensor-Frame but with airsim axis
+    FrameConverter::airsimAxesToRos(lidar_data.point_cloud.data(), msg->width);
+    memcpy(msg->data.data(), lidar_data.point_cloud.data(),
+           sizeof(float) * 3 * msg->width);
 
-    // Ground truth transform
+    // Ground truth and robot transforms.
     if (parent_->getConfig().publish_sensor_transforms) {
-      geometry_msgs::TransformStamped transformStamped;
-      transformStamped.header.stamp = msg->header.stamp;
-      transformStamped.header.frame_id =
-          parent_->getConfig().simulator_frame_name;
-      transformStamped.child_frame_id = lidar_frame_names_[i] + "_ground_truth";
-      transformStamped.transform.translation.x = lidar_data.pose.position[0];
-      transformStamped.transform.translation.y = lidar_data.pose.position[1];
-      transformStamped.transform.translation.z = lidar_data.pose.position[2];
-      transformStamped.transform.rotation.x = lidar_data.pose.orientation.x();
-      transformStamped.transform.rotation.y = lidar_data.pose.orientation.y();
-      transformStamped.transform.rotation.z = lidar_data.pose.orientation.z();
-      transformStamped.transform.rotation.w = lidar_data.pose.orientation.w();
-      parent_->getFrameConverter().airsimToRos(&(transformStamped.transform));
-      tf_broadcaster_.sendTransform(transformStamped);
-      transform_pub_.publish(transformStamped);
-
-      // Robot frame transform.
-      transformStamped =
-          parent_->getOdometryDriftSimulator()
-              ->convertGroundTruthToDriftedPoseMsg(transformStamped);
-      transformStamped.child_frame_id = lidar_frame_names_[i];
-      tf_broadcaster_.sendTransform(transformStamped);
-      transform_pub_.publish(transformStamped);
+      Eigen::Vector3d position =
+          lidar_data.pose.position.cast<double>() + spawn_position_;
+      Eigen::Quaterniond rotation = lidar_data.pose.orientation.cast<double>();
+      parent_->getFrameConverter().airsimToRos(&position);
+      parent_->getFrameConverter().airsimToRos(&rotation);
+      rotation.normalize();
+      const OdometryDriftSimulator::Transformation ground_truth_pose(
+          OdometryDriftSimulator::Transformation::Rotation(rotation), position);
+      publishSensorTransforms(
+          lidar_frame_names_[i], ground_truth_pose,
+          odometry_drift_simulator_->convertGroundTruthToDriftedPose(
+              ground_truth_pose, msg->header.stamp),
+          msg->header.stamp);
+    }
+    if (lidar_compact_resolutions_[i] > 0.f) {
+      sensor_msgs::PointCloud2Ptr compact_msg(new sensor_msgs::PointCloud2);
+      compact_pointcloud::EncodingStatistics statistics;
+      if (compact_pointcloud::encode(*msg, lidar_compact_resolutions_[i],
+                                     compact_msg.get(), &statistics)) {
+        LOG_IF(WARNING, statistics.num_dropped > 0)
+            << "Lidar '" << lidar_names_[i] << "': " << statistics.num_dropped
+            << " points exceed the compact encoding range and were dropped.";
+        VLOG(1) << "Lidar '" << lidar_names_[i] << "': encoded "
+                << statistics.num_points
+                << " points with max quantization error "
+                << statistics.max_error << " m.";
+        msg = compact_msg;
+      } else {
+        LOG_EVERY_N(WARNING, 100)
+            << "Lidar '" << lidar_names_[i]
+            << "': compact encoding failed, publishing the uncompressed "
+               "cloud.";
+      }
     }
     lidar_pubs_[i].publish(msg);
   }
 }
 
+void SensorTimer::publishSensorTransforms(
+    const std::string& frame_name,
+    const OdometryDriftSimulator::Transformation& ground_truth_pose,
+    const OdometryDriftSimulator::Transformation& simulated_pose,
+    const ros::Time& stamp) {
+  geometry_msgs::TransformStamped transformStamped;
+  transformStamped.header.stamp = stamp;
+  transformStamped.header.frame_id = parent_->getConfig().simulator_frame_name;
+
+  // Publish the ground truth transform.
+  transformStamped.child_frame_id = frame_name + "_ground_truth";
+  tf::transformKindrToMsg(ground_truth_pose, &transformStamped.transform);
+  tf_broadcaster_.sendTransform(transformStamped);
+  transform_pub_.publish(transformStamped);
+
+  // Publish the robot transform, use both for naming consistency.
+  transformStamped.child_frame_id = frame_name;
+  tf::transformKindrToMsg(simulated_pose, &transformStamped.transform);
+  tf_broadcaster_.sendTransform(transformStamped);
+  transform_pub_.publish(transformStamped);
+}
+
 void SensorTimer::processImus() {
   if (is_shutdown_) {
     return;
   }
   for (size_t i = 0; i < imu_names_.size(); ++i) {
     msr::airlib::ImuBase::Output imu_data =
-        airsim_client_.getImuData(imu_names_[i], vehicle_name_);
+        airsim_client_->getImuData(imu_names_[i], vehicle_name_);
 
     sensor_msgs::ImuPtr msg(new sensor_msgs::Imu);
     // orientation
@@ -0,0 +1,170 @@
+#include "unreal_airsim/online_simulator/sim_clock_model.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+
+namespace unreal_airsim {
+namespace {
+double toSeconds(const std::chrono::steady_clock::duration& duration) {
+  return std::chrono::duration<double>(duration).count();
+}
+
+double toSeconds(uint64_t time_ns, uint64_t reference_ns) {
+  return static_cast<double>(static_cast<int64_t>(time_ns - reference_ns)) *
+         1e-9;
+}
+}  // namespace
+
+SimClockModel::SimClockModel(const Config& config)
+    : config_(config),
+      reference_sim_time_ns_(0),
+      offset_(0.0),
+      rate_(1.0),
+      is_paused_(false),
+      num_resyncs_(0),
+      is_stale_(false),
+      last_sim_time_ns_(0) {}
+
+void SimClockModel::addSample(const WallTime& wall_time,
+                              uint64_t sim_time_ns) {
+  const Sample sample{wall_time, sim_time_ns};
+  if (is_stale_) {
+    LOG(INFO) << "Received a sim time sample again, resuming the sim clock.";
+    is_stale_ = false;
+  }
+  if (samples_.empty()) {
+    resync(sample);
+    return;
+  }
+  const Sample& last = samples_.back();
+  if (wall_time <= last.wall_time) {
+    return;
+  }
+
+  // Pauses: the sim time does not advance between samples.
+  if (sim_time_ns == last.sim_time_ns) {
+    if (!is_paused_) {
+      is_paused_ = true;
+      resync(sample);
+    }
+    return;
+  }
+  if (sim_time_ns < last.sim_time_ns) {
+    // Jumped back, e.g. a level reset. This can not be fitted as a rate.
+    num_resyncs_++;
+    is_paused_ = false;
+    resync(sample);
+    return;
+  }
+  if (is_paused_) {
+    // Resumed somewhere between the last two samples, restart the fit from
+    // here with the rate before the pause as prior.
+    is_paused_ = false;
+    resync(sample);
+    return;
+  }
+
+  // Only verify the prediction once the rate was fitted, the second sample
+  // after a resync determines it.
+  if (samples_.size() >= 2) {
+    const double residual = toSeconds(sim_time_ns, reference_sim_time_ns_) -
+                            predict(wall_time);
+    if (std::abs(residual) > config_.resync_threshold) {
+      num_resyncs_++;
+      resync(sample);
+      return;
+    }
+  }
+  samples_.push_back(sample);
+  while (samples_.size() > static_cast<size_t>(config_.window_size)) {
+    samples_.pop_front();
+  }
+  fit();
+}
+
+void SimClockModel::resync(const Sample& sample) {
+  samples_.clear();
+  samples_.push_back(sample);
+  reference_wall_time_ = sample.wall_time;
+  reference_sim_time_ns_ = sample.sim_time_ns;
+  offset_ = 0.0;
+}
+
+void SimClockModel::fit() {
+  // Least squares fit of the rate and offset over the window, relative to the
+  // oldest sample to keep the values small.
+  reference_wall_time_ = samples_.front().wall_time;
+  reference_sim_time_ns_ = samples_.front().sim_time_ns;
+  double mean_x = 0.0;
+  double mean_y = 0.0;
+  for (const Sample& sample : samples_) {
+    mean_x += toSeconds(sample.wall_time - reference_wall_time_);
+    mean_y += toSeconds(sample.sim_time_ns, reference_sim_time_ns_);
+  }
+  mean_x /= samples_.size();
+  mean_y /= samples_.size();
+  double s_xx = 0.0;
+  double s_xy = 0.0;
+  for (const Sample& sample : samples_) {
+    const double dx =
+        toSeconds(sample.wall_time - reference_wall_time_) - mean_x;
+    const double dy =
+        toSeconds(sample.sim_time_ns, reference_sim_time_ns_) - mean_y;
+    s_xx += dx * dx;
+    s_xy += dx * dy;
+  }
+  if (s_xx > 0.0) {
+    rate_ = std::max(s_xy / s_xx, 0.0);
+  }
+  offset_ = mean_y - rate_ * mean_x;
+}
+
+double SimClockModel::predict(const WallTime& wall_time) const {
+  if (is_paused_) {
+    return 0.0;
+  }
+  return offset_ + rate_ * toSeconds(wall_time - reference_wall_time_);
+}
+
+bool SimClockModel::isStale(const WallTime& wall_time) const {
+  return !samples_.empty() &&
+         toSeconds(wall_time - samples_.back().wall_time) >
+             config_.max_extrapolation;
+}
+
+uint64_t SimClockModel::getSimTime(const WallTime& wall_time) {
+  if (samples_.empty()) {
+    return 0;
+  }
+
+  // Do not extrapolate indefinitely if the simulator stops responding.
+  WallTime prediction_time = wall_time;
+  if (isStale(wall_time)) {
+    prediction_time =
+        samples_.back().wall_time +
+        std::chrono::duration_cast<WallTime::duration>(
+            std::chrono::duration<double>(config_.max_extrapolation));
+    if (!is_stale_) {
+      LOG(WARNING) << "No sim time sample received for more than "
+                   << config_.max_extrapolation
+                   << "s, holding the sim clock until the next sample.";
+      is_stale_ = true;
+    }
+  }
+  const int64_t sim_time_ns =
+      static_cast<int64_t>(reference_sim_time_ns_) +
+      static_cast<int64_t>(std::llround(predict(prediction_time) * 1e9));
+  uint64_t result = static_cast<uint64_t>(std::max<int64_t>(sim_time_ns, 0));
+
+  // Never go back in time, except for large jumps of the simulator itself.
+  if (result < last_sim_time_ns_ &&
+      static_cast<double>(last_sim_time_ns_ - result) * 1e-9 <=
+          config_.max_backward_jump) {
+    result = last_sim_time_ns_;
+  }
+  last_sim_time_ns_ = result;
+  return result;
+}
+}  // namespace unreal_airsim
@@ -1,9 +1,21 @@
 #include "unreal_airsim/online_simulator/simulator.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "unreal_airsim/depth_camera_intrinsics.h"
 #include "unreal_airsim/simulator_processing/processor_factory.h"
 
 STRICT_MODE_OFF
@@ -18,18 +30,73 @@ STRICT_MODE_ON
 #include <minkindr_conversions/kindr_msg.h>
 #include <nav_msgs/Odometry.h>
 #include <rosgraph_msgs/Clock.h>
+#include <sensor_msgs/point_cloud2_iterator.h>
 #include <std_msgs/Bool.h>
+#include <std_msgs/Float32.h>
+#include <tf2/LinearMath/Matrix3x3.h>
 #include <tf2/utils.h>
 
+#include <boost/function.hpp>
 #include <glog/logging.h>
 
 #include <chrono>
-#include <csignal>
+#include <cmath>
 #include <functional>
 #include <iostream>
 #include <thread>
 
 namespace unreal_airsim {
+namespace {
+// Back-project a DepthPlanar image into the camera frame with the intrinsics
+// of the DepthToPointcloud processor. Non-finite or deeper points are dropped.
+void depthImageToPointcloud(
+    const msr::airlib::ImageCaptureBase::ImageResponse& response, float fov,
+    float max_depth, sensor_msgs::PointCloud2* cloud) {
+  const size_t num_pixels = static_cast<size_t>(response.width) *
+                            static_cast<size_t>(response.height);
+  if (response.image_data_float.size() != num_pixels) {
+    return;
+  }
+  const DepthCameraIntrinsics intrinsics(response.width, response.height, fov);
+  cloud->is_bigendian = false;
+  cloud->is_dense = true;
+  sensor_msgs::PointCloud2Modifier modifier(*cloud);
+  modifier.setPointCloud2Fields(3, "x", 1, sensor_msgs::PointField::FLOAT32,
+                                "y", 1, sensor_msgs::PointField::FLOAT32, "z",
+                                1, sensor_msgs::PointField::FLOAT32);
+  modifier.resize(num_pixels);
+  sensor_msgs::PointCloud2Iterator<float> out_x(*cloud, "x");
+  sensor_msgs::PointCloud2Iterator<float> out_y(*cloud, "y");
+  sensor_msgs::PointCloud2Iterator<float> out_z(*cloud, "z");
+  size_t num_valid_points = 0;
+  for (int v = 0; v < response.height; ++v) {
+    for (int u = 0; u < response.width; ++u) {
+      const float z = response.image_data_float[v * response.width + u];
+      if (!std::isfinite(z) || (max_depth > 0.f && z > max_depth)) {
+        continue;
+      }
+      *out_x = intrinsics.backProjectX(u, z);
+      *out_y = intrinsics.backProjectY(v, z);
+      *out_z = z;
+      ++out_x;
+      ++out_y;
+      ++out_z;
+      ++num_valid_points;
+    }
+  }
+  modifier.resize(num_valid_points);
+}
+}  // namespace
+
+std::unique_ptr<AirsimSimulator> AirsimSimulator::createFromRos(
+    const ros::NodeHandle& nh, const ros::NodeHandle& nh_private) {
+  std::unique_ptr<AirsimSimulator> simulator(
+      new AirsimSimulator(nh, nh_private));
+  if (!simulator->initialize()) {
+    return nullptr;
+  }
+  return simulator;
+}
 
 AirsimSimulator::AirsimSimulator(const ros::NodeHandle& nh,
                                  const ros::NodeHandle& nh_private)
@@ -38,29 +105,137 @@ AirsimSimulator::AirsimSimulator(const ros::NodeHandle& nh,
       is_connected_(false),
       is_running_(false),
       is_shutdown_(false),
-      odometry_drift_simulator_(
-          OdometryDriftSimulator::Config::fromRosParams(nh_private)) {
+      startup_stage_(StartupStage::kArming) {}
+
+bool AirsimSimulator::initialize() {
   // configure
-  readParamsFromRos();
+  readServersFromRos();
+  createClients();
+  if (!readParamsFromRos()) {
+    LOG(ERROR) << "Invalid simulator params.";
+    return false;
+  }
+  setupVehicles();
+  ConnectionSupervisor::Config supervisor_config;
+  supervisor_config.check_interval = config_.connection_check_interval;
+  supervisor_config.max_backoff = config_.reconnect_max_backoff;
+  connection_supervisor_ = std::make_unique<ConnectionSupervisor>(
+      supervisor_config,
+      ConnectionSupervisor::Hooks{
+          [this]() { return isAirsimConnected(); },
+          [this]() { pauseSimulation(); },
+          [this]() { return reconnectAirsim(); },
+          [this]() { resumeSimulation(); }});
 
   // airsim
-  bool success = setupAirsim();
+  bool success = setupAirsim(3.0);
   if (success) {
     LOG(INFO) << "Connected to the Airsim Server.";
     is_connected_ = true;
   } else {
-    std::raise(SIGINT);
-    return;
+    return false;
+  }
+  if (!readCameraInfos()) {
+    return false;
   }
 
   // setup everything
   initializeSimulationFrame();
   setupROS();
   startSimTimer();
+  connection_supervisor_->start();
 
   // Startup the vehicle simulation via callback
+  setStartupStage(StartupStage::kArming);
   startup_timer_ = nh_private_.createTimer(
       ros::Duration(0.1), &AirsimSimulator::startupCallback, this);
+  return true;
+}
+
+void AirsimSimulator::createClients() {
+  // NOTE: AirLib clients can not reconnect, so they are recreated instead.
+  const Config::Server& server = config_.servers.front();
+  airsim_state_client_ = std::make_unique<msr::airlib::MultirotorRpcLibClient>(
+      server.ip, server.port);
+  airsim_collision_client_ =
+      std::make_unique<msr::airlib::MultirotorRpcLibClient>(server.ip,
+                                                            server.port);
+  airsim_move_client_ = std::make_unique<msr::airlib::MultirotorRpcLibClient>(
+      server.ip, server.port);
+  airsim_time_client_ = std::make_unique<msr::airlib::MultirotorRpcLibClient>(
+      server.ip, server.port);
+  airsim_command_client_ =
+      std::make_unique<msr::airlib::MultirotorRpcLibClient>(server.ip,
+                                                            server.port);
+  airsim_viewpoint_client_ =
+      std::make_unique<msr::airlib::MultirotorRpcLibClient>(server.ip,
+                                                            server.port);
+  airsim_render_clients_.clear();
+  for (size_t i = 1; i < config_.servers.size(); ++i) {
+    airsim_render_clients_.push_back(
+        std::make_unique<msr::airlib::MultirotorRpcLibClient>(
+            config_.servers[i].ip, config_.servers[i].port));
+  }
+  sensor_clients_.assign(config_.servers.size(), {});
+  for (size_t i = 0; i < config_.servers.size(); ++i) {
+    for (int j = 0; j < config_.sensor_clients_per_server; ++j) {
+      sensor_clients_[i].push_back(
+          std::make_shared<msr::airlib::MultirotorRpcLibClient>(
+              config_.servers[i].ip, config_.servers[i].port));
+    }
+  }
+}
+
+std::shared_ptr<msr::airlib::MultirotorRpcLibClient>
+AirsimSimulator::getSensorClient(size_t server_index, size_t client_index) {
+  std::shared_lock<std::shared_mutex> lock(clients_mutex_);
+  const auto& clients = sensor_clients_[server_index];
+  return clients[client_index % clients.size()];
+}
+
+bool AirsimSimulator::readServersFromRos() {
+  // Servers are given as list of 'ip:port', all running the same map and
+  // settings except for the ApiServerPort.
+  config_.servers.clear();
+  std::vector<std::string> addresses;
+  nh_private_.param("airsim_servers", addresses, std::vector<std::string>());
+  for (const std::string& address : addresses) {
+    Config::Server server;
+    const size_t pos = address.rfind(':');
+    int port = -1;
+    if (pos != std::string::npos) {
+      server.ip = address.substr(0, pos);
+      try {
+        port = std::stoi(address.substr(pos + 1));
+      } catch (const std::exception&) {
+        port = -1;
+      }
+    }
+    if (server.ip.empty() || port <= 0 || port > 65535) {
+      LOG(WARNING) << "Param 'airsim_servers' expects entries as 'ip:port', "
+                      "server '"
+                   << address << "' will be ignored!";
+      continue;
+    }
+    server.port = static_cast<uint16_t>(port);
+    config_.servers.push_back(server);
+  }
+  const Config defaults;
+  nh_private_.param("sensor_clients_per_server",
+                    config_.sensor_clients_per_server,
+                    defaults.sensor_clients_per_server);
+  if (config_.sensor_clients_per_server <= 0) {
+    config_.sensor_clients_per_server = defaults.sensor_clients_per_server;
+    LOG(WARNING) << "Param 'sensor_clients_per_server' expected > 0, set to '"
+                 << defaults.sensor_clients_per_server << "' (default).";
+  }
+  if (config_.servers.empty()) {
+    config_.servers.push_back(Config::Server());
+  } else if (config_.servers.size() > 1) {
+    LOG(INFO) << "Distributing the cameras over " << config_.servers.size()
+              << " Airsim servers.";
+  }
+  return true;
 }
 
 bool AirsimSimulator::readParamsFromRos() {
@@ -70,13 +245,52 @@ bool AirsimSimulator::readParamsFromRos() {
   nh_.param("/use_sim_time", use_sim_time_, false);
   nh_private_.param("state_refresh_rate", config_.state_refresh_rate,
                     defaults.state_refresh_rate);
+  nh_private_.param("collision_check_rate", config_.collision_check_rate,
+                    defaults.collision_check_rate);
   nh_private_.param("time_publisher_interval", config_.time_publisher_interval,
                     defaults.time_publisher_interval);
+  nh_private_.param("time_sync_interval", config_.time_sync_interval,
+                    defaults.time_sync_interval);
+  nh_private_.param("time_sync_threshold", config_.time_sync_threshold,
+                    defaults.time_sync_threshold);
+  nh_private_.param("connection_check_interval",
+                    config_.connection_check_interval,
+                    defaults.connection_check_interval);
+  nh_private_.param("reconnect_max_backoff", config_.reconnect_max_backoff,
+                    defaults.reconnect_max_backoff);
+  if (!nh_private_.getParam("camera_info_cache_file",
+                            config_.camera_info_cache_file)) {
+    const char* ros_home = std::getenv("ROS_HOME");
+    const char* home = std::getenv("HOME");
+    if (ros_home) {
+      config_.camera_info_cache_file = std::string(ros_home);
+    } else if (home) {
+      config_.camera_info_cache_file = std::string(home) + "/.ros";
+    }
+    if (!config_.camera_info_cache_file.empty()) {
+      config_.camera_info_cache_file += "/unreal_airsim_camera_infos.txt";
+    }
+  }
   nh_private_.param("simulator_frame_name", config_.simulator_frame_name,
                     defaults.simulator_frame_name);
+  nh_private_.param("inline_processing", config_.inline_processing,
+                    defaults.inline_processing);
+  nh_private_.param("processing_threads", config_.processing_threads,
+                    defaults.processing_threads);
+  nh_private_.param("processing_report_interval",
+                    config_.processing_report_interval,
+                    defaults.processing_report_interval);
   nh_private_.param("vehicle_name", config_.vehicle_name,
                     defaults.vehicle_name);
   nh_private_.param("velocity", config_.velocity, defaults.velocity);
+  nh_private_.param("max_velocity", config_.max_velocity,
+                    defaults.max_velocity);
+  nh_private_.param("command_mode", config_.command_mode,
+                    defaults.command_mode);
+  nh_private_.param("command_max_age", config_.command_max_age,
+                    defaults.command_max_age);
+  nh_private_.param("command_hold_time", config_.command_hold_time,
+                    defaults.command_hold_time);
   nh_private_.param("publish_sensor_transforms",
                     config_.publish_sensor_transforms,
                     defaults.publish_sensor_transforms);
@@ -87,39 +301,104 @@ bool AirsimSimulator::readParamsFromRos() {
     LOG(WARNING) << "Param 'state_refresh_rate' expected > 0.0, set to '"
                  << defaults.state_refresh_rate << "' (default).";
   }
+  if (config_.collision_check_rate < 0.0) {
+    config_.collision_check_rate = defaults.collision_check_rate;
+    LOG(WARNING) << "Param 'collision_check_rate' expected >= 0.0, set to '"
+                 << defaults.collision_check_rate << "' (default).";
+  }
   if (config_.time_publisher_interval < 0) {
     config_.time_publisher_interval = defaults.time_publisher_interval;
     LOG(WARNING) << "Param 'time_publisher_interval' expected >= 0, set to '"
                  << defaults.time_publisher_interval << "' (default).";
   }
+  if (config_.time_sync_interval <= 0) {
+    config_.time_sync_interval = defaults.time_sync_interval;
+    LOG(WARNING) << "Param 'time_sync_interval' expected > 0, set to '"
+                 << defaults.time_sync_interval << "' (default).";
+  }
+  if (config_.time_sync_threshold <= 0.0) {
+    config_.time_sync_threshold = defaults.time_sync_threshold;
+    LOG(WARNING) << "Param 'time_sync_threshold' expected > 0.0, set to '"
+                 << defaults.time_sync_threshold << "' (default).";
+  }
+  if (config_.connection_check_interval <= 0.0) {
+    config_.connection_check_interval = defaults.connection_check_interval;
+    LOG(WARNING) << "Param 'connection_check_interval' expected > 0.0, set to "
+                    "'"
+                 << defaults.connection_check_interval << "' (default).";
+  }
+  if (config_.reconnect_max_backoff <= 0.0) {
+    config_.reconnect_max_backoff = defaults.reconnect_max_backoff;
+    LOG(WARNING) << "Param 'reconnect_max_backoff' expected > 0.0, set to '"
+                 << defaults.reconnect_max_backoff << "' (default).";
+  }
+  if (config_.processing_report_interval < 0.0) {
+    config_.processing_report_interval = defaults.processing_report_interval;
+    LOG(WARNING) << "Param 'processing_report_interval' expected >= 0.0, set "
+                    "to '"
+                 << defaults.processing_report_interval << "' (default).";
+  }
   if (config_.velocity <= 0.0) {
     config_.velocity = defaults.velocity;
     LOG(WARNING) << "Param 'velocity' expected > 0.0, set to '"
                  << defaults.velocity << "' (default).";
   }
+  if (config_.max_velocity <= 0.0) {
+    config_.max_velocity = defaults.max_velocity;
+    LOG(WARNING) << "Param 'max_velocity' expected > 0.0, set to '"
+                 << defaults.max_velocity << "' (default).";
+  }
+  if (config_.command_mode != "fly" && config_.command_mode != "teleport") {
+    config_.command_mode = defaults.command_mode;
+    LOG(WARNING) << "Param 'command_mode' expected 'fly' or 'teleport', set to "
+                    "'"
+                 << defaults.command_mode << "' (default).";
+  }
+  if (config_.command_max_age <= 0.0) {
+    config_.command_max_age = defaults.command_max_age;
+    LOG(WARNING) << "Param 'command_max_age' expected > 0.0, set to '"
+                 << defaults.command_max_age << "' (default).";
+  }
+  if (config_.command_hold_time <= 0.0) {
+    config_.command_hold_time = defaults.command_hold_time;
+    LOG(WARNING) << "Param 'command_hold_time' expected > 0.0, set to '"
+                 << defaults.command_hold_time << "' (default).";
+  }
+
+  // setup vehicles and sensors
+  if (!readVehiclesFromRos()) {
+    return false;
+  }
 
-  // setup sensors
+  // Discover the sensors and processors in a single pass over all params.
   std::vector<std::string> keys;
   nh_private_.getParamNames(keys);
-  std::string sensor_ns = "sensors/";
-  std::string full_ns = nh_private_.getNamespace() + "/" + sensor_ns;
-  std::string sensor_name;
+  const std::string private_ns = nh_private_.getNamespace() + "/";
+  const std::string sensor_ns = "sensors/";
+  const std::string proc_ns = "processors/";
   std::vector<std::string> sensors;
-  size_t pos;
+  processor_names_.clear();
   for (auto const& key : keys) {
-    if ((pos = key.find(full_ns)) != std::string::npos) {
-      sensor_name = key;
-      sensor_name.erase(0, pos + full_ns.length());
-      pos = sensor_name.find('/');
-      if (pos != std::string::npos) {
-        sensor_name = sensor_name.substr(0, pos);
-      }
-      if (std::find(sensors.begin(), sensors.end(), sensor_name) ==
-          sensors.end()) {
-        sensors.push_back(sensor_name);
-      }
+    if (key.compare(0, private_ns.length(), private_ns) != 0) {
+      continue;
+    }
+    size_t start = private_ns.length();
+    std::vector<std::string>* names;
+    if (key.compare(start, sensor_ns.length(), sensor_ns) == 0) {
+      names = &sensors;
+      start += sensor_ns.length();
+    } else if (key.compare(start, proc_ns.length(), proc_ns) == 0) {
+      names = &processor_names_;
+      start += proc_ns.length();
+    } else {
+      continue;
+    }
+    const std::string name = key.substr(start, key.find('/', start) - start);
+    if (std::find(names->begin(), names->end(), name) == names->end()) {
+      names->push_back(name);
     }
   }
+  size_t num_cameras = 0;
   for (auto const& name : sensors) {
     // currently pass all settings via params, maybe could add some smart
     // identification here
@@ -172,10 +451,32 @@ bool AirsimSimulator::readParamsFromRos() {
         cfg->image_type = cam_defaults.image_type;
         cfg->image_type_str = cam_defaults.image_type_str;
       }
-      cfg->camera_info = airsim_state_client_.simGetCameraInfo(name);
+      nh_private_.param(sensor_ns + name + "/shared_memory",
+                        cfg->shared_memory, cfg->shared_memory);
+      nh_private_.param(sensor_ns + name + "/shared_memory_slots",
+                        cfg->shared_memory_slots, cfg->shared_memory_slots);
+      if (cfg->shared_memory_slots < 2) {
+        LOG(WARNING) << "Param 'shared_memory_slots' for camera '" << name
+                     << "' expected >= 2, set to '"
+                     << cam_defaults.shared_memory_slots << "' (default).";
+        cfg->shared_memory_slots = cam_defaults.shared_memory_slots;
+      }
       sensor_cfg = (Config::Sensor*)cfg;
     } else if (sensor_type == Config::Sensor::TYPE_LIDAR) {
       sensor_cfg = new Config::Sensor();
+      nh_private_.param(sensor_ns + name + "/compact_encoding",
+                        sensor_cfg->compact_encoding,
+                        sensor_cfg->compact_encoding);
+      nh_private_.param(sensor_ns + name + "/compact_resolution",
+                        sensor_cfg->compact_resolution,
+                        sensor_cfg->compact_resolution);
+      if (sensor_cfg->compact_resolution <= 0.0) {
+        LOG(WARNING) << "Param 'compact_resolution' for sensor '" << name
+                     << "' expected > 0.0, set to '"
+                     << compact_pointcloud::kDefaultResolution
+                     << "' (default).";
+        sensor_cfg->compact_resolution = compact_pointcloud::kDefaultResolution;
+      }
     } else if (sensor_type == Config::Sensor::TYPE_IMU) {
       sensor_cfg = new Config::Sensor();
     } else {
@@ -187,11 +488,12 @@ bool AirsimSimulator::readParamsFromRos() {
     // general settings
     sensor_cfg->name = name;
     sensor_cfg->sensor_type = sensor_type;
-    nh_private_.param(sensor_ns + name + "/output_topic",
-                      sensor_cfg->output_topic,
-                      config_.vehicle_name + "/" + name);
-    nh_private_.param(sensor_ns + name + "/frame_name", sensor_cfg->frame_name,
-                      config_.vehicle_name + "/" + name);
+    std::string output_topic;
+    std::string frame_name;
+    const bool has_output_topic =
+        nh_private_.getParam(sensor_ns + name + "/output_topic", output_topic);
+    const bool has_frame_name =
+        nh_private_.getParam(sensor_ns + name + "/frame_name", frame_name);
     nh_private_.param(sensor_ns + name + "/force_separate_timer",
                       sensor_cfg->force_separate_timer,
                       sensor_cfg->force_separate_timer);
@@ -206,27 +508,184 @@ bool AirsimSimulator::readParamsFromRos() {
     }
     readTransformFromRos(sensor_ns + name + "/T_B_S",
                          &(sensor_cfg->translation), &(sensor_cfg->rotation));
-    config_.sensors.push_back(std::unique_ptr<Config::Sensor>(sensor_cfg));
+
+    // Mount the sensor on the given vehicle, or on every vehicle if none is
+    // given. Explicit names are then prefixed by the vehicle name.
+    std::unique_ptr<Config::Sensor> sensor(sensor_cfg);
+    std::vector<std::string> mount_vehicles;
+    std::string vehicle_name;
+    if (nh_private_.getParam(sensor_ns + name + "/vehicle", vehicle_name)) {
+      if (std::none_of(config_.vehicles.begin(), config_.vehicles.end(),
+                       [&vehicle_name](const Config::Vehicle& vehicle) {
+                         return vehicle.name == vehicle_name;
+                       })) {
+        LOG(WARNING) << "Unknown vehicle '" << vehicle_name << "' for sensor '"
+                     << name << "', sensor will be ignored!";
+        continue;
+      }
+      mount_vehicles.push_back(vehicle_name);
+    } else {
+      for (const Config::Vehicle& vehicle : config_.vehicles) {
+        mount_vehicles.push_back(vehicle.name);
+      }
+    }
+    // Cameras are rendered round robin by all servers unless one is given,
+    // everything else depends on the physics of the first server.
+    int server = -1;
+    if (nh_private_.getParam(sensor_ns + name + "/server", server)) {
+      if (sensor_type != Config::Sensor::TYPE_CAMERA) {
+        LOG(WARNING) << "Param 'server' for sensor '" << name
+                     << "' is only supported for cameras, set to '0'.";
+        server = 0;
+      } else if (server < 0 ||
+                 server >= static_cast<int>(config_.servers.size())) {
+        LOG(WARNING) << "Param 'server' for sensor '" << name
+                     << "' expected in [0, " << config_.servers.size() - 1
+                     << "], it will be assigned automatically.";
+        server = -1;
+      }
+    }
+    const bool is_replicated = mount_vehicles.size() > 1;
+    for (const std::string& vehicle : mount_vehicles) {
+      std::unique_ptr<Config::Sensor> mounted;
+      if (sensor_type == Config::Sensor::TYPE_CAMERA) {
+        // The camera info is read from UE4 once connected.
+        mounted = std::make_unique<Config::Camera>(
+            *static_cast<Config::Camera*>(sensor.get()));
+      } else {
+        mounted = std::make_unique<Config::Sensor>(*sensor);
+      }
+      const std::string prefix = vehicle + "/";
+      mounted->vehicle_name = vehicle;
+      if (server >= 0) {
+        mounted->server = server;
+      } else if (sensor_type == Config::Sensor::TYPE_CAMERA) {
+        mounted->server = num_cameras % config_.servers.size();
+      }
+      if (sensor_type == Config::Sensor::TYPE_CAMERA) {
+        num_cameras++;
+      }
+      mounted->output_topic =
+          has_output_topic ? (is_replicated ? prefix : "") + output_topic
+                           : prefix + name;
+      mounted->frame_name = has_frame_name
+                                ? (is_replicated ? prefix : "") + frame_name
+                                : prefix + name;
+      config_.sensors.push_back(std::move(mounted));
+    }
+  }
+  return true;
+}
+
+bool AirsimSimulator::readVehiclesFromRos() {
+  // Vehicles are given as 'vehicles/name/{X, Y, Z}', as in settings.json. If
+  // none are given 'vehicle_name' is the single vehicle at the origin.
+  config_.vehicles.clear();
+  XmlRpc::XmlRpcValue vehicles;
+  if (!nh_private_.getParam("vehicles", vehicles)) {
+    Config::Vehicle vehicle;
+    vehicle.name = config_.vehicle_name;
+    config_.vehicles.push_back(vehicle);
+    return true;
+  }
+  if (vehicles.getType() != XmlRpc::XmlRpcValue::TypeStruct ||
+      vehicles.size() == 0) {
+    LOG(ERROR) << "Param 'vehicles' expected as a non-empty map of vehicle "
+                  "names to their spawn positions.";
+    return false;
+  }
+  for (auto it = vehicles.begin(); it != vehicles.end(); ++it) {
+    Config::Vehicle vehicle;
+    vehicle.name = it->first;
+    const std::string ns = "vehicles/" + vehicle.name + "/";
+    nh_private_.param(ns + "X", vehicle.spawn_position.x(), 0.0);
+    nh_private_.param(ns + "Y", vehicle.spawn_position.y(), 0.0);
+    nh_private_.param(ns + "Z", vehicle.spawn_position.z(), 0.0);
+    config_.vehicles.push_back(vehicle);
   }
+  config_.vehicle_name = config_.vehicles.front().name;
   return true;
 }
 
-bool AirsimSimulator::setupAirsim() {
+void AirsimSimulator::setupVehicles() {
+  // Every vehicle gets its own drift, derived from the same noise config.
+  const OdometryDriftSimulator::Config drift_config =
+      OdometryDriftSimulator::Config::fromRosParams(nh_private_);
+  for (size_t i = 0; i < config_.vehicles.size(); ++i) {
+    VehicleInterface vehicle;
+    vehicle.name = config_.vehicles[i].name;
+    vehicle.spawn_position = config_.vehicles[i].spawn_position;
+    // Same seed, but non-overlapping random streams per vehicle.
+    OdometryDriftSimulator::Config vehicle_drift_config = drift_config;
+    vehicle_drift_config.stream = static_cast<int>(i);
+    vehicle.odometry_drift_simulator =
+        std::make_unique<OdometryDriftSimulator>(vehicle_drift_config);
+    vehicles_.push_back(std::move(vehicle));
+  }
+  trajectories_.resize(vehicles_.size());
+  render_mutexes_.clear();
+  for (size_t i = 0; i < config_.servers.size() * vehicles_.size(); ++i) {
+    render_mutexes_.push_back(std::make_unique<std::mutex>());
+  }
+}
+
+OdometryDriftSimulator* AirsimSimulator::getOdometryDriftSimulator(
+    const std::string& vehicle_name) {
+  if (vehicles_.empty()) {
+    return nullptr;
+  }
+  if (vehicle_name.empty()) {
+    return vehicles_.front().odometry_drift_simulator.get();
+  }
+  for (const VehicleInterface& vehicle : vehicles_) {
+    if (vehicle.name == vehicle_name) {
+      return vehicle.odometry_drift_simulator.get();
+    }
+  }
+  return nullptr;
+}
+
+bool AirsimSimulator::getVehiclePose(const std::string& vehicle_name,
+                                     msr::airlib::Pose* pose,
+                                     msr::airlib::TTimePoint* timestamp) {
+  std::lock_guard<std::mutex> lock(vehicle_poses_mutex_);
+  for (const VehicleInterface& vehicle : vehicles_) {
+    if (vehicle.name == vehicle_name && vehicle.pose_timestamp > 0) {
+      *pose = vehicle.pose;
+      *timestamp = vehicle.pose_timestamp;
+      return true;
+    }
+  }
+  return false;
+}
+
+std::mutex* AirsimSimulator::getRenderMutex(size_t server_index,
+                                            const std::string& vehicle_name) {
+  for (size_t i = 0; i < vehicles_.size(); ++i) {
+    if (vehicles_[i].name == vehicle_name) {
+      return render_mutexes_[server_index * vehicles_.size() + i].get();
+    }
+  }
+  return nullptr;
+}
+
+bool AirsimSimulator::setupAirsim(double timeout) {
   // This is implemented explicitly to avoid Airsim printing and make it clearer
-  // for us what is going wrong
-  int timeout = 0;
-  while (airsim_state_client_.getConnectionState() !=
+  // for us what is going wrong. Failures are not fatal s.t. the connection
+  // supervisor can retry.
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(static_cast<int>(timeout * 1000));
+  while (airsim_state_client_->getConnectionState() !=
              msr::airlib::RpcLibClientBase::ConnectionState::Connected &&
          ros::ok()) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(300));
-    timeout++;
-    if (timeout > 10) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (std::chrono::steady_clock::now() > deadline) {
       // connection state will remain RpcLibClientBase::ConnectionState::Initial
       // if the unreal game was not running when creating the client (in the
       // constructor)
-      LOG(FATAL)
-          << "Unable to connect to the Airsim Server (timeout after 5s). "
-             "Is a UE4 game with enabled Airsim plugin running?";
+      LOG(ERROR) << "Unable to connect to the Airsim Server (timeout after "
+                 << timeout
+                 << "s). Is a UE4 game with enabled Airsim plugin running?";
       return false;
     }
   }
@@ -236,50 +695,318 @@ bool AirsimSimulator::setupAirsim() {
       true;  // Check both in one run to spare running into the issue twice
   int server_ver = 0;
   try {
-    server_ver = airsim_state_client_.getServerVersion();
+    server_ver = airsim_state_client_->getServerVersion();
   } catch (rpc::rpc_error& e) {
-    LOG(FATAL) << "Could not get server version from AirSim Plugin: "
+    LOG(ERROR) << "Could not get server version from AirSim Plugin: "
                << e.get_error().as<std::string>();
     return false;
   }
-  int client_ver = airsim_state_client_.getClientVersion();
-  int server_min_ver = airsim_state_client_.getMinRequiredServerVersion();
-  int client_min_ver = airsim_state_client_.getMinRequiredClientVersion();
+  int client_ver = airsim_state_client_->getClientVersion();
+  int server_min_ver = airsim_state_client_->getMinRequiredServerVersion();
+  int client_min_ver = airsim_state_client_->getMinRequiredClientVersion();
   if (client_ver < client_min_ver) {
-    LOG(FATAL) << "Airsim Client version is too old (is: " << client_ver
+    LOG(ERROR) << "Airsim Client version is too old (is: " << client_ver
                << ", min: " << client_min_ver
                << "). Update and rebuild the Airsim library.";
     versions_matching = false;
   }
   if (server_ver < server_min_ver) {
-    LOG(FATAL) << "Airsim Server version is too old (is: " << server_ver
+    LOG(ERROR) << "Airsim Server version is too old (is: " << server_ver
                << ", min: " << server_min_ver
                << "). Update and rebuild the Airsim UE4 Plugin.";
     versions_matching = false;
   }
+
+  // The additional servers only render, so stop their physics. Their vehicles
+  // are moved to the poses simulated by the first server before rendering.
+  for (size_t i = 0; i < airsim_render_clients_.size(); ++i) {
+    const Config::Server& server = config_.servers[i + 1];
+    while (airsim_render_clients_[i]->getConnectionState() !=
+               msr::airlib::RpcLibClientBase::ConnectionState::Connected &&
+           ros::ok()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      if (std::chrono::steady_clock::now() > deadline) {
+        LOG(ERROR) << "Unable to connect to the Airsim Server at " << server.ip
+                   << ":" << server.port << " (timeout after " << timeout
+                   << "s).";
+        return false;
+      }
+    }
+    try {
+      airsim_render_clients_[i]->simPause(true);
+    } catch (const std::exception& e) {
+      LOG(ERROR) << "Could not pause the Airsim Server at " << server.ip << ":"
+                 << server.port << ": " << e.what();
+      return false;
+    }
+  }
   return versions_matching;
 }
 
+bool AirsimSimulator::isAirsimConnected() {
+  std::shared_lock<std::shared_mutex> lock(clients_mutex_);
+  for (const auto* client :
+       {airsim_state_client_.get(), airsim_collision_client_.get(),
+        airsim_move_client_.get(), airsim_time_client_.get(),
+        airsim_command_client_.get(), airsim_viewpoint_client_.get()}) {
+    if (client->getConnectionState() !=
+        msr::airlib::RpcLibClientBase::ConnectionState::Connected) {
+      return false;
+    }
+  }
+  for (const auto& client : airsim_render_clients_) {
+    if (client->getConnectionState() !=
+            msr::airlib::RpcLibClientBase::ConnectionState::Connected ||
+        !client->ping()) {
+      return false;
+    }
+  }
+  for (const auto& timer : sensor_timers_) {
+    if (!timer->isConnected()) {
+      return false;
+    }
+  }
+  // The connection state does not capture a hanging server, throws on error.
+  return airsim_state_client_->ping();
+}
+
+void AirsimSimulator::pauseSimulation() {
+  // Stopping the timers waits for their running callbacks to finish.
+  is_connected_ = false;
+  startup_timer_.stop();
+  for (VehicleInterface& vehicle : vehicles_) {
+    vehicle.state_timer.stop();
+  }
+  collision_timer_.stop();
+  for (const auto& timer : sensor_timers_) {
+    timer->pause();
+  }
+}
+
+bool AirsimSimulator::reconnectAirsim() {
+  {
+    std::unique_lock<std::shared_mutex> lock(clients_mutex_);
+    createClients();
+    if (!setupAirsim(1.0)) {
+      return false;
+    }
+  }
+  for (const auto& timer : sensor_timers_) {
+    if (!timer->reconnect()) {
+      return false;
+    }
+  }
+  std::shared_lock<std::shared_mutex> lock(clients_mutex_);
+  updateCameraInfos();
+  if (is_running_) {
+    // A level reload resets the vehicles, so take back control.
+    for (const VehicleInterface& vehicle : vehicles_) {
+      airsim_move_client_->enableApiControl(true, vehicle.name);
+      airsim_move_client_->armDisarm(true, vehicle.name);
+    }
+  }
+  return true;
+}
+
+void AirsimSimulator::resumeSimulation() {
+  is_connected_ = true;
+  for (VehicleInterface& vehicle : vehicles_) {
+    vehicle.state_timer.start();
+  }
+  if (config_.collision_check_rate > 0.0) {
+    collision_timer_.start();
+  }
+  for (const auto& timer : sensor_timers_) {
+    timer->resume();
+  }
+  if (!is_running_) {
+    setStartupStage(StartupStage::kArming);
+    startup_timer_.start();
+  }
+}
+
+void AirsimSimulator::updateCameraInfos() {
+  // NOTE: Requires clients_mutex_ to be locked by the caller.
+  std::vector<Config::Camera*> cameras;
+  for (const auto& sensor : config_.sensors) {
+    if (sensor->sensor_type == Config::Sensor::TYPE_CAMERA) {
+      cameras.push_back((Config::Camera*)sensor.get());
+    }
+  }
+  const std::vector<msr::airlib::CameraInfo> camera_infos =
+      fetchCameraInfos(cameras);
+  for (size_t i = 0; i < cameras.size(); ++i) {
+    Config::Camera* camera = cameras[i];
+    const msr::airlib::CameraInfo& camera_info = camera_infos[i];
+    if (camera_info.fov != camera->camera_info.fov) {
+      LOG(WARNING) << "The FOV of camera '" << camera->name
+                   << "' changed from " << camera->camera_info.fov << " to "
+                   << camera_info.fov
+                   << " while reconnecting, processors keep using the old "
+                      "one.";
+    }
+    camera->camera_info = camera_info;
+  }
+}
+
+std::vector<msr::airlib::CameraInfo> AirsimSimulator::fetchCameraInfos(
+    const std::vector<Config::Camera*>& cameras) {
+  // NOTE: Requires clients_mutex_ to be locked by the caller. The requests are
+  // issued concurrently to overlap their round trips, throws on error.
+  std::vector<std::future<msr::airlib::CameraInfo>> requests;
+  requests.reserve(cameras.size());
+  for (const Config::Camera* camera : cameras) {
+    requests.push_back(std::async(std::launch::async, [this, camera]() {
+      return airsim_state_client_->simGetCameraInfo(camera->name,
+                                                    camera->vehicle_name);
+    }));
+  }
+  std::vector<msr::airlib::CameraInfo> result;
+  result.reserve(cameras.size());
+  for (auto& request : requests) {
+    result.push_back(request.get());
+  }
+  return result;
+}
+
+bool AirsimSimulator::readCameraInfos() {
+  // Camera params (e.g. FOV) are needed by the processors, e.g. to generate
+  // pointclouds. This assumes the cameras exist, which should always be the
+  // case with the auto-generated-config.
+  std::vector<Config::Camera*> cameras;
+  for (const auto& sensor : config_.sensors) {
+    if (sensor->sensor_type == Config::Sensor::TYPE_CAMERA) {
+      cameras.push_back((Config::Camera*)sensor.get());
+    }
+  }
+  if (cameras.empty()) {
+    return true;
+  }
+  const uint64_t key = computeSettingsHash();
+  std::unique_ptr<CameraInfoCache> cache;
+  CameraInfoCache::CameraInfoMap cached_infos;
+  if (!config_.camera_info_cache_file.empty()) {
+    cache = std::make_unique<CameraInfoCache>(config_.camera_info_cache_file);
+    cache->load(key, &cached_infos);
+  }
+  std::vector<Config::Camera*> missing;
+  for (Config::Camera* camera : cameras) {
+    auto it = cached_infos.find(camera->vehicle_name + "/" + camera->name);
+    if (it != cached_infos.end()) {
+      camera->camera_info = it->second;
+    } else {
+      missing.push_back(camera);
+    }
+  }
+  if (missing.empty()) {
+    LOG(INFO) << "Loaded the camera infos from '"
+              << config_.camera_info_cache_file << "'.";
+    return true;
+  }
+  std::vector<msr::airlib::CameraInfo> camera_infos;
+  try {
+    camera_infos = fetchCameraInfos(missing);
+  } catch (const std::exception& e) {
+    LOG(ERROR) << "Could not read the camera infos from Airsim: " << e.what();
+    return false;
+  }
+  for (size_t i = 0; i < missing.size(); ++i) {
+    missing[i]->camera_info = camera_infos[i];
+    cached_infos[missing[i]->vehicle_name + "/" + missing[i]->name] =
+        camera_infos[i];
+  }
+  if (cache && !cache->save(key, cached_infos)) {
+    LOG(WARNING) << "Could not write the camera infos to '"
+                 << config_.camera_info_cache_file << "'.";
+  }
+  return true;
+}
+
+uint64_t AirsimSimulator::computeSettingsHash() {
+  // The AirSim settings are generated from the private params, including the
+  // top-level camera defaults, so all of them identify the cameras.
+  XmlRpc::XmlRpcValue settings;
+  if (!nh_private_.getParam(nh_private_.getNamespace(), settings)) {
+    return 0;
+  }
+  return CameraInfoCache::computeKey(settings.toXml());
+}
+
 bool AirsimSimulator::setupROS() {
   // General
-  sim_state_timer_ =
-      nh_.createTimer(ros::Duration(1.0 / config_.state_refresh_rate),
-                      &AirsimSimulator::simStateCallback, this);
-  odom_pub_ = nh_.advertise<nav_msgs::Odometry>(
-      config_.vehicle_name + "/ground_truth/odometry", 5);
-  pose_pub_ = nh_.advertise<geometry_msgs::PoseStamped>(
-      config_.vehicle_name + "/ground_truth/pose", 5);
-  collision_pub_ =
-      nh_.advertise<std_msgs::Bool>(config_.vehicle_name + "/collision", 1);
+  if (config_.collision_check_rate > 0.0) {
+    collision_timer_ =
+        nh_.createTimer(ros::Duration(1.0 / config_.collision_check_rate),
+                        &AirsimSimulator::collisionCallback, this);
+  }
   sim_is_ready_pub_ = nh_.advertise<std_msgs::Bool>("simulation_is_ready", 1);
   if (use_sim_time_) {
     time_pub_ = nh_.advertise<rosgraph_msgs::Clock>("/clock", 50);
   }
 
-  // control interfaces
-  command_pose_sub_ =
-      nh_.subscribe(config_.vehicle_name + "/command/pose", 10,
-                    &AirsimSimulator::commandPoseCallback, this);
+  // vehicles and their control interfaces
+  CommandChannel::Config command_config;
+  command_config.max_command_age = config_.command_max_age;
+  command_channel_ = std::make_unique<CommandChannel>(command_config, nh_);
+  for (size_t i = 0; i < vehicles_.size(); ++i) {
+    VehicleInterface& vehicle = vehicles_[i];
+    vehicle.state_timer = nh_.createTimer(
+        ros::Duration(1.0 / config_.state_refresh_rate),
+        boost::function<void(const ros::TimerEvent&)>(
+            [this, i](const ros::TimerEvent&) { simStateCallback(i); }));
+    vehicle.odom_pub = nh_.advertise<nav_msgs::Odometry>(
+        vehicle.name + "/ground_truth/odometry", 5);
+    vehicle.pose_pub = nh_.advertise<geometry_msgs::PoseStamped>(
+        vehicle.name + "/ground_truth/pose", 5);
+    vehicle.collision_pub =
+        nh_.advertise<std_msgs::Bool>(vehicle.name + "/collision", 1);
+    vehicle.odometry_drift_simulator->setFrameNames(
+        config_.simulator_frame_name, vehicle.name);
+    vehicle.command_pose_sub = nh_.subscribe<geometry_msgs::Pose>(
+        vehicle.name + "/command/pose", 10,
+        boost::function<void(const geometry_msgs::Pose::ConstPtr&)>(
+            [this, i](const geometry_msgs::Pose::ConstPtr& msg) {
+              commandPoseCallback(*msg, i);
+            }));
+    vehicle.command_trajectory_sub = nh_.subscribe<nav_msgs::Path>(
+        vehicle.name + "/command/trajectory", 10,
+        boost::function<void(const nav_msgs::Path::ConstPtr&)>(
+            [this, i](const nav_msgs::Path::ConstPtr& msg) {
+              commandTrajectoryCallback(*msg, i);
+            }));
+    vehicle.trajectory_progress_pub = nh_.advertise<std_msgs::Float32>(
+        vehicle.name + "/command/trajectory_progress", 1);
+    if (config_.command_mode == "teleport") {
+      vehicle.pose_reached_pub = nh_.advertise<geometry_msgs::PoseStamped>(
+          vehicle.name + "/command/pose_reached", 10);
+    }
+    vehicle.command_velocity_sub =
+        command_channel_->subscribe<geometry_msgs::TwistStamped>(
+            vehicle.name + "/command/velocity",
+            [this, i](const geometry_msgs::TwistStamped& msg) {
+              return commandVelocityCallback(msg, i);
+            });
+    vehicle.command_rates_sub =
+        command_channel_->subscribe<geometry_msgs::TwistStamped>(
+            vehicle.name + "/command/rates",
+            [this, i](const geometry_msgs::TwistStamped& msg) {
+              return commandRatesCallback(msg, i);
+            });
+    vehicle.command_attitude_sub =
+        command_channel_->subscribe<geometry_msgs::PoseStamped>(
+            vehicle.name + "/command/attitude",
+            [this, i](const geometry_msgs::PoseStamped& msg) {
+              return commandAttitudeCallback(msg, i);
+            });
+    vehicle.render_viewpoints_srv = nh_.advertiseService(
+        vehicle.name + "/render_viewpoints",
+        boost::function<bool(RenderViewpoints::Request&,
+                             RenderViewpoints::Response&)>(
+            [this, i](RenderViewpoints::Request& request,
+                      RenderViewpoints::Response& response) {
+              return renderViewpointsCallback(request, response, i);
+            }));
+  }
 
   // sensors
   for (size_t i = 0; i < config_.sensors.size(); ++i) {
@@ -287,32 +1014,30 @@ bool AirsimSimulator::setupROS() {
     SensorTimer* timer = nullptr;
     if (!config_.sensors[i]->force_separate_timer) {
       for (const auto& t : sensor_timers_) {
-        if (!t->isPrivate() && t->getRate() == config_.sensors[i]->rate) {
+        if (!t->isPrivate() && t->getRate() == config_.sensors[i]->rate &&
+            t->getVehicleName() == config_.sensors[i]->vehicle_name &&
+            t->getServerIndex() == config_.sensors[i]->server) {
           timer = t.get();
           break;
         }
       }
     }
     if (timer == nullptr) {
+      // Spread the timers of a server over its sensor clients.
+      const size_t client_index = std::count_if(
+          sensor_timers_.begin(), sensor_timers_.end(),
+          [&](const std::unique_ptr<SensorTimer>& t) {
+            return t->getServerIndex() == config_.sensors[i]->server;
+          });
       sensor_timers_.push_back(std::make_unique<SensorTimer>(
           nh_, config_.sensors[i]->rate,
-          config_.sensors[i]->force_separate_timer, config_.vehicle_name,
-          this));
+          config_.sensors[i]->force_separate_timer,
+          config_.sensors[i]->vehicle_name, config_.sensors[i]->server,
+          client_index, this));
       timer = sensor_timers_.back().get();
     }
     timer->addSensor(*this, i);
 
-    // Save camera params (e.g. FOV) as they are needed to generate pointcloud
-    if (config_.sensors[i]->sensor_type == Config::Sensor::TYPE_CAMERA) {
-      auto camera = (Config::Camera*)config_.sensors[i].get();
-      // This assumes the camera exists, which should always be the case with
-      // the auto-generated-config.
-      camera->camera_info = airsim_move_client_.simGetCameraInfo(
-              camera->name, config_.vehicle_name);
-      // TODO(Schmluk): Might want to also publish the camera info or convert
-      // to intrinsics etc
-     }
-
     if (!config_.publish_sensor_transforms) {
       // Broadcast all sensor mounting transforms via static tf.
       geometry_msgs::TransformStamped static_transformStamped;
@@ -322,7 +1047,8 @@ bool AirsimSimulator::setupROS() {
         rotation = Eigen::Quaterniond(0.5, -0.5, 0.5, -0.5) * rotation;
       }
       static_transformStamped.header.stamp = ros::Time::now();
-      static_transformStamped.header.frame_id = config_.vehicle_name;
+      static_transformStamped.header.frame_id =
+          config_.sensors[i]->vehicle_name;
       static_transformStamped.child_frame_id = config_.sensors[i]->frame_name;
       static_transformStamped.transform.translation.x =
           config_.sensors[i]->translation.x();
@@ -338,29 +1064,19 @@ bool AirsimSimulator::setupROS() {
     }
   }
 
-  // Simulator processors (find names and let them create themselves)
-  std::vector<std::string> keys;
-  nh_private_.getParamNames(keys);
-  std::string proc_ns = "processors/";
-  std::string full_ns = nh_private_.getNamespace() + "/" + proc_ns;
-  std::string proc_name;
-  std::vector<std::string> processors;
-  size_t pos;
-  for (auto const& key : keys) {
-    if ((pos = key.find(full_ns)) != std::string::npos) {
-      proc_name = key;
-      proc_name.erase(0, pos + full_ns.length());
-      pos = proc_name.find('/');
-      if (pos != std::string::npos) {
-        proc_name = proc_name.substr(0, pos);
-      }
-      if (std::find(processors.begin(), processors.end(), proc_name) ==
-          processors.end()) {
-        processors.push_back(proc_name);
-      }
-    }
+  // Simulator processors (names were found with the sensors, let them create
+  // themselves)
+  std::string full_ns = nh_private_.getNamespace() + "/processors/";
+  const bool has_cameras =
+      std::any_of(config_.sensors.begin(), config_.sensors.end(),
+                  [](const std::unique_ptr<Config::Sensor>& sensor) {
+                    return sensor->sensor_type == Config::Sensor::TYPE_CAMERA;
+                  });
+  if (!processor_names_.empty() || has_cameras) {
+    processing_pool_ = std::make_unique<simulator_processor::WorkStealingPool>(
+        config_.processing_threads);
   }
-  for (auto const& name : processors) {
+  for (auto const& name : processor_names_) {
     if (!nh_private_.hasParam(full_ns + name + "/processor_type")) {
       LOG(ERROR) << "Sensor processor '" << name
                  << "' does not name a 'processor_type' and will be ignored.";
@@ -368,19 +1084,172 @@ bool AirsimSimulator::setupROS() {
     }
     std::string type;
     nh_private_.getParam(full_ns + name + "/processor_type", type);
-    processors_.push_back(simulator_processor::ProcessorFactory::createFromRos(
-        name, type, nh_, full_ns + name + "/", this));
+    auto processor = simulator_processor::ProcessorFactory::createFromRos(
+        name, type, nh_, full_ns + name + "/", this);
+    if (processor) {
+      processors_.push_back(std::move(processor));
+    }
+  }
+  setupProcessingGraph();
+
+  // Now that all image producers and consumers are known connect them.
+  frame_dispatcher_.setInlineProcessing(config_.inline_processing);
+  frame_dispatcher_.connect();
+  if (config_.processing_report_interval > 0.0) {
+    processing_report_timer_ = nh_private_.createWallTimer(
+        ros::WallDuration(config_.processing_report_interval),
+        &AirsimSimulator::processingReportCallback, this);
   }
+  command_channel_->start();
   return true;
 }
 
+void AirsimSimulator::setupProcessingGraph() {
+  // Processors are connected if one consumes an image topic of the other.
+  // Order them topologically and log the resulting graph.
+  const size_t num_processors = processors_.size();
+  std::unordered_map<std::string, std::vector<size_t>> producers;
+  for (size_t i = 0; i < num_processors; ++i) {
+    for (const std::string& topic : processors_[i]->getOutputTopics()) {
+      producers[topic].push_back(i);
+    }
+  }
+  std::vector<std::vector<size_t>> consumers(num_processors);
+  std::vector<int> num_inputs(num_processors, 0);
+  for (size_t i = 0; i < num_processors; ++i) {
+    for (const std::string& topic : processors_[i]->getInputTopics()) {
+      auto it = producers.find(topic);
+      if (it == producers.end()) {
+        continue;  // Produced by a sensor or outside of this process.
+      }
+      for (size_t producer : it->second) {
+        consumers[producer].push_back(i);
+        num_inputs[i]++;
+      }
+    }
+  }
+
+  // Kahn's algorithm, the level is the length of the longest input chain.
+  std::deque<size_t> ready;
+  std::vector<int> level(num_processors, 0);
+  std::vector<size_t> order;
+  for (size_t i = 0; i < num_processors; ++i) {
+    if (num_inputs[i] == 0) {
+      ready.push_back(i);
+    }
+  }
+  while (!ready.empty()) {
+    size_t current = ready.front();
+    ready.pop_front();
+    order.push_back(current);
+    for (size_t consumer : consumers[current]) {
+      level[consumer] = std::max(level[consumer], level[current] + 1);
+      if (--num_inputs[consumer] == 0) {
+        ready.push_back(consumer);
+      }
+    }
+  }
+  if (order.size() < num_processors) {
+    std::string cycle;
+    for (size_t i = 0; i < num_processors; ++i) {
+      if (num_inputs[i] > 0) {
+        cycle += (cycle.empty() ? "'" : ", '") + processors_[i]->getName() +
+                 "'";
+        order.push_back(i);
+      }
+    }
+    LOG(WARNING) << "The simulator processors " << cycle
+                 << " form a cycle, frames may circulate indefinitely.";
+  }
+
+  std::vector<std::unique_ptr<simulator_processor::ProcessorBase>> sorted;
+  std::stringstream graph;
+  for (size_t i : order) {
+    const auto& processor = processors_[i];
+    const auto& executor_config = processor->getExecutor()->getConfig();
+    graph << "\n  [" << level[i] << "] " << processor->getName() << " (";
+    if (processor->getExecutor()->usesSharedPool()) {
+      graph << "shared pool";
+    } else {
+      graph << executor_config.num_threads << " thread(s)";
+    }
+    graph << "):";
+    for (const std::string& topic : processor->getInputTopics()) {
+      graph << " " << topic;
+    }
+    graph << " ->";
+    for (const std::string& topic : processor->getOutputTopics()) {
+      graph << " " << topic;
+    }
+    sorted.push_back(std::move(processors_[i]));
+  }
+  processors_ = std::move(sorted);
+  if (num_processors > 0) {
+    LOG(INFO) << "Simulator processing graph ([stage] name (executor): inputs "
+                 "-> outputs):"
+              << graph.str();
+  }
+}
+
+void AirsimSimulator::processingReportCallback(const ros::WallTimerEvent&) {
+  const CommandChannel::Statistics commands =
+      command_channel_->getAndResetStatistics();
+  if (commands.num_executed + commands.num_dropped > 0) {
+    LOG(INFO) << "Commands over the last "
+              << config_.processing_report_interval << "s: "
+              << commands.num_executed << " executed, "
+              << commands.num_dropped << " dropped, latency mean "
+              << (commands.num_executed > 0
+                      ? commands.total_latency / commands.num_executed
+                      : 0.0) *
+                     1000.0
+              << "ms, max " << commands.max_latency * 1000.0 << "ms.";
+  }
+  MessagePoolStatistics sensor_pools;
+  for (const auto& timer : sensor_timers_) {
+    sensor_pools += timer->getAndResetPoolStatistics();
+  }
+  if (sensor_pools.num_hits + sensor_pools.num_misses > 0) {
+    LOG(INFO) << "Sensor message pools over the last "
+              << config_.processing_report_interval << "s: "
+              << sensor_pools.num_hits << " reused, "
+              << sensor_pools.num_misses << " allocated, currently "
+              << sensor_pools.current_bytes / 1e6 << "MB pooled.";
+  }
+  if (processors_.empty()) {
+    return;
+  }
+  std::stringstream report;
+  report << "Simulator processor execution times over the last "
+         << config_.processing_report_interval << "s:";
+  for (const auto& processor : processors_) {
+    auto statistics = processor->getExecutor()->getAndResetStatistics();
+    double mean = statistics.num_calls > 0
+                      ? statistics.total_time / statistics.num_calls
+                      : 0.0;
+    report << "\n  " << processor->getName() << ": " << statistics.num_calls
+           << " calls, mean " << mean * 1000.0 << "ms, max "
+           << statistics.max_time * 1000.0 << "ms, busy "
+           << statistics.total_time / config_.processing_report_interval *
+                  100.0
+           << "%";
+    const MessagePoolStatistics pool = processor->getAndResetPoolStatistics();
+    if (pool.num_hits + pool.num_misses > 0) {
+      report << ", " << pool.num_hits << " buffers reused, "
+             << pool.num_misses << " allocated, peak "
+             << pool.peak_bytes / 1e6 << "MB";
+    }
+  }
+  LOG(INFO) << report.str();
+}
+
 bool AirsimSimulator::initializeSimulationFrame() {
   if (is_shutdown_) {
     return false;
   }
   // For frame conventions see coords/frames section in the readme/doc
   msr::airlib::Pose pose =
-      airsim_state_client_.simGetVehiclePose(config_.vehicle_name);
+      airsim_state_client_->simGetVehiclePose(config_.vehicle_name);
   Eigen::Quaterniond ori(pose.orientation.w(), pose.orientation.x(),
                          pose.orientation.y(), pose.orientation.z());
   Eigen::Vector3d euler = ori.toRotationMatrix().eulerAngles(
@@ -405,20 +1274,27 @@ bool AirsimSimulator::initializeSimulationFrame() {
   return true;
 }
 
-void AirsimSimulator::commandPoseCallback(const geometry_msgs::Pose& msg) {
+void AirsimSimulator::commandPoseCallback(const geometry_msgs::Pose& msg,
+                                          size_t vehicle_index) {
   if (!is_running_) {
     return;
   }
+  const VehicleInterface& vehicle = vehicles_[vehicle_index];
 
   // Input pose is in drifting odom frame, we therefore
   // first convert it back into Unreal GT frame
   OdometryDriftSimulator::Transformation T_drift_command;
   tf::poseMsgToKindr(msg, &T_drift_command);
   const OdometryDriftSimulator::Transformation T_gt_command =
-      odometry_drift_simulator_.convertDriftedToGroundTruthPose(
+      vehicle.odometry_drift_simulator->convertDriftedToGroundTruthPose(
           T_drift_command);
   OdometryDriftSimulator::Transformation::Position t_gt_current_position =
-      odometry_drift_simulator_.getGroundTruthPose().getPosition();
+      vehicle.odometry_drift_simulator->getGroundTruthPose().getPosition();
+  if (config_.command_mode == "teleport") {
+    clearTrajectory(vehicle_index);
+    teleportVehicle(vehicle_index, T_gt_command);
+    return;
+  }
 
   // Use position + yaw as setpoint
   auto command_pos = T_gt_command.getPosition();
@@ -431,36 +1307,623 @@ void AirsimSimulator::commandPoseCallback(const geometry_msgs::Pose& msg) {
   // cases
   yaw = yaw / M_PI * 180.0;
   constexpr double kMinMovingDistance = 0.1;  // m
-  airsim_move_client_.cancelLastTask();
-  if ((command_pos - t_gt_current_position).norm() >= kMinMovingDistance) {
-    frame_converter_.rosToAirsim(&command_pos);
-    auto yaw_mode = msr::airlib::YawMode(false, yaw);
-    airsim_move_client_.moveToPositionAsync(
-        command_pos.x(), command_pos.y(), command_pos.z(), config_.velocity,
-        3600, config_.drive_train_type, yaw_mode, -1, 1, config_.vehicle_name);
+  clearTrajectory(vehicle_index);  // Single poses end any trajectory.
+  try {
+    std::shared_lock<std::shared_mutex> lock(clients_mutex_);
+    airsim_move_client_->cancelLastTask(vehicle.name);
+    if ((command_pos - t_gt_current_position).norm() >= kMinMovingDistance) {
+      // AirSim expects the position relative to the spawn of the vehicle.
+      frame_converter_.rosToAirsim(&command_pos);
+      command_pos -= vehicle.spawn_position;
+      auto yaw_mode = msr::airlib::YawMode(false, yaw);
+      airsim_move_client_->moveToPositionAsync(
+          command_pos.x(), command_pos.y(), command_pos.z(), config_.velocity,
+          3600, config_.drive_train_type, yaw_mode, -1, 1, vehicle.name);
+    } else {
+      // This second command catches the case if the total distance is too
+      // small, where the moveToPosition command returns without satisfying the
+      // yaw. If this is always run then apparently sometimes the move command
+      // is overwritten.
+      airsim_move_client_->rotateToYawAsync(yaw, 3600, 5, vehicle.name);
+    }
+  } catch (const std::exception& e) {
+    connection_supervisor_->reportDisconnect(std::string("move client: ") +
+                                             e.what());
+  }
+}
+
+void AirsimSimulator::commandTrajectoryCallback(const nav_msgs::Path& msg,
+                                                size_t vehicle_index) {
+  if (!is_running_ || msg.poses.empty()) {
+    return;
+  }
+  const VehicleInterface& vehicle = vehicles_[vehicle_index];
+
+  // Convert the whole path once from the drifting odom frame to the airsim
+  // frame relative to the spawn of the vehicle.
+  std::vector<Eigen::Vector3d> positions;
+  std::vector<ros::Time> stamps;
+  positions.reserve(msg.poses.size());
+  stamps.reserve(msg.poses.size());
+  bool is_timed = true;
+  OdometryDriftSimulator::Transformation T_gt_command;
+  for (const geometry_msgs::PoseStamped& pose : msg.poses) {
+    OdometryDriftSimulator::Transformation T_drift_command;
+    tf::poseMsgToKindr(pose.pose, &T_drift_command);
+    T_gt_command =
+        vehicle.odometry_drift_simulator->convertDriftedToGroundTruthPose(
+            T_drift_command);
+    positions.push_back(T_gt_command.getPosition());
+    is_timed &= !pose.header.stamp.isZero() &&
+                (stamps.empty() || pose.header.stamp > stamps.back());
+    stamps.push_back(pose.header.stamp);
+  }
+  frame_converter_.rosToAirsim(positions.data(), positions.size());
+  std::vector<msr::airlib::Vector3r> waypoints;
+  waypoints.reserve(positions.size());
+  for (const Eigen::Vector3d& position : positions) {
+    waypoints.push_back((position - vehicle.spawn_position).cast<float>());
+  }
+
+  // The yaw of the last pose is kept along the whole path.
+  Eigen::Quaterniond command_ori = T_gt_command.getEigenQuaternion();
+  frame_converter_.rosToAirsim(&command_ori);
+  const double yaw =
+      tf2::getYaw(tf2::Quaternion(command_ori.x(), command_ori.y(),
+                                  command_ori.z(), command_ori.w())) /
+      M_PI * 180.0;
+
+  msr::airlib::Vector3r current_position;
+  {
+    std::lock_guard<std::mutex> lock(vehicle_poses_mutex_);
+    current_position = vehicle.pose.position;
+  }
+  const ros::Time now = ros::Time::now();
+  Trajectory trajectory;
+  trajectory.waypoints.push_back(current_position);
+  {
+    std::lock_guard<std::mutex> lock(trajectories_mutex_);
+    const Trajectory& active = trajectories_[vehicle_index];
+    if (is_timed && !active.stamps.empty() && stamps.front() > now) {
+      // Keep the remaining part of the active trajectory until the new one
+      // starts.
+      for (size_t i = active.next_waypoint; i < active.waypoints.size() &&
+                                            active.stamps[i] < stamps.front();
+           ++i) {
+        trajectory.waypoints.push_back(active.waypoints[i]);
+        trajectory.stamps.push_back(active.stamps[i]);
+      }
+    }
+  }
+  trajectory.waypoints.insert(trajectory.waypoints.end(), waypoints.begin(),
+                              waypoints.end());
+  if (is_timed) {
+    trajectory.stamps.insert(trajectory.stamps.begin(), now);
+    trajectory.stamps.insert(trajectory.stamps.end(), stamps.begin(),
+                             stamps.end());
   } else {
-    // This second command catches the case if the total distance is too small,
-    // where the moveToPosition command returns without satisfying the yaw. If
-    // this is always run then apparently sometimes the move command is
-    // overwritten.
-    airsim_move_client_.rotateToYawAsync(yaw, 3600, 5, config_.vehicle_name);
+    trajectory.stamps.clear();
+  }
+  trajectory.arc_lengths.push_back(0.0);
+  for (size_t i = 1; i < trajectory.waypoints.size(); ++i) {
+    trajectory.arc_lengths.push_back(
+        trajectory.arc_lengths.back() +
+        (trajectory.waypoints[i] - trajectory.waypoints[i - 1]).norm());
+  }
+
+  // AirSim follows the path at a constant speed, for timed paths this is the
+  // average speed needed to arrive at the last stamp, up to max_velocity.
+  double velocity = config_.velocity;
+  if (is_timed && trajectory.arc_lengths.back() > 0.0) {
+    const double duration = (trajectory.stamps.back() - now).toSec();
+    if (duration <= 0.0) {
+      velocity = config_.max_velocity;
+      LOG(WARNING) << "Trajectory for vehicle '" << vehicle.name
+                   << "' ends " << -duration
+                   << "s in the past, following it at the max velocity of "
+                   << velocity << "m/s.";
+    } else if (trajectory.arc_lengths.back() / duration >
+               config_.max_velocity) {
+      velocity = config_.max_velocity;
+      LOG(WARNING) << "Trajectory for vehicle '" << vehicle.name
+                   << "' requires "
+                   << trajectory.arc_lengths.back() / duration
+                   << "m/s, limited to the max velocity of " << velocity
+                   << "m/s. It will arrive "
+                   << trajectory.arc_lengths.back() / velocity - duration
+                   << "s late.";
+    } else {
+      velocity = trajectory.arc_lengths.back() / duration;
+    }
+  }
+  const std::vector<msr::airlib::Vector3r> path(
+      trajectory.waypoints.begin() + 1, trajectory.waypoints.end());
+  {
+    std::lock_guard<std::mutex> lock(trajectories_mutex_);
+    trajectories_[vehicle_index] = std::move(trajectory);
+  }
+
+  // A new move command replaces the running one, so this is the only RPC.
+  try {
+    std::shared_lock<std::shared_mutex> lock(clients_mutex_);
+    airsim_move_client_->moveOnPathAsync(
+        path, velocity, 3600, config_.drive_train_type,
+        msr::airlib::YawMode(false, yaw), -1, 1, vehicle.name);
+  } catch (const std::exception& e) {
+    connection_supervisor_->reportDisconnect(std::string("move client: ") +
+                                             e.what());
+  }
+}
+
+void AirsimSimulator::updateTrajectoryProgress(
+    size_t vehicle_index, const msr::airlib::Vector3r& position) {
+  // Advance along the segments by projecting the current position onto them.
+  constexpr double kGoalTolerance = 0.2;  // m
+  float progress;
+  {
+    std::lock_guard<std::mutex> lock(trajectories_mutex_);
+    Trajectory& trajectory = trajectories_[vehicle_index];
+    const size_t num_waypoints = trajectory.waypoints.size();
+    if (num_waypoints < 2) {
+      return;
+    }
+    double distance = trajectory.arc_lengths[trajectory.next_waypoint - 1];
+    while (trajectory.next_waypoint < num_waypoints) {
+      const msr::airlib::Vector3r& start =
+          trajectory.waypoints[trajectory.next_waypoint - 1];
+      const msr::airlib::Vector3r segment =
+          trajectory.waypoints[trajectory.next_waypoint] - start;
+      const double length = segment.norm();
+      const double t =
+          length > 0.0 ? segment.dot(position - start) / (length * length)
+                       : 1.0;
+      if (t < 1.0) {
+        distance += std::max(t, 0.0) * length;
+        break;
+      }
+      distance = trajectory.arc_lengths[trajectory.next_waypoint];
+      trajectory.next_waypoint++;
+    }
+    const bool is_done =
+        (position - trajectory.waypoints.back()).norm() < kGoalTolerance;
+    progress = is_done || trajectory.arc_lengths.back() <= 0.0
+                   ? 1.f
+                   : std::min(distance / trajectory.arc_lengths.back(), 1.0);
+    if (is_done) {
+      trajectory = Trajectory();
+    }
+  }
+  const VehicleInterface& vehicle = vehicles_[vehicle_index];
+  if (vehicle.trajectory_progress_pub.getNumSubscribers() > 0) {
+    std_msgs::Float32 msg;
+    msg.data = progress;
+    vehicle.trajectory_progress_pub.publish(msg);
+  }
+}
+
+void AirsimSimulator::teleportVehicle(
+    size_t vehicle_index, const OdometryDriftSimulator::Transformation& T_gt) {
+  VehicleInterface& vehicle = vehicles_[vehicle_index];
+  msr::airlib::MultirotorState state;
+  try {
+    std::shared_lock<std::shared_mutex> lock(clients_mutex_);
+    airsim_move_client_->simSetVehiclePose(
+        vehiclePoseRosToAirsim(vehicle, T_gt), true, vehicle.name);
+    // Hold the new pose instead of flying back to the last goal.
+    airsim_move_client_->hoverAsync(vehicle.name);
+    state = airsim_move_client_->getMultirotorState(vehicle.name);
+  } catch (const std::exception& e) {
+    connection_supervisor_->reportDisconnect(std::string("move client: ") +
+                                             e.what());
+    return;
+  }
+
+  // Tick the drift simulator with the new pose before the sensors read it, s.t.
+  // their transforms and the odometry are consistent.
+  updateVehicleState(&vehicle, state);
+  for (const auto& timer : sensor_timers_) {
+    if (timer->getVehicleName() == vehicle.name) {
+      timer->trigger();
+    }
+  }
+  geometry_msgs::PoseStamped msg;
+  msg.header.stamp = getTimeStamp(state.timestamp);
+  msg.header.frame_id = config_.simulator_frame_name;
+  tf::poseKindrToMsg(vehicle.odometry_drift_simulator->getSimulatedPose(),
+                     &msg.pose);
+  vehicle.pose_reached_pub.publish(msg);
+}
+
+msr::airlib::Pose AirsimSimulator::vehiclePoseRosToAirsim(
+    const VehicleInterface& vehicle,
+    const OdometryDriftSimulator::Transformation& T_gt) const {
+  // Only position and yaw are applied, as for flying.
+  Eigen::Vector3d position = T_gt.getPosition();
+  frame_converter_.rosToAirsim(&position);
+  position -= vehicle.spawn_position;
+  Eigen::Quaterniond command_ori = T_gt.getEigenQuaternion();
+  frame_converter_.rosToAirsim(&command_ori);
+  const double yaw = tf2::getYaw(tf2::Quaternion(
+      command_ori.x(), command_ori.y(), command_ori.z(), command_ori.w()));
+  const Eigen::Quaterniond orientation(
+      Eigen::AngleAxisd(yaw, Eigen::Vector3d::UnitZ()));
+  return msr::airlib::Pose(position.cast<float>(), orientation.cast<float>());
+}
+
+void AirsimSimulator::clearTrajectory(size_t vehicle_index) {
+  std::lock_guard<std::mutex> lock(trajectories_mutex_);
+  trajectories_[vehicle_index] = Trajectory();
+}
+
+double AirsimSimulator::altitudeRosToAirsim(const VehicleInterface& vehicle,
+                                            double z) const {
+  // The altitude is given in the drifting odom frame at the current position.
+  OdometryDriftSimulator::Transformation T_drift =
+      vehicle.odometry_drift_simulator->getSimulatedPose();
+  T_drift.getPosition().z() = z;
+  Eigen::Vector3d position =
+      vehicle.odometry_drift_simulator->convertDriftedToGroundTruthPose(T_drift)
+          .getPosition();
+  frame_converter_.rosToAirsim(&position);
+  return position.z() - vehicle.spawn_position.z();
+}
+
+bool AirsimSimulator::commandVelocityCallback(
+    const geometry_msgs::TwistStamped& msg, size_t vehicle_index) {
+  if (!is_running_ || !is_connected_) {
+    return false;
+  }
+  const VehicleInterface& vehicle = vehicles_[vehicle_index];
+
+  // Rotate the velocity from the drifting odom frame into the Unreal GT frame.
+  Eigen::Vector3d velocity(msg.twist.linear.x, msg.twist.linear.y,
+                           msg.twist.linear.z);
+  velocity = vehicle.odometry_drift_simulator
+                 ->convertDriftedToGroundTruthPose(
+                     OdometryDriftSimulator::Transformation())
+                 .getRotationMatrix() *
+             velocity;
+  frame_converter_.rosToAirsim(&velocity);
+  const double yaw_rate = -msg.twist.angular.z / M_PI * 180.0;  // NED, deg/s
+  clearTrajectory(vehicle_index);
+  try {
+    std::shared_lock<std::shared_mutex> lock(clients_mutex_);
+    airsim_command_client_->moveByVelocityAsync(
+        velocity.x(), velocity.y(), velocity.z(), config_.command_hold_time,
+        config_.drive_train_type, msr::airlib::YawMode(true, yaw_rate),
+        vehicle.name);
+  } catch (const std::exception& e) {
+    connection_supervisor_->reportDisconnect(std::string("command client: ") +
+                                             e.what());
+    return false;
+  }
+  return true;
+}
+
+bool AirsimSimulator::commandRatesCallback(
+    const geometry_msgs::TwistStamped& msg, size_t vehicle_index) {
+  if (!is_running_ || !is_connected_) {
+    return false;
+  }
+  const VehicleInterface& vehicle = vehicles_[vehicle_index];
+
+  // Body rates are FLU in ROS and FRD in airsim.
+  const double z = altitudeRosToAirsim(vehicle, msg.twist.linear.z);
+  clearTrajectory(vehicle_index);
+  try {
+    std::shared_lock<std::shared_mutex> lock(clients_mutex_);
+    airsim_command_client_->moveByAngleRatesZAsync(
+        msg.twist.angular.x, -msg.twist.angular.y, -msg.twist.angular.z, z,
+        config_.command_hold_time, vehicle.name);
+  } catch (const std::exception& e) {
+    connection_supervisor_->reportDisconnect(std::string("command client: ") +
+                                             e.what());
+    return false;
   }
+  return true;
+}
+
+bool AirsimSimulator::commandAttitudeCallback(
+    const geometry_msgs::PoseStamped& msg, size_t vehicle_index) {
+  if (!is_running_ || !is_connected_) {
+    return false;
+  }
+  const VehicleInterface& vehicle = vehicles_[vehicle_index];
+
+  // Convert the attitude at the current position from the drifting odom frame
+  // into the Unreal GT frame.
+  OdometryDriftSimulator::Transformation T_drift_command =
+      vehicle.odometry_drift_simulator->getSimulatedPose();
+  Eigen::Quaterniond orientation(msg.pose.orientation.w, msg.pose.orientation.x,
+                                 msg.pose.orientation.y,
+                                 msg.pose.orientation.z);
+  T_drift_command.getRotation() =
+      OdometryDriftSimulator::Transformation::Rotation(
+          orientation.normalized());
+  Eigen::Quaterniond command_ori =
+      vehicle.odometry_drift_simulator
+          ->convertDriftedToGroundTruthPose(T_drift_command)
+          .getEigenQuaternion();
+  frame_converter_.rosToAirsim(&command_ori);
+  double roll, pitch, yaw;
+  tf2::Matrix3x3(tf2::Quaternion(command_ori.x(), command_ori.y(),
+                                 command_ori.z(), command_ori.w()))
+      .getRPY(roll, pitch, yaw);
+  const double z = altitudeRosToAirsim(vehicle, msg.pose.position.z);
+  clearTrajectory(vehicle_index);
+  try {
+    std::shared_lock<std::shared_mutex> lock(clients_mutex_);
+    airsim_command_client_->moveByRollPitchYawZAsync(
+        roll, pitch, yaw, z, config_.command_hold_time, vehicle.name);
+  } catch (const std::exception& e) {
+    connection_supervisor_->reportDisconnect(std::string("command client: ") +
+                                             e.what());
+    return false;
+  }
+  return true;
+}
+
+bool AirsimSimulator::renderViewpointsCallback(
+    RenderViewpoints::Request& request, RenderViewpoints::Response& response,
+    size_t vehicle_index) {
+  // Failures are returned in the response, s.t. callers get the reason.
+  const VehicleInterface& vehicle = vehicles_[vehicle_index];
+  if (!is_running_ || !is_connected_) {
+    response.message = "The simulator is not running.";
+    return true;
+  }
+
+  // Find the cameras, in the requested order.
+  std::vector<std::string> camera_names = request.cameras;
+  if (camera_names.empty()) {
+    for (const auto& sensor : config_.sensors) {
+      if (sensor->sensor_type == Config::Sensor::TYPE_CAMERA &&
+          sensor->vehicle_name == vehicle.name) {
+        camera_names.push_back(sensor->name);
+      }
+    }
+  }
+  std::vector<const Config::Camera*> cameras;
+  std::vector<msr::airlib::ImageCaptureBase::ImageRequest> image_requests;
+  for (const std::string& name : camera_names) {
+    auto it = std::find_if(config_.sensors.begin(), config_.sensors.end(),
+                           [&](const std::unique_ptr<Config::Sensor>& sensor) {
+                             return sensor->sensor_type ==
+                                        Config::Sensor::TYPE_CAMERA &&
+                                    sensor->vehicle_name == vehicle.name &&
+                                    sensor->name == name;
+                           });
+    if (it == config_.sensors.end()) {
+      response.message =
+          "Vehicle '" + vehicle.name + "' has no camera '" + name + "'.";
+      return true;
+    }
+    cameras.push_back(static_cast<const Config::Camera*>(it->get()));
+    msr::airlib::ImageCaptureBase::ImageRequest image_request;
+    image_request.camera_name = name;
+    image_request.compress = false;
+    image_request.image_type = cameras.back()->image_type;
+    image_request.pixels_as_float = cameras.back()->pixels_as_float;
+    image_requests.push_back(image_request);
+  }
+  response.cameras = camera_names;
+  if (cameras.empty()) {
+    response.message = "Vehicle '" + vehicle.name + "' has no cameras.";
+    return true;
+  }
+  if (request.poses.empty()) {
+    response.success = true;
+    return true;
+  }
+
+  // The poses are given in the drifting odom frame.
+  std::vector<msr::airlib::Pose> view_poses;
+  view_poses.reserve(request.poses.size());
+  for (const geometry_msgs::Pose& pose : request.poses) {
+    OdometryDriftSimulator::Transformation T_drift;
+    tf::poseMsgToKindr(pose, &T_drift);
+    view_poses.push_back(vehiclePoseRosToAirsim(
+        vehicle,
+        vehicle.odometry_drift_simulator->convertDriftedToGroundTruthPose(
+            T_drift)));
+  }
+  response.images.reserve(view_poses.size() * cameras.size());
+  if (request.compute_pointclouds) {
+    response.pointclouds.resize(view_poses.size() * cameras.size());
+  }
+
+  // The physics of all vehicles are paused during the batch. The state and
+  // collision timers are stopped for the whole batch, of the sensors only
+  // those of this vehicle are stopped, s.t. the views are not published as
+  // such.
+  std::lock_guard<std::mutex> render_lock(render_viewpoints_mutex_);
+  for (VehicleInterface& state_vehicle : vehicles_) {
+    state_vehicle.state_timer.stop();
+  }
+  collision_timer_.stop();
+  for (const auto& timer : sensor_timers_) {
+    if (timer->getVehicleName() == vehicle.name) {
+      timer->pause();
+    }
+  }
+
+  std::string disconnect_reason;
+  {
+    std::shared_lock<std::shared_mutex> lock(clients_mutex_);
+    msr::airlib::MultirotorRpcLibClient* client =
+        airsim_viewpoint_client_.get();
+    msr::airlib::Pose initial_pose;
+    bool is_paused = false;
+    auto restore = [&]() {
+      if (is_paused) {
+        client->simSetVehiclePose(initial_pose, true, vehicle.name);
+        client->simPause(false);
+        is_paused = false;
+      }
+    };
+    auto render = [&](size_t i) {
+      client->simSetVehiclePose(view_poses[i], true, vehicle.name);
+      return client->simGetImages(image_requests, vehicle.name);
+    };
+    try {
+      initial_pose = client->simGetVehiclePose(vehicle.name);
+      client->simPause(true);
+      is_paused = true;
+
+      // Render the next view while converting the current one.
+      std::future<std::vector<msr::airlib::ImageCaptureBase::ImageResponse>>
+          next_view = std::async(std::launch::async, render, 0);
+      for (size_t i = 0; i < view_poses.size(); ++i) {
+        const std::vector<msr::airlib::ImageCaptureBase::ImageResponse>
+            responses = next_view.get();
+        if (i + 1 < view_poses.size()) {
+          next_view = std::async(std::launch::async, render, i + 1);
+        }
+        for (size_t j = 0; j < cameras.size() && j < responses.size(); ++j) {
+          response.images.emplace_back();
+          sensor_msgs::Image& image = response.images.back();
+          SensorTimer::convertImage(responses[j], &image);
+          image.header.stamp = getTimeStamp(responses[j].time_stamp);
+          image.header.frame_id = cameras[j]->frame_name;
+          // Only planar depth is the z coordinate the intrinsics expect.
+          if (request.compute_pointclouds && responses[j].pixels_as_float &&
+              cameras[j]->image_type ==
+                  msr::airlib::ImageCaptureBase::ImageType::DepthPlanar) {
+            sensor_msgs::PointCloud2& cloud =
+                response.pointclouds[i * cameras.size() + j];
+            cloud.header = image.header;
+            depthImageToPointcloud(responses[j], cameras[j]->camera_info.fov,
+                                   request.max_depth, &cloud);
+          }
+        }
+      }
+      restore();
+      response.success = true;
+    } catch (const rpc::rpc_error& e) {
+      // The server rejected a request, e.g. for an unknown camera.
+      response.message = e.get_error().as<std::string>();
+    } catch (const std::exception& e) {
+      response.message = e.what();
+      disconnect_reason = e.what();
+    }
+    // Leave the simulation as found if the server is still reachable.
+    try {
+      restore();
+    } catch (const std::exception& e) {
+      disconnect_reason = e.what();
+    }
+  }
+  if (response.success &&
+      response.images.size() != view_poses.size() * cameras.size()) {
+    response.success = false;
+    response.message = "Airsim returned fewer images than requested.";
+  }
+
+  // Resume unless the connection is lost, the supervisor resumes then.
+  if (is_connected_) {
+    for (VehicleInterface& state_vehicle : vehicles_) {
+      state_vehicle.state_timer.start();
+    }
+    if (config_.collision_check_rate > 0.0) {
+      collision_timer_.start();
+    }
+    for (const auto& timer : sensor_timers_) {
+      if (timer->getVehicleName() == vehicle.name) {
+        timer->resume();
+      }
+    }
+  }
+  if (!disconnect_reason.empty()) {
+    connection_supervisor_->reportDisconnect("viewpoint client: " +
+                                             disconnect_reason);
+  }
+  return true;
+}
+
+void AirsimSimulator::setStartupStage(StartupStage stage) {
+  startup_stage_ = stage;
+  startup_stage_start_ = std::chrono::steady_clock::now();
 }
 
 void AirsimSimulator::startupCallback(const ros::TimerEvent&) {
-  // Startup the drone, this should set the MAV hovering at 'PlayerStart' in
-  // unreal
+  // Startup the drones, this should set every MAV hovering at its spawn
+  // ('PlayerStart' for a single vehicle) in unreal. The move tasks are not
+  // waited on but their progress is checked every tick, s.t. the sensors
+  // already stream and all vehicles take off in parallel.
+  constexpr double kTakeoffTimeout = 2.0;          // s
+  constexpr double kMoveToStartTimeout = 10.0;     // s
+  constexpr double kStartPositionTolerance = 0.5;  // m, AirSim move accuracy
+  const double stage_duration =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                    startup_stage_start_)
+          .count();
+  try {
+    std::shared_lock<std::shared_mutex> lock(clients_mutex_);
+    switch (startup_stage_) {
+      case StartupStage::kArming: {
+        for (const VehicleInterface& vehicle : vehicles_) {
+          airsim_move_client_->enableApiControl(
+              true, vehicle.name);  // Also disables user control, which is good
+          airsim_move_client_->armDisarm(true, vehicle.name);
+          airsim_move_client_->takeoffAsync(kTakeoffTimeout, vehicle.name);
+        }
+        setStartupStage(StartupStage::kTakingOff);
+        return;
+      }
+      case StartupStage::kTakingOff: {
+        bool is_flying = true;
+        {
+          std::lock_guard<std::mutex> poses_lock(vehicle_poses_mutex_);
+          for (const VehicleInterface& vehicle : vehicles_) {
+            is_flying &=
+                vehicle.landed_state == msr::airlib::LandedState::Flying;
+          }
+        }
+        if (!is_flying && stage_duration < kTakeoffTimeout) {
+          return;
+        }
+        for (const VehicleInterface& vehicle : vehicles_) {
+          airsim_move_client_->moveToPositionAsync(
+              0, 0, 0, 5, msr::airlib::Utils::max<float>(),
+              config_.drive_train_type, msr::airlib::YawMode(), -1, 1,
+              vehicle.name);
+        }
+        setStartupStage(StartupStage::kMovingToStart);
+        return;
+      }
+      case StartupStage::kMovingToStart: {
+        // Positions are relative to the spawn of every vehicle. Vehicles
+        // that did not settle in time are released where they are.
+        std::lock_guard<std::mutex> poses_lock(vehicle_poses_mutex_);
+        for (const VehicleInterface& vehicle : vehicles_) {
+          if (vehicle.pose_timestamp != 0 &&
+              vehicle.pose.position.norm() <= kStartPositionTolerance) {
+            continue;
+          }
+          if (stage_duration < kMoveToStartTimeout) {
+            return;
+          }
+          LOG(WARNING) << "Vehicle '" << vehicle.name
+                       << "' did not reach its start position within "
+                       << kMoveToStartTimeout << "s, starting anyway.";
+        }
+        break;
+      }
+    }
+  } catch (const std::exception& e) {
+    // The startup is repeated when the simulation is resumed.
+    connection_supervisor_->reportDisconnect(std::string("startup: ") +
+                                             e.what());
+    return;
+  }
   startup_timer_.stop();
-  airsim_move_client_.enableApiControl(
-      true);  // Also disables user control, which is good
-  airsim_move_client_.armDisarm(true);
-  airsim_move_client_.takeoffAsync(2)->waitOnLastTask();
-  airsim_move_client_.moveToPositionAsync(0, 0, 0, 5)->waitOnLastTask();
   is_running_ = true;
   std_msgs::Bool msg;
   msg.data = true;
   sim_is_ready_pub_.publish(msg);
-  odometry_drift_simulator_.start();
+  for (const VehicleInterface& vehicle : vehicles_) {
+    vehicle.odometry_drift_simulator->start();
+  }
   LOG(INFO) << "Airsim simulation is ready!";
 }
 
@@ -470,14 +1933,34 @@ bool AirsimSimulator::startSimTimer() {
    * as default for time-stamping according to their docs, these are drifting
    * clocks! If use_sim_time is set in the launch file, we just use airsim time
    * as ros time and publish it at a fixed wall-time frequency (see param
-   * time_publisher_interval).
+   * time_publisher_interval). The time is extrapolated from a clock model that
+   * is only synchronized with airsim every time_sync_interval, and held if no
+   * sync succeeded for several intervals.
    */
   if (use_sim_time_) {
+    SimClockModel::Config clock_config;
+    clock_config.resync_threshold = config_.time_sync_threshold;
+    clock_config.max_extrapolation =
+        std::max(clock_config.max_extrapolation,
+                 5e-3 * config_.time_sync_interval);
+    sim_clock_model_ = SimClockModel(clock_config);
     std::thread([this]() {
-      while (is_connected_) {
-        auto next = std::chrono::steady_clock::now() +
-                    std::chrono::milliseconds(config_.time_publisher_interval);
-        readSimTimeCallback();
+      auto next_sync = std::chrono::steady_clock::now();
+      while (!is_shutdown_) {
+        auto now = std::chrono::steady_clock::now();
+        auto next =
+            now + std::chrono::milliseconds(config_.time_publisher_interval);
+        if (!is_connected_) {
+          // Hold the clock while reconnecting.
+          std::this_thread::sleep_until(next);
+          continue;
+        }
+        if (now >= next_sync) {
+          readSimTimeCallback();
+          next_sync =
+              now + std::chrono::milliseconds(config_.time_sync_interval);
+        }
+        publishSimTimeCallback();
         if (next > std::chrono::steady_clock::now()) {
           std::this_thread::sleep_until(next);
         }
@@ -490,14 +1973,44 @@ bool AirsimSimulator::startSimTimer() {
 
 void AirsimSimulator::readSimTimeCallback() {
   /**
-   * TODO(schmluk): make this nice.
-   * This is currently a work-around as getting only the time stamp is not yet
-   * exposed. However, this call does not run on the game thread afaik and was
-   * not measured to slow down other tasks. Although this queries sim time via
-   * RPC call, it can run at ~4000 Hz so delay should be <1 ms.
+   * Only the time stamp is needed, so the IMU data is queried as the lightest
+   * RPC that carries the sim time. Vehicles without an IMU return an empty
+   * measurement with stamp 0, in which case this falls back to the full
+   * multirotor state. The sample is attributed to the middle of the call to
+   * cancel the RPC latency.
    */
-  uint64_t ts =
-      airsim_time_client_.getMultirotorState(config_.vehicle_name).timestamp;
+  uint64_t ts;
+  auto start = std::chrono::steady_clock::now();
+  try {
+    std::shared_lock<std::shared_mutex> lock(clients_mutex_);
+    ts = use_imu_time_
+             ? airsim_time_client_->getImuData("", config_.vehicle_name)
+                   .time_stamp
+             : 0;
+    if (ts == 0) {
+      if (use_imu_time_) {
+        LOG(INFO) << "Vehicle '" << config_.vehicle_name
+                  << "' has no IMU, reading the sim time from its state.";
+        use_imu_time_ = false;
+        start = std::chrono::steady_clock::now();
+      }
+      ts = airsim_time_client_->getMultirotorState(config_.vehicle_name)
+               .timestamp;
+    }
+  } catch (const std::exception& e) {
+    connection_supervisor_->reportDisconnect(std::string("time client: ") +
+                                             e.what());
+    return;
+  }
+  auto end = std::chrono::steady_clock::now();
+  sim_clock_model_.addSample(start + (end - start) / 2, ts);
+}
+
+void AirsimSimulator::publishSimTimeCallback() {
+  uint64_t ts = sim_clock_model_.getSimTime(std::chrono::steady_clock::now());
+  if (ts == 0) {
+    return;
+  }
   rosgraph_msgs::Clock msg;
   msg.clock.fromNSec(ts);
   time_pub_.publish(msg);
@@ -513,16 +2026,14 @@ ros::Time AirsimSimulator::getTimeStamp(msr::airlib::TTimePoint airsim_stamp) {
   }
 }
 
-void AirsimSimulator::simStateCallback(const ros::TimerEvent&) {
+void AirsimSimulator::simStateCallback(size_t vehicle_index) {
   if (is_shutdown_) {
     return;
   }
-  if (airsim_state_client_.getConnectionState() !=
+  if (airsim_state_client_->getConnectionState() !=
       msr::airlib::RpcLibClientBase::ConnectionState::Connected) {
-    LOG(FATAL) << "Airsim client was disconnected!";
-    is_connected_ = false;
-    is_running_ = false;
-    raise(SIGINT);
+    // Don't block on a dead client, the supervisor pauses this timer.
+    connection_supervisor_->reportDisconnect("state client disconnected");
     return;
   }
   /***
@@ -534,34 +2045,66 @@ void AirsimSimulator::simStateCallback(const ros::TimerEvent&) {
    * airsim_state_client_.simGetGroundTruthKinematics(config_.vehicle_name); But
    * that comes without a timestamp.
    */
-  msr::airlib::MultirotorState state =
-      airsim_state_client_.getMultirotorState(config_.vehicle_name);
+  // Each vehicle has its own timer, s.t. the round trips of several vehicles
+  // overlap on the shared client instead of adding up.
+  VehicleInterface& vehicle = vehicles_[vehicle_index];
+  msr::airlib::MultirotorState state;
+  try {
+    std::shared_lock<std::shared_mutex> lock(clients_mutex_);
+    state = airsim_state_client_->getMultirotorState(vehicle.name);
+  } catch (const std::exception& e) {
+    connection_supervisor_->reportDisconnect(std::string("state client: ") +
+                                             e.what());
+    return;
+  }
+  updateVehicleState(&vehicle, state);
+  updateTrajectoryProgress(vehicle_index,
+                           state.kinematics_estimated.pose.position);
+}
+
+void AirsimSimulator::updateVehicleState(
+    VehicleInterface* vehicle, const msr::airlib::MultirotorState& state) {
+  // Teleports update the state out of the state tick, skip older states.
+  std::lock_guard<std::mutex> update_lock(vehicle_state_update_mutex_);
+  if (state.timestamp < vehicle->pose_timestamp) {
+    return;
+  }
   ros::Time stamp = getTimeStamp(state.timestamp);
+  {
+    std::lock_guard<std::mutex> lock(vehicle_poses_mutex_);
+    vehicle->pose = state.kinematics_estimated.pose;
+    vehicle->pose_timestamp = state.timestamp;
+    vehicle->landed_state = state.landed_state;
+  }
 
-  // convert airsim pose to ROS
-  geometry_msgs::TransformStamped transformStamped;
-  transformStamped.header.stamp = stamp;
-  transformStamped.header.frame_id = config_.simulator_frame_name;
-  transformStamped.child_frame_id = config_.vehicle_name;
-  tf::vectorEigenToMsg(state.kinematics_estimated.pose.position.cast<double>(),
-                       transformStamped.transform.translation);
-  tf::quaternionEigenToMsg(
-      state.kinematics_estimated.pose.orientation.cast<double>(),
-      transformStamped.transform.rotation);
-  frame_converter_.airsimToRos(&transformStamped.transform);
+  // convert airsim pose to ROS, the pose is relative to the vehicle spawn
+  Eigen::Vector3d position =
+      state.kinematics_estimated.pose.position.cast<double>() +
+      vehicle->spawn_position;
+  Eigen::Quaterniond orientation =
+      state.kinematics_estimated.pose.orientation.cast<double>();
+  frame_converter_.airsimToRos(&position);
+  frame_converter_.airsimToRos(&orientation);
+  orientation.normalize();
 
   // simulate odometry drift
-  odometry_drift_simulator_.tick(transformStamped);
+  OdometryDriftSimulator* odometry_drift_simulator =
+      vehicle->odometry_drift_simulator.get();
+  odometry_drift_simulator->tick(
+      OdometryDriftSimulator::Transformation(
+          OdometryDriftSimulator::Transformation::Rotation(orientation),
+          position),
+      stamp);
 
   // publish TFs, odom msgs and pose msgs
-  odometry_drift_simulator_.publishTfs();
-  if (odom_pub_.getNumSubscribers() > 0) {
+  odometry_drift_simulator->publishTfs();
+  if (vehicle->odom_pub.getNumSubscribers() > 0) {
     nav_msgs::Odometry odom_msg;
     odom_msg.header.stamp = stamp;
     odom_msg.header.frame_id = config_.simulator_frame_name;
-    odom_msg.child_frame_id = config_.vehicle_name;
+    odom_msg.child_frame_id = vehicle->name;
 
-    tf::poseKindrToMsg(odometry_drift_simulator_.getSimulatedPose(),
+    tf::poseKindrToMsg(odometry_drift_simulator->getSimulatedPose(),
                        &odom_msg.pose.pose);
 
     odom_msg.twist.twist.linear.x = state.kinematics_estimated.twist.linear.x();
@@ -577,25 +2120,46 @@ void AirsimSimulator::simStateCallback(const ros::TimerEvent&) {
     frame_converter_.airsimToRos(&odom_msg.twist.twist.linear);
     frame_converter_.airsimToRos(&odom_msg.twist.twist.angular);
 
-    odom_pub_.publish(odom_msg);
+    vehicle->odom_pub.publish(odom_msg);
   }
-  if (pose_pub_.getNumSubscribers() > 0) {
+  if (vehicle->pose_pub.getNumSubscribers() > 0) {
     geometry_msgs::PoseStamped pose_msg;
     pose_msg.header.stamp = stamp;
     pose_msg.header.frame_id = config_.simulator_frame_name;
-    tf::poseKindrToMsg(odometry_drift_simulator_.getSimulatedPose(),
+    tf::poseKindrToMsg(odometry_drift_simulator->getSimulatedPose(),
                        &pose_msg.pose);
-    pose_pub_.publish(pose_msg);
+    vehicle->pose_pub.publish(pose_msg);
   }
+}
 
-  // collision (the CollisionInfo in the state does not get updated for whatever
-  // reason)
-  if (airsim_state_client_.simGetCollisionInfo(config_.vehicle_name)
-          .has_collided) {
-    LOG(WARNING) << "Collision detected for '" << config_.vehicle_name << "'!";
-    std_msgs::Bool msg;
-    msg.data = true;
-    collision_pub_.publish(msg);
+void AirsimSimulator::collisionCallback(const ros::TimerEvent&) {
+  /***
+   * NOTE: The collision is polled on a separate client and timer, s.t. the
+   * state ticks only cost a single round trip and the collision checks do not
+   * delay them. The CollisionInfo in the state does not get updated for
+   * whatever reason, so it has to be queried explicitly.
+   */
+  if (is_shutdown_) {
+    return;
+  }
+  for (const VehicleInterface& vehicle : vehicles_) {
+    bool has_collided;
+    try {
+      std::shared_lock<std::shared_mutex> lock(clients_mutex_);
+      has_collided =
+          airsim_collision_client_->simGetCollisionInfo(vehicle.name)
+              .has_collided;
+    } catch (const std::exception& e) {
+      connection_supervisor_->reportDisconnect(
+          std::string("collision client: ") + e.what());
+      return;
+    }
+    if (has_collided) {
+      LOG(WARNING) << "Collision detected for '" << vehicle.name << "'!";
+      std_msgs::Bool msg;
+      msg.data = true;
+      vehicle.collision_pub.publish(msg);
+    }
   }
 }
 
@@ -657,13 +2221,26 @@ bool AirsimSimulator::readTransformFromRos(const std::string& topic,
 
 void AirsimSimulator::onShutdown() {
   is_shutdown_ = true;
+  if (connection_supervisor_) {
+    connection_supervisor_->stop();
+  }
+  if (command_channel_) {
+    command_channel_->stop();
+  }
   for (const auto& timer : sensor_timers_) {
     timer->signalShutdown();
   }
+  for (const auto& processor : processors_) {
+    processor->stopExecutor();
+  }
   if (is_connected_) {
     LOG(INFO) << "Shutting down: resetting airsim server.";
-    airsim_state_client_.reset();
-    airsim_state_client_.enableApiControl(false);
+    try {
+      airsim_state_client_->reset();
+      airsim_state_client_->enableApiControl(false);
+    } catch (const std::exception& e) {
+      LOG(WARNING) << "Could not reset the airsim server: " << e.what();
+    }
   }
 }
 
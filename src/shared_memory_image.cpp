@@ -0,0 +1,269 @@
+#include "unreal_airsim/shared_memory_image.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <random>
+
+namespace unreal_airsim {
+namespace {
+// Segment layout: SegmentHeader, num_slots SlotHeaders, num_slots data slots,
+// each aligned to kAlignment.
+constexpr uint32_t kMagic = 0x55414931;  // 'UAI1'
+constexpr size_t kAlignment = 64;
+
+struct SegmentHeader {
+  uint32_t magic;
+  uint32_t num_slots;
+  uint64_t slot_size;
+  uint64_t segment_id;
+};
+
+struct SlotHeader {
+  std::atomic<int32_t> references;  // -1 while written
+  std::atomic<uint64_t> sequence;   // of the frame in the slot
+};
+
+size_t alignUp(size_t size) {
+  return (size + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+size_t slotHeaderOffset(size_t slot) {
+  return alignUp(sizeof(SegmentHeader)) + slot * alignUp(sizeof(SlotHeader));
+}
+
+size_t dataOffset(size_t num_slots, size_t slot_size, size_t slot) {
+  return slotHeaderOffset(num_slots) + slot * alignUp(slot_size);
+}
+
+// The id of the segment currently linked under the name, false if there is
+// none or it is not initialized.
+bool readSegmentId(const std::string& segment_name, uint64_t* segment_id) {
+  const int fd = shm_open(segment_name.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat file_stat;
+  void* memory = MAP_FAILED;
+  if (fstat(fd, &file_stat) == 0 &&
+      static_cast<size_t>(file_stat.st_size) >= sizeof(SegmentHeader)) {
+    memory = mmap(nullptr, sizeof(SegmentHeader), PROT_READ, MAP_SHARED, fd,
+                  0);
+  }
+  close(fd);
+  if (memory == MAP_FAILED) {
+    return false;
+  }
+  const auto* header = static_cast<const SegmentHeader*>(memory);
+  const bool is_valid = header->magic == kMagic;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  *segment_id = header->segment_id;
+  munmap(memory, sizeof(SegmentHeader));
+  return is_valid;
+}
+}  // namespace
+
+SharedImageWriter::SharedImageWriter(const std::string& segment_name,
+                                     size_t num_slots, size_t slot_size)
+    : segment_name_(segment_name),
+      num_slots_(num_slots),
+      slot_size_(slot_size) {
+  if (num_slots_ == 0) {
+    return;
+  }
+  // Readers keep their mappings of a replaced segment until they release it.
+  shm_unlink(segment_name_.c_str());
+  const int fd =
+      shm_open(segment_name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    return;
+  }
+  const size_t size = dataOffset(num_slots_, slot_size_, num_slots_);
+  void* memory = MAP_FAILED;
+  if (ftruncate(fd, size) == 0) {
+    memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (memory == MAP_FAILED) {
+    shm_unlink(segment_name_.c_str());
+    return;
+  }
+  memory_ = static_cast<uint8_t*>(memory);
+  mapped_size_ = size;
+
+  // Touch all pages now instead of on the first frames.
+  std::memset(memory_, 0, mapped_size_);
+  segment_id_ = (static_cast<uint64_t>(std::random_device()()) << 32) ^
+                std::chrono::steady_clock::now().time_since_epoch().count();
+  for (size_t slot = 0; slot < num_slots_; ++slot) {
+    auto* slot_header = new (memory_ + slotHeaderOffset(slot)) SlotHeader();
+    slot_header->references.store(0);
+    slot_header->sequence.store(0);
+  }
+  auto* header = reinterpret_cast<SegmentHeader*>(memory_);
+  header->num_slots = num_slots_;
+  header->slot_size = slot_size_;
+  header->segment_id = segment_id_;
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = kMagic;
+}
+
+SharedImageWriter::~SharedImageWriter() {
+  if (memory_ != nullptr) {
+    munmap(memory_, mapped_size_);
+    // Do not unlink a segment of the same name created by another writer.
+    uint64_t linked_segment_id;
+    if (readSegmentId(segment_name_, &linked_segment_id) &&
+        linked_segment_id == segment_id_) {
+      shm_unlink(segment_name_.c_str());
+    }
+  }
+}
+
+bool SharedImageWriter::write(const sensor_msgs::Image& image,
+                              SharedImage* descriptor) {
+  if (!isValid() || image.data.size() > slot_size_) {
+    return false;
+  }
+  for (size_t i = 0; i < num_slots_; ++i) {
+    const size_t slot = (next_slot_ + i) % num_slots_;
+    auto* slot_header =
+        reinterpret_cast<SlotHeader*>(memory_ + slotHeaderOffset(slot));
+    int32_t references = 0;
+    if (!slot_header->references.compare_exchange_strong(
+            references, -1, std::memory_order_acquire)) {
+      continue;  // Referenced by a reader.
+    }
+    std::memcpy(memory_ + dataOffset(num_slots_, slot_size_, slot),
+                image.data.data(), image.data.size());
+    ++sequence_;
+    slot_header->sequence.store(sequence_, std::memory_order_relaxed);
+    slot_header->references.store(0, std::memory_order_release);
+    next_slot_ = (slot + 1) % num_slots_;
+
+    descriptor->segment = segment_name_;
+    descriptor->segment_id = segment_id_;
+    descriptor->slot = slot;
+    descriptor->sequence = sequence_;
+    descriptor->height = image.height;
+    descriptor->width = image.width;
+    descriptor->encoding = image.encoding;
+    descriptor->is_bigendian = image.is_bigendian;
+    descriptor->step = image.step;
+    descriptor->size = image.data.size();
+    return true;
+  }
+  return false;
+}
+
+std::string SharedImageWriter::segmentName(const std::string& topic) {
+  // POSIX names contain a single leading slash.
+  std::string name = "/unreal_airsim";
+  for (const char c : topic) {
+    name += c == '/' ? '_' : c;
+  }
+  return name;
+}
+
+struct SharedImageReader::Mapping {
+  uint8_t* memory = nullptr;
+  size_t size = 0;
+  size_t num_slots = 0;
+  size_t slot_size = 0;
+  uint64_t segment_id = 0;
+
+  ~Mapping() {
+    if (memory != nullptr) {
+      munmap(memory, size);
+    }
+  }
+};
+
+std::shared_ptr<SharedImageReader::Mapping> SharedImageReader::getMapping(
+    const SharedImage& descriptor) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = mappings_.find(descriptor.segment);
+  if (it != mappings_.end() &&
+      it->second->segment_id == descriptor.segment_id) {
+    return it->second;
+  }
+
+  // Map the segment, or its replacement.
+  const int fd = shm_open(descriptor.segment.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat file_stat;
+  void* memory = MAP_FAILED;
+  if (fstat(fd, &file_stat) == 0 &&
+      static_cast<size_t>(file_stat.st_size) >= sizeof(SegmentHeader)) {
+    memory = mmap(nullptr, file_stat.st_size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (memory == MAP_FAILED) {
+    return nullptr;
+  }
+  auto mapping = std::make_shared<Mapping>();
+  mapping->memory = static_cast<uint8_t*>(memory);
+  mapping->size = file_stat.st_size;
+  const auto* header = reinterpret_cast<const SegmentHeader*>(memory);
+  if (header->magic != kMagic ||
+      mapping->size < dataOffset(header->num_slots, header->slot_size,
+                                 header->num_slots)) {
+    return nullptr;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  mapping->num_slots = header->num_slots;
+  mapping->slot_size = header->slot_size;
+  mapping->segment_id = header->segment_id;
+  if (mapping->segment_id != descriptor.segment_id) {
+    return nullptr;  // The descriptor is from a replaced segment.
+  }
+  mappings_[descriptor.segment] = mapping;
+  return mapping;
+}
+
+std::shared_ptr<const uint8_t> SharedImageReader::read(
+    const SharedImage& descriptor) {
+  std::shared_ptr<Mapping> mapping = getMapping(descriptor);
+  if (!mapping || descriptor.slot >= mapping->num_slots ||
+      descriptor.size > mapping->slot_size) {
+    return nullptr;
+  }
+  auto* slot_header = reinterpret_cast<SlotHeader*>(
+      mapping->memory + slotHeaderOffset(descriptor.slot));
+
+  // Reference the slot unless it is being written, then verify it still holds
+  // the described frame.
+  int32_t references = slot_header->references.load(std::memory_order_relaxed);
+  do {
+    if (references < 0) {
+      return nullptr;
+    }
+  } while (!slot_header->references.compare_exchange_weak(
+      references, references + 1, std::memory_order_acquire,
+      std::memory_order_relaxed));
+  if (slot_header->sequence.load(std::memory_order_relaxed) !=
+      descriptor.sequence) {
+    slot_header->references.fetch_sub(1, std::memory_order_release);
+    return nullptr;
+  }
+
+  // The pointer keeps the mapping alive and releases the slot.
+  const uint8_t* data =
+      mapping->memory +
+      dataOffset(mapping->num_slots, mapping->slot_size, descriptor.slot);
+  return std::shared_ptr<const uint8_t>(
+      data, [mapping, slot_header](const uint8_t*) {
+        slot_header->references.fetch_sub(1, std::memory_order_release);
+      });
+}
+
+}  // namespace unreal_airsim
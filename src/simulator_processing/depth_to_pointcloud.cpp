@@ -1,5 +1,6 @@
 #include "unreal_airsim/simulator_processing/depth_to_pointcloud.h"
 
+#include <algorithm>
 #include <cmath>
 #include <deque>
 #include <memory>
@@ -11,6 +12,7 @@
 #include <sensor_msgs/image_encodings.h>
 #include <sensor_msgs/point_cloud2_iterator.h>
 
+#include "unreal_airsim/compact_pointcloud.h"
 #include "unreal_airsim/online_simulator/simulator.h"
 
 namespace unreal_airsim::simulator_processor {
@@ -30,6 +32,10 @@ bool DepthToPointcloud::setupFromRos(const ros::NodeHandle& nh,
   nh.param(ns + "max_queue_length", max_queue_length_, 10);
   nh.param(ns + "max_depth", max_depth_, 1e6f);
   nh.param(ns + "max_ray_length", max_ray_length_, 1e6f);
+  nh.param(ns + "compact_encoding", compact_encoding_, false);
+  nh.param(ns + "compact_resolution", compact_resolution_,
+           compact_pointcloud::kDefaultResolution);
+  nh.param(ns + "drop_invalid_points", drop_invalid_points_, false);
   nh.param(ns + "output_topic", output_topic,
            parent_->getConfig().vehicle_name + "/" + name_);
   if (nh.hasParam(ns + "depth_camera_name")) {
@@ -86,19 +92,35 @@ bool DepthToPointcloud::setupFromRos(const ros::NodeHandle& nh,
                << segmentation_camera_name << "'!";
     return false;
   }
+  if (compact_encoding_) {
+    if (compact_resolution_ <= 0.f) {
+      LOG(ERROR) << "DepthToPointcloud requires 'compact_resolution' > 0.";
+      return false;
+    }
+    LOG(INFO) << "DepthToPointcloud '" << name_
+              << "' uses the compact encoding with resolution "
+              << compact_resolution_ << " m (max quantization error "
+              << std::sqrt(3.f) / 2.f * compact_resolution_ << " m, range +-"
+              << compact_resolution_ * 32767.f << " m).";
+  }
 
   // Ros.
   pub_ = nh_.advertise<sensor_msgs::PointCloud2>(output_topic, 5);
-  depth_sub_ = nh_.subscribe(depth_topic, max_queue_length_,
-                             &DepthToPointcloud::depthImageCallback, this);
+  subscribeImage(nh_, depth_topic, max_queue_length_,
+                 [this](const sensor_msgs::ImagePtr& msg) {
+                   depthImageCallback(msg);
+                 });
   if (use_color_) {
-    color_sub_ = nh_.subscribe(color_topic, max_queue_length_,
-                               &DepthToPointcloud::colorImageCallback, this);
+    subscribeImage(nh_, color_topic, max_queue_length_,
+                   [this](const sensor_msgs::ImagePtr& msg) {
+                     colorImageCallback(msg);
+                   });
   }
   if (use_segmentation_) {
-    segmentation_sub_ =
-        nh_.subscribe(segmentation_topic, max_queue_length_,
-                      &DepthToPointcloud::segmentationImageCallback, this);
+    subscribeImage(nh_, segmentation_topic, max_queue_length_,
+                   [this](const sensor_msgs::ImagePtr& msg) {
+                     segmentationImageCallback(msg);
+                   });
   }
   return true;
 }
@@ -106,10 +128,7 @@ bool DepthToPointcloud::setupFromRos(const ros::NodeHandle& nh,
 void DepthToPointcloud::depthImageCallback(const sensor_msgs::ImagePtr& msg) {
   // Use the first depth image to initialize intrinsics.
   if (!is_setup_) {
-    vx_ = msg->width / 2;
-    vy_ = msg->height / 2;
-    focal_length_ =
-        static_cast<float>(msg->width) / (2.0 * std::tan(fov_ * M_PI / 360.0));
+    intrinsics_ = DepthCameraIntrinsics(msg->width, msg->height, fov_);
     is_setup_ = true;
   }
 
@@ -226,8 +245,13 @@ void DepthToPointcloud::publishPointcloud(
   // figure out number of points
   int numpoints = depth_img->image.rows * depth_img->image.cols;
 
-  // declare message and sizes
-  sensor_msgs::PointCloud2 cloud;
+  // declare message and sizes, the buffer is recycled from earlier clouds.
+  const size_t point_step = 3 * sizeof(float) +
+                            (use_color_ ? sizeof(float) : 0) +
+                            (use_segmentation_ ? sizeof(uint8_t) : 0);
+  sensor_msgs::PointCloud2Ptr cloud_ptr =
+      cloud_pool_.acquire(numpoints * point_step);
+  sensor_msgs::PointCloud2& cloud = *cloud_ptr;
   cloud.header.frame_id = depth_ptr->header.frame_id;
   cloud.header.stamp = depth_ptr->header.stamp;
   cloud.width = numpoints;
@@ -264,6 +288,7 @@ void DepthToPointcloud::publishPointcloud(
     }
   }
   modifier.resize(numpoints);
+  int num_valid_points = 0;
 
   sensor_msgs::PointCloud2Iterator<float> out_x(cloud, "x");
   sensor_msgs::PointCloud2Iterator<float> out_y(cloud, "y");
@@ -284,8 +309,8 @@ void DepthToPointcloud::publishPointcloud(
       if (z > max_depth_) {
         continue;
       }
-      float x = (static_cast<float>(u) - vx_) * z / focal_length_;
-      float y = (static_cast<float>(v) - vy_) * z / focal_length_;
+      float x = intrinsics_.backProjectX(u, z);
+      float y = intrinsics_.backProjectY(v, z);
       if (max_ray_length_ > 0.0) {
         float dist_square = x * x + y * y + z * z;
         if (dist_square > max_ray_length_ * max_ray_length_) {
@@ -298,6 +323,7 @@ void DepthToPointcloud::publishPointcloud(
       ++out_x;
       ++out_y;
       ++out_z;
+      ++num_valid_points;
 
       if (use_color_) {
         cv::Vec3b color = color_img->image.at<cv::Vec3b>(v, u);
@@ -313,7 +339,35 @@ void DepthToPointcloud::publishPointcloud(
       }
     }
   }
-  pub_.publish(cloud);
+  if (drop_invalid_points_) {
+    modifier.resize(num_valid_points);
+  } else {
+    // Discarded points remain at the origin. The buffer is recycled, so the
+    // points of earlier clouds have to be cleared.
+    std::fill(cloud.data.begin() + num_valid_points * cloud.point_step,
+              cloud.data.end(), 0);
+  }
+
+  if (compact_encoding_) {
+    sensor_msgs::PointCloud2 compact_cloud;
+    compact_pointcloud::EncodingStatistics statistics;
+    if (compact_pointcloud::encode(cloud, compact_resolution_, &compact_cloud,
+                                   &statistics)) {
+      LOG_IF(WARNING, statistics.num_dropped > 0)
+          << "DepthToPointcloud '" << name_ << "': " << statistics.num_dropped
+          << " points exceed the compact encoding range and were dropped.";
+      VLOG(1) << "DepthToPointcloud '" << name_ << "': encoded "
+              << statistics.num_points << " points with max quantization error "
+              << statistics.max_error << " m (" << cloud.data.size() << " -> "
+              << compact_cloud.data.size() << " bytes).";
+      pub_.publish(compact_cloud);
+      return;
+    }
+    LOG_EVERY_N(WARNING, 100)
+        << "DepthToPointcloud '" << name_
+        << "': compact encoding failed, publishing the uncompressed cloud.";
+  }
+  pub_.publish(cloud_ptr);
 }
 
 }  // namespace unreal_airsim::simulator_processor
@@ -0,0 +1,198 @@
+#include "unreal_airsim/simulator_processing/ground_truth_map/ground_truth_map_builder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+
+#include <eigen_conversions/eigen_msg.h>
+#include <sensor_msgs/image_encodings.h>
+
+#include "unreal_airsim/depth_camera_intrinsics.h"
+#include "unreal_airsim/online_simulator/simulator.h"
+
+namespace unreal_airsim::simulator_processor {
+
+ProcessorFactory::Registration<GroundTruthMapBuilder>
+    GroundTruthMapBuilder::registration_("GroundTruthMapBuilder");
+
+bool GroundTruthMapBuilder::setupFromRos(const ros::NodeHandle& nh,
+                                         const std::string& ns) {
+  nh_ = nh;
+  if (!parent_->getConfig().publish_sensor_transforms) {
+    LOG(ERROR) << "GroundTruthMapBuilder requires 'publish_sensor_transforms' "
+                  "to be true.";
+    return false;
+  }
+
+  // Get params.
+  TsdfLayer::Config config;
+  std::string depth_camera_name;
+  if (!nh.getParam(ns + "depth_camera_name", depth_camera_name)) {
+    LOG(ERROR) << "GroundTruthMapBuilder requires the 'depth_camera_name' "
+                  "param to be set!";
+    return false;
+  }
+  nh.param(ns + "voxel_size", config.voxel_size, config.voxel_size);
+  nh.param(ns + "voxels_per_side", config.voxels_per_side,
+           config.voxels_per_side);
+  nh.param(ns + "truncation_distance", config.truncation_distance,
+           config.truncation_distance);
+  nh.param(ns + "max_weight", config.max_weight, config.max_weight);
+  nh.param(ns + "max_depth", config.max_depth, config.max_depth);
+  nh.param(ns + "allocation_stride", config.allocation_stride,
+           config.allocation_stride);
+  nh.param(ns + "output_path", output_path_,
+           std::string("ground_truth_map.ply"));
+  nh.param(ns + "save_max_distance", save_max_distance_, config.voxel_size);
+  if (!config.isValid()) {
+    LOG(ERROR) << "GroundTruthMapBuilder '" << name_
+               << "' has an invalid TSDF configuration.";
+    return false;
+  }
+
+  // Find source camera.
+  std::string depth_topic;
+  for (const auto& sensor : parent_->getConfig().sensors) {
+    if (sensor->name == depth_camera_name &&
+        sensor->sensor_type == AirsimSimulator::Config::Sensor::TYPE_CAMERA) {
+      auto camera = (AirsimSimulator::Config::Camera*)sensor.get();
+      if (camera->image_type !=
+              msr::airlib::ImageCaptureBase::ImageType::DepthPlanar ||
+          !camera->pixels_as_float) {
+        LOG(ERROR) << "GroundTruthMapBuilder requires camera '"
+                   << depth_camera_name
+                   << "' to be a 'DepthPlanar' camera with "
+                      "'pixels_as_float: true'.";
+        return false;
+      }
+      depth_topic = sensor->output_topic;
+      sensor_frame_name_ = sensor->frame_name + "_ground_truth";
+      fov_ = camera->camera_info.fov;
+    }
+  }
+  if (depth_topic.empty()) {
+    LOG(ERROR) << "Could not find a Camera with name '" << depth_camera_name
+               << "'!";
+    return false;
+  }
+
+  // Setup.
+  tsdf_layer_ =
+      std::make_unique<TsdfLayer>(config, parent_->getProcessingPool());
+  tf_buffer_ = std::make_unique<tf2_ros::Buffer>();
+  tf_listener_ = std::make_unique<tf2_ros::TransformListener>(*tf_buffer_);
+  subscribeImage(nh_, depth_topic, 10,
+                 [this](const sensor_msgs::ImagePtr& msg) {
+                   depthImageCallback(msg);
+                 });
+  save_map_srv_ = nh_.advertiseService(
+      name_ + "/save_map", &GroundTruthMapBuilder::saveMapCallback, this);
+  return true;
+}
+
+void GroundTruthMapBuilder::depthImageCallback(
+    const sensor_msgs::ImagePtr& msg) {
+  if (msg->encoding != sensor_msgs::image_encodings::TYPE_32FC1) {
+    LOG_FIRST_N(WARNING, 1) << "GroundTruthMapBuilder '" << name_
+                            << "' expects 32FC1 depth images, received '"
+                            << msg->encoding << "'.";
+    return;
+  }
+
+  // The sensor transforms are broadcast with the images, frames are kept
+  // until their ground truth pose arrived instead of blocking for it.
+  std::lock_guard<std::mutex> guard(map_guard_);
+  pending_frames_.push_back(msg);
+  if (pending_frames_.size() > kMaxPendingFrames) {
+    LOG_EVERY_N(WARNING, 10)
+        << "GroundTruthMapBuilder '" << name_
+        << "' could not find the sensor pose at "
+        << pending_frames_.front()->header.stamp << ", dropped the frame.";
+    pending_frames_.pop_front();
+  }
+  while (!pending_frames_.empty()) {
+    const sensor_msgs::ImagePtr& frame_msg = pending_frames_.front();
+    if (tf_buffer_->canTransform(parent_->getConfig().simulator_frame_name,
+                                 sensor_frame_name_,
+                                 frame_msg->header.stamp)) {
+      integrateFrame(*frame_msg);
+    } else if ((msg->header.stamp - frame_msg->header.stamp).toSec() >
+               kMaxPendingTime) {
+      // The pose of this frame will not arrive anymore, don't let it hold
+      // back the newer frames.
+      LOG_EVERY_N(WARNING, 10)
+          << "GroundTruthMapBuilder '" << name_
+          << "' could not find the sensor pose at " << frame_msg->header.stamp
+          << " within " << kMaxPendingTime << "s, dropped the frame.";
+    } else {
+      return;
+    }
+    pending_frames_.pop_front();
+  }
+}
+
+void GroundTruthMapBuilder::integrateFrame(const sensor_msgs::Image& msg) {
+  geometry_msgs::TransformStamped T_W_C_msg;
+  try {
+    T_W_C_msg = tf_buffer_->lookupTransform(
+        parent_->getConfig().simulator_frame_name, sensor_frame_name_,
+        msg.header.stamp);
+  } catch (tf2::TransformException& e) {
+    LOG(WARNING) << "GroundTruthMapBuilder '" << name_
+                 << "' could not find the sensor pose: " << e.what();
+    return;
+  }
+  Eigen::Affine3d T_W_C_d;
+  tf::transformMsgToEigen(T_W_C_msg.transform, T_W_C_d);
+  const Eigen::Isometry3f T_W_C(T_W_C_d.matrix().cast<float>());
+
+  TsdfLayer::DepthFrame frame;
+  frame.data = reinterpret_cast<const float*>(msg.data.data());
+  frame.width = msg.width;
+  frame.height = msg.height;
+  frame.row_stride = msg.step / sizeof(float);
+  const DepthCameraIntrinsics intrinsics(msg.width, msg.height, fov_);
+  frame.vx = intrinsics.vx;
+  frame.vy = intrinsics.vy;
+  frame.focal_length = intrinsics.focal_length;
+
+  // Integrate and keep track of the performance.
+  auto start = std::chrono::steady_clock::now();
+  tsdf_layer_->integrateDepthFrame(frame, T_W_C);
+  double duration = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+  num_integrated_frames_++;
+  total_integration_time_ += duration;
+  max_integration_time_ = std::max(max_integration_time_, duration);
+  VLOG(1) << "GroundTruthMapBuilder '" << name_ << "' integrated frame "
+          << num_integrated_frames_ << " in " << duration * 1000.0 << " ms.";
+  LOG_EVERY_N(INFO, 100)
+      << "GroundTruthMapBuilder '" << name_ << "': integrated "
+      << num_integrated_frames_ << " frames, mean integration time "
+      << total_integration_time_ / num_integrated_frames_ * 1000.0
+      << " ms, max " << max_integration_time_ * 1000.0 << " ms, "
+      << tsdf_layer_->getNumberOfBlocks() << " blocks ("
+      << tsdf_layer_->getMemorySize() / 1048576 << " MB).";
+}
+
+bool GroundTruthMapBuilder::saveMapCallback(
+    std_srvs::Trigger::Request& request,
+    std_srvs::Trigger::Response& response) {
+  std::lock_guard<std::mutex> guard(map_guard_);
+  int64_t num_voxels =
+      tsdf_layer_->saveVoxelsToPly(output_path_, save_max_distance_);
+  response.success = num_voxels >= 0;
+  if (response.success) {
+    response.message = "Saved " + std::to_string(num_voxels) +
+                       " voxels to '" + output_path_ + "'.";
+    LOG(INFO) << "GroundTruthMapBuilder '" << name_ << "': "
+              << response.message;
+  } else {
+    response.message = "Could not save the map to '" + output_path_ + "'.";
+  }
+  return true;
+}
+
+}  // namespace unreal_airsim::simulator_processor
@@ -0,0 +1,261 @@
+#include "unreal_airsim/simulator_processing/ground_truth_map/tsdf_layer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "unreal_airsim/simulator_processing/work_stealing_pool.h"
+
+namespace unreal_airsim {
+
+bool TsdfLayer::Config::isValid() const {
+  bool is_valid = true;
+  if (voxel_size <= 0.f) {
+    LOG(WARNING) << "The voxel_size should be a positive float.";
+    is_valid = false;
+  }
+  if (voxels_per_side <= 0) {
+    LOG(WARNING) << "The voxels_per_side should be a positive int.";
+    is_valid = false;
+  }
+  if (truncation_distance <= 0.f) {
+    LOG(WARNING) << "The truncation_distance should be a positive float.";
+    is_valid = false;
+  }
+  if (truncation_distance >= voxel_size * voxels_per_side) {
+    LOG(WARNING) << "The truncation_distance should be less than a block side "
+                    "(voxel_size * voxels_per_side).";
+    is_valid = false;
+  }
+  if (allocation_stride <= 0) {
+    LOG(WARNING) << "The allocation_stride should be a positive int.";
+    is_valid = false;
+  }
+  return is_valid;
+}
+
+TsdfLayer::TsdfLayer(const Config& config,
+                     simulator_processor::WorkStealingPool* pool)
+    : config_(config),
+      pool_(pool),
+      block_size_(config.voxel_size * config.voxels_per_side),
+      voxels_per_block_(config.voxels_per_side * config.voxels_per_side *
+                        config.voxels_per_side) {
+  CHECK(config_.isValid());
+}
+
+Eigen::Vector3i TsdfLayer::getBlockIndex(const Eigen::Vector3f& point) const {
+  return (point / block_size_).array().floor().cast<int>();
+}
+
+void TsdfLayer::integrateDepthFrame(const DepthFrame& frame,
+                                    const Eigen::Isometry3f& T_W_C) {
+  // Find all blocks that intersect the truncation band of a measured surface
+  // by sampling the band in steps of at most half a block side.
+  std::unordered_set<Eigen::Vector3i, BlockIndexHash> touched_blocks;
+  const float truncation = config_.truncation_distance;
+  const int num_band_steps =
+      static_cast<int>(std::ceil(4.f * truncation / block_size_));
+  for (int v = 0; v < frame.height; v += config_.allocation_stride) {
+    const float* row = frame.data + v * frame.row_stride;
+    for (int u = 0; u < frame.width; u += config_.allocation_stride) {
+      const float z = row[u];
+      if (!(z > 0.f) || z > config_.max_depth) {
+        continue;
+      }
+      const Eigen::Vector3f ray((u - frame.vx) / frame.focal_length,
+                                (v - frame.vy) / frame.focal_length, 1.f);
+      const Eigen::Vector3f band_start_W =
+          T_W_C * (ray * z - ray.normalized() * truncation);
+      const Eigen::Vector3f band_step_W = T_W_C.linear() * ray.normalized() *
+                                          (2.f * truncation / num_band_steps);
+      for (int i = 0; i <= num_band_steps; ++i) {
+        touched_blocks.insert(getBlockIndex(band_start_W + i * band_step_W));
+      }
+    }
+  }
+
+  // Allocate missing blocks.
+  std::vector<Block*> blocks;
+  blocks.reserve(touched_blocks.size());
+  for (const Eigen::Vector3i& index : touched_blocks) {
+    std::unique_ptr<Block>& block = blocks_[index];
+    if (!block) {
+      block = std::make_unique<Block>();
+      block->index = index;
+      block->voxels.resize(voxels_per_block_);
+    }
+    blocks.push_back(block.get());
+  }
+
+  // Integrate all blocks in parallel, every block is owned by exactly one
+  // task so no locking is required. Tasks that start after all blocks were
+  // claimed return without touching the frame, so only the integration of
+  // the blocks is waited for.
+  if (blocks.empty()) {
+    return;
+  }
+  const Eigen::Isometry3f T_C_W = T_W_C.inverse();
+  struct Progress {
+    size_t num_blocks = 0;
+    std::atomic<size_t> next_block{0};
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t num_done = 0;  // guarded by mutex
+  };
+  auto progress = std::make_shared<Progress>();
+  progress->num_blocks = blocks.size();
+  auto worker = [this, progress, &frame, &T_C_W, &blocks]() {
+    size_t i;
+    while ((i = progress->next_block.fetch_add(1)) < progress->num_blocks) {
+      integrateBlock(frame, T_C_W, blocks[i]);
+      std::lock_guard<std::mutex> lock(progress->mutex);
+      if (++progress->num_done == progress->num_blocks) {
+        progress->cv.notify_all();
+      }
+    }
+  };
+  if (pool_) {
+    const size_t num_tasks =
+        std::min<size_t>(pool_->getNumThreads(), blocks.size());
+    for (size_t i = 1; i < num_tasks; ++i) {
+      pool_->submit(worker);
+    }
+  }
+  worker();
+  std::unique_lock<std::mutex> lock(progress->mutex);
+  progress->cv.wait(
+      lock, [&]() { return progress->num_done == progress->num_blocks; });
+}
+
+void TsdfLayer::integrateBlock(const DepthFrame& frame,
+                               const Eigen::Isometry3f& T_C_W,
+                               Block* block) const {
+  const int n = config_.voxels_per_side;
+  const float truncation = config_.truncation_distance;
+  const Eigen::Vector3f block_origin_W =
+      block->index.cast<float>() * block_size_;
+  const Eigen::Vector3f half_voxel =
+      Eigen::Vector3f::Constant(0.5f * config_.voxel_size);
+
+  // Walking along x only changes the camera frame position by a constant.
+  const Eigen::Vector3f step_C = T_C_W.linear().col(0) * config_.voxel_size;
+  size_t linear_index = 0;
+  for (int z = 0; z < n; ++z) {
+    for (int y = 0; y < n; ++y) {
+      Eigen::Vector3f point_C =
+          T_C_W * (block_origin_W + half_voxel +
+                   Eigen::Vector3f(0.f, y, z) * config_.voxel_size);
+      for (int x = 0; x < n; ++x, ++linear_index, point_C += step_C) {
+        if (point_C.z() <= 0.f) {
+          continue;
+        }
+        const int u = static_cast<int>(std::lround(
+            point_C.x() / point_C.z() * frame.focal_length + frame.vx));
+        const int v = static_cast<int>(std::lround(
+            point_C.y() / point_C.z() * frame.focal_length + frame.vy));
+        if (u < 0 || u >= frame.width || v < 0 || v >= frame.height) {
+          continue;
+        }
+        const float depth = frame.data[v * frame.row_stride + u];
+        if (!(depth > 0.f) || depth > config_.max_depth) {
+          continue;
+        }
+        // Projective (planar) signed distance, positive in front of surfaces.
+        const float sdf = depth - point_C.z();
+        if (sdf < -truncation) {
+          continue;
+        }
+        Voxel& voxel = block->voxels[linear_index];
+        const float tsdf = std::min(sdf, truncation);
+        const float new_weight = voxel.weight + 1.f;
+        voxel.distance = (voxel.distance * voxel.weight + tsdf) / new_weight;
+        voxel.weight = std::min(new_weight, config_.max_weight);
+      }
+    }
+  }
+}
+
+int64_t TsdfLayer::saveVoxelsToPly(const std::string& file_name,
+                                   float max_abs_distance) const {
+  struct PlyVertex {
+    float x, y, z, distance, weight;
+  };
+  std::vector<PlyVertex> vertices;
+  const int n = config_.voxels_per_side;
+  for (const auto& entry : blocks_) {
+    const Block& block = *entry.second;
+    const Eigen::Vector3f block_origin =
+        block.index.cast<float>() * block_size_;
+    for (int i = 0; i < voxels_per_block_; ++i) {
+      const Voxel& voxel = block.voxels[i];
+      if (voxel.weight <= 0.f ||
+          std::fabs(voxel.distance) > max_abs_distance) {
+        continue;
+      }
+      const Eigen::Vector3f center =
+          block_origin +
+          (Eigen::Vector3f(i % n, (i / n) % n, i / (n * n)) +
+           Eigen::Vector3f::Constant(0.5f)) *
+              config_.voxel_size;
+      vertices.push_back(
+          {center.x(), center.y(), center.z(), voxel.distance, voxel.weight});
+    }
+  }
+
+  std::ofstream file(file_name, std::ios::out | std::ios::binary);
+  if (!file.is_open()) {
+    LOG(ERROR) << "Could not open file '" << file_name << "' for writing.";
+    return -1;
+  }
+  file << "ply\n"
+       << "format binary_little_endian 1.0\n"
+       << "element vertex " << vertices.size() << "\n"
+       << "property float x\n"
+       << "property float y\n"
+       << "property float z\n"
+       << "property float distance\n"
+       << "property float weight\n"
+       << "end_header\n";
+  file.write(reinterpret_cast<const char*>(vertices.data()),
+             vertices.size() * sizeof(PlyVertex));
+  if (!file.good()) {
+    LOG(ERROR) << "Failed writing to file '" << file_name << "'.";
+    return -1;
+  }
+  return vertices.size();
+}
+
+const TsdfLayer::Voxel* TsdfLayer::getVoxelPtr(
+    const Eigen::Vector3f& point) const {
+  const auto it = blocks_.find(getBlockIndex(point));
+  if (it == blocks_.end()) {
+    return nullptr;
+  }
+  const Block& block = *it->second;
+  const int n = config_.voxels_per_side;
+  const Eigen::Vector3i voxel_index =
+      ((point - block.index.cast<float>() * block_size_) / config_.voxel_size)
+          .array()
+          .floor()
+          .cast<int>()
+          .max(0)
+          .min(n - 1);
+  return &block.voxels[voxel_index.x() +
+                       n * (voxel_index.y() + n * voxel_index.z())];
+}
+
+size_t TsdfLayer::getMemorySize() const {
+  return blocks_.size() * (sizeof(Block) + voxels_per_block_ * sizeof(Voxel));
+}
+
+}  // namespace unreal_airsim
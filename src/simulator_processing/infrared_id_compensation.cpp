@@ -2,14 +2,115 @@
 
 #include <string>
 
-#include <cv_bridge/cv_bridge.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define UNREAL_AIRSIM_HAS_SIMD_LOOKUP
+#endif
+
 #include <image_transport/image_transport.h>
+#include <sensor_msgs/image_encodings.h>
 
 #include "3rd_party/csv.h"
 #include "unreal_airsim/online_simulator/simulator.h"
 
 namespace unreal_airsim::simulator_processor {
 
+namespace {
+void applyLookupTableScalar(const uint8_t* table, const uint8_t* input,
+                            uint8_t* output, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    output[i] = table[input[i]];
+  }
+}
+
+#ifdef UNREAL_AIRSIM_HAS_SIMD_LOOKUP
+/**
+ * The 256 entry table is split into 16 tables of 16 entries that are applied
+ * to the low nibble using pshufb. For table h the input is offset by -16 * h,
+ * such that only bytes belonging to table h lie in [0, 15]. Adding 0x70 with
+ * saturation sets the most significant bit for all other bytes, for which
+ * pshufb then returns 0, so the 16 partial results can simply be or-ed.
+ * Two vectors are processed per iteration to interleave two independent
+ * dependency chains. (A 128 bit SSSE3 variant was measured to be slower than
+ * the scalar lookup and is therefore not used.)
+ */
+__attribute__((target("avx2"))) void applyLookupTableAvx2(
+    const uint8_t* table, const uint8_t* input, uint8_t* output, size_t size) {
+  __m256i tables[16];
+  for (int h = 0; h < 16; ++h) {
+    tables[h] = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(table + 16 * h)));
+  }
+  const __m256i offset = _mm256_set1_epi8(0x70);
+  const __m256i table_size = _mm256_set1_epi8(0x10);
+  size_t i = 0;
+  for (; i + 64 <= size; i += 64) {
+    __m256i in_0 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+    __m256i in_1 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i + 32));
+    __m256i result_0 = _mm256_setzero_si256();
+    __m256i result_1 = _mm256_setzero_si256();
+    for (int h = 0; h < 16; ++h) {
+      result_0 = _mm256_or_si256(
+          result_0,
+          _mm256_shuffle_epi8(tables[h], _mm256_adds_epu8(in_0, offset)));
+      result_1 = _mm256_or_si256(
+          result_1,
+          _mm256_shuffle_epi8(tables[h], _mm256_adds_epu8(in_1, offset)));
+      in_0 = _mm256_sub_epi8(in_0, table_size);
+      in_1 = _mm256_sub_epi8(in_1, table_size);
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), result_0);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i + 32),
+                        result_1);
+  }
+  applyLookupTableScalar(table, input + i, output + i, size - i);
+}
+
+/**
+ * With AVX-512 VBMI a two-source byte permutation looks up 128 entries at
+ * once, using the 7 low bits of the index. Both table halves are looked up
+ * and the result is selected by the most significant bit of the input.
+ */
+__attribute__((target("avx512f,avx512bw,avx512vbmi"))) void
+applyLookupTableAvx512Vbmi(const uint8_t* table, const uint8_t* input,
+                           uint8_t* output, size_t size) {
+  const __m512i table_0 = _mm512_loadu_si512(table);
+  const __m512i table_1 = _mm512_loadu_si512(table + 64);
+  const __m512i table_2 = _mm512_loadu_si512(table + 128);
+  const __m512i table_3 = _mm512_loadu_si512(table + 192);
+  size_t i = 0;
+  for (; i + 64 <= size; i += 64) {
+    const __m512i in = _mm512_loadu_si512(input + i);
+    const __m512i low = _mm512_permutex2var_epi8(table_0, in, table_1);
+    const __m512i high = _mm512_permutex2var_epi8(table_2, in, table_3);
+    _mm512_storeu_si512(
+        output + i, _mm512_mask_blend_epi8(_mm512_movepi8_mask(in), low, high));
+  }
+  applyLookupTableScalar(table, input + i, output + i, size - i);
+}
+#endif  // UNREAL_AIRSIM_HAS_SIMD_LOOKUP
+
+void applyLookupTable(const uint8_t* table, const uint8_t* input,
+                      uint8_t* output, size_t size) {
+#ifdef UNREAL_AIRSIM_HAS_SIMD_LOOKUP
+  static const bool kHasAvx512Vbmi = __builtin_cpu_supports("avx512vbmi") &&
+                                     __builtin_cpu_supports("avx512bw");
+  if (kHasAvx512Vbmi) {
+    applyLookupTableAvx512Vbmi(table, input, output, size);
+    return;
+  }
+  static const bool kHasAvx2 = __builtin_cpu_supports("avx2");
+  if (kHasAvx2) {
+    applyLookupTableAvx2(table, input, output, size);
+    return;
+  }
+#endif  // UNREAL_AIRSIM_HAS_SIMD_LOOKUP
+  applyLookupTableScalar(table, input, output, size);
+}
+}  // namespace
+
 ProcessorFactory::Registration<InfraredIdCompensation>
     InfraredIdCompensation::registration_("InfraredIdCompensation");
 
@@ -47,21 +148,37 @@ bool InfraredIdCompensation::setupFromRos(const ros::NodeHandle& nh,
   std::string input_topic, output_topic;
   nh_.getParam(ns + "input_topic", input_topic);
   nh_.getParam(ns + "output_topic", output_topic);
-  pub_ = nh_.advertise<sensor_msgs::Image>(output_topic, 10);
-  sub_ = nh_.subscribe(input_topic, 10, &InfraredIdCompensation::imageCallback,
-                       this);
+  pub_ = advertiseImage(&nh_, output_topic, 10);
+  subscribeImage(nh_, input_topic, 10,
+                 [this](const sensor_msgs::ImagePtr& msg) {
+                   imageCallback(msg);
+                 });
   return true;
 }
 
 void InfraredIdCompensation::imageCallback(const sensor_msgs::ImagePtr& msg) {
-  cv_bridge::CvImagePtr img = cv_bridge::toCvCopy(msg, msg->encoding);
-  for (int v = 0; v < img->image.rows; v++) {
-    for (int u = 0; u < img->image.cols; u++) {
-      img->image.at<uchar>(v, u) =
-          infrared_compensation_[img->image.at<uchar>(v, u)];
-    }
+  if (!parent_->getFrameDispatcher()->hasSubscribers(pub_)) {
+    return;
+  }
+  if (msg->encoding != sensor_msgs::image_encodings::MONO8) {
+    LOG_FIRST_N(WARNING, 1) << "InfraredIdCompensation '" << name_
+                            << "' expects mono8 infrared images, received '"
+                            << msg->encoding << "'.";
+    return;
   }
-  pub_.publish(img->toImageMsg());
+  // The compensation is written directly into the outgoing message, the table
+  // is applied to every byte, including potential row padding. The recycled
+  // buffers keep their size, so acquiring does not clear them.
+  sensor_msgs::ImagePtr result = image_pool_.acquire(msg->data.size());
+  result->header = msg->header;
+  result->height = msg->height;
+  result->width = msg->width;
+  result->encoding = msg->encoding;
+  result->is_bigendian = msg->is_bigendian;
+  result->step = msg->step;
+  applyLookupTable(infrared_compensation_, msg->data.data(),
+                   result->data.data(), msg->data.size());
+  publishImage(pub_, result);
 }
 
 }  // namespace unreal_airsim::simulator_processor
@@ -0,0 +1,130 @@
+#include "unreal_airsim/simulator_processing/odometry_drift_simulator/bias_noise_model.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace unreal_airsim {
+namespace {
+bool parseType(const std::string& type, BiasNoiseModel::Type* result) {
+  if (type == "piecewise_constant") {
+    *result = BiasNoiseModel::Type::kPiecewiseConstant;
+  } else if (type == "gauss_markov") {
+    *result = BiasNoiseModel::Type::kGaussMarkov;
+  } else if (type == "random_walk") {
+    *result = BiasNoiseModel::Type::kRandomWalk;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+BiasNoiseModel::Type typeFromString(const std::string& type) {
+  BiasNoiseModel::Type result;
+  CHECK(parseType(type, &result))
+      << "Unknown BiasNoiseModel type '" << type << "'.";
+  return result;
+}
+}  // namespace
+
+BiasNoiseModel::Config BiasNoiseModel::Config::fromRosParams(
+    const ros::NodeHandle& nh) {
+  Config config;
+  nh.param<std::string>("type", config.type, config.type);
+  nh.param<double>("mean", config.mean, config.mean);
+  nh.param<double>("stddev", config.stddev, config.stddev);
+  nh.param<double>("correlation_time", config.correlation_time,
+                   config.correlation_time);
+  return config;
+}
+
+bool BiasNoiseModel::Config::isValid(
+    const std::string& error_msg_prefix) const {
+  bool is_valid = true;
+  Type parsed_type;
+  if (!parseType(type, &parsed_type)) {
+    LOG(WARNING) << "The " << error_msg_prefix
+                 << "type should be one of 'piecewise_constant', "
+                    "'gauss_markov', 'random_walk', got '"
+                 << type << "'";
+    is_valid = false;
+  }
+  if (stddev < 0.0) {
+    LOG(WARNING) << "The " << error_msg_prefix
+                 << "stddev should be a non-negative float";
+    is_valid = false;
+  }
+  if (type == "gauss_markov" && correlation_time <= 0.0) {
+    LOG(WARNING) << "The " << error_msg_prefix
+                 << "correlation_time should be a positive float";
+    is_valid = false;
+  }
+  return is_valid;
+}
+
+std::ostream& operator<<(std::ostream& os,
+                         const BiasNoiseModel::Config& config) {
+  os << "type: " << config.type << ", mean: " << config.mean
+     << ", stddev: " << config.stddev;
+  if (config.type == "gauss_markov") {
+    os << ", correlation_time: " << config.correlation_time;
+  }
+  return os;
+}
+
+BiasNoiseModel::BiasNoiseModel(const Config& config)
+    : config_(config), type_(typeFromString(config.type)), bias_(0.0) {
+  CHECK(config_.isValid()) << "Invalid BiasNoiseModel config: " << config_;
+}
+
+void BiasNoiseModel::reset(RandomEngine* engine) {
+  bias_ = type_ == Type::kGaussMarkov
+              ? engine->standardNormal() * config_.stddev
+              : 0.0;
+}
+
+double BiasNoiseModel::integrate(double delta_t, double standard_normal_1,
+                                 double standard_normal_2) {
+  if (type_ == Type::kPiecewiseConstant || delta_t <= 0.0) {
+    return 0.0;
+  }
+
+  // Conditional on the current bias b, the next bias b' and the integral I
+  // over the step are jointly Gaussian with
+  //   E[I] = c * b,  E[b'] = phi * b,
+  //   Var(I), Var(b'), Cov(I, b') as below.
+  const double sigma2 = config_.stddev * config_.stddev;
+  double phi, c, var_integral, var_bias, covariance;
+  if (type_ == Type::kGaussMarkov) {
+    // phi = exp(-x), with e = phi - 1 via expm1 to avoid cancellation.
+    const double tau = config_.correlation_time;
+    const double x = delta_t / tau;
+    const double e = std::expm1(-x);
+    phi = 1.0 + e;
+    c = -tau * e;
+    // 2x - 3 + 4 phi - phi^2 = 2(x + e) - e^2, which still cancels for
+    // small x where the series (2/3)x^3 - x^4/2 + (7/30)x^5 is used.
+    const double g =
+        x < 1e-3 ? x * x * x * (2.0 / 3.0 - x * (0.5 - x * 7.0 / 30.0))
+                 : 2.0 * (x + e) - e * e;
+    var_integral = sigma2 * tau * tau * g;
+    var_bias = -sigma2 * std::expm1(-2.0 * x);
+    covariance = sigma2 * tau * e * e;
+  } else {
+    phi = 1.0;
+    c = delta_t;
+    var_integral = sigma2 * delta_t * delta_t * delta_t / 3.0;
+    var_bias = sigma2 * delta_t;
+    covariance = sigma2 * delta_t * delta_t / 2.0;
+  }
+
+  // Sample via the Cholesky factor of the 2x2 covariance.
+  const double l11 = std::sqrt(std::max(var_integral, 0.0));
+  const double l21 = l11 > 0.0 ? covariance / l11 : 0.0;
+  const double l22 = std::sqrt(std::max(var_bias - l21 * l21, 0.0));
+  const double integral =
+      c * bias_ + l11 * standard_normal_1 + config_.mean * delta_t;
+  bias_ = phi * bias_ + l21 * standard_normal_1 + l22 * standard_normal_2;
+  return integral;
+}
+}  // namespace unreal_airsim
@@ -1,66 +1,115 @@
 #include "unreal_airsim/simulator_processing/odometry_drift_simulator/odometry_drift_simulator.h"
 
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+
 #include <eigen_conversions/eigen_msg.h>
 #include <minkindr_conversions/kindr_msg.h>
 
 namespace unreal_airsim {
+namespace {
+uint64_t resolveSeed(int seed) {
+  if (seed >= 0) {
+    return static_cast<uint64_t>(seed);
+  }
+  std::random_device random_device;
+  return (static_cast<uint64_t>(random_device()) << 32) | random_device();
+}
+}  // namespace
+
 OdometryDriftSimulator::OdometryDriftSimulator(Config config)
     : config_(config.checkValid()),
+      seed_(resolveSeed(config.seed)),
       started_publishing_(false),
       velocity_noise_sampling_period_(1.f / config.velocity_noise_frequency_hz),
+      drift_history_(config.history_size),
+      drift_history_start_(0),
+      drift_history_count_(0),
       velocity_noise_(config.velocity_noise),
       pose_noise_(config.pose_noise) {
   reset();
-  VLOG(1) << "Initialized drifting odometry simulator, with config:\n"
+  LOG(INFO) << "Odometry drift simulator uses the random seed " << seed_
+            << (config_.seed < 0 ? " (drawn from std::random_device)" : "")
+            << ", stream " << config_.stream << ".";
+  VLOG(1) << "Initialized drifting odometry simulator with config:\n"
           << config_;
 }
 
 void OdometryDriftSimulator::reset() {
+  std::unique_lock<std::shared_mutex> lock(state_mutex_);
+  random_engine_ = RandomEngine(seed_, config_.stream);
+  velocity_noise_.reset(&random_engine_);
   last_velocity_noise_sampling_time_ = ros::Time();
   current_linear_velocity_noise_sample_W_.setZero();
   current_angular_velocity_noise_sample_W_.setZero();
   integrated_pose_drift_.setIdentity();
   current_pose_noise_.setIdentity();
   current_simulated_pose_.setIdentity();
-  last_ground_truth_pose_msg_ = geometry_msgs::TransformStamped();
+  current_ground_truth_pose_.setIdentity();
+  current_stamp_ = ros::Time();
+  drift_history_start_ = 0;
+  drift_history_count_ = 0;
+}
+
+void OdometryDriftSimulator::setFrameNames(const std::string& frame_id,
+                                           const std::string& child_frame_id) {
+  std::unique_lock<std::shared_mutex> lock(state_mutex_);
+  frame_id_ = frame_id;
+  child_frame_id_ = child_frame_id;
 }
 
 void OdometryDriftSimulator::tick(
     const geometry_msgs::TransformStamped& ground_truth_pose_msg) {
-  // Compute the time delta
-  const ros::Time& current_timestamp = ground_truth_pose_msg.header.stamp;
+  if (ground_truth_pose_msg.header.frame_id != frame_id_ ||
+      ground_truth_pose_msg.child_frame_id != child_frame_id_) {
+    setFrameNames(ground_truth_pose_msg.header.frame_id,
+                  ground_truth_pose_msg.child_frame_id);
+  }
+  Transformation ground_truth_pose;
+  tf::transformMsgToKindr(ground_truth_pose_msg.transform, &ground_truth_pose);
+  tick(ground_truth_pose, ground_truth_pose_msg.header.stamp);
+}
+
+void OdometryDriftSimulator::tick(const Transformation& ground_truth_pose,
+                                  const ros::Time& stamp) {
+  // Compute the time delta. The ground truth pose and stamp are only updated
+  // together with the drift state, s.t. readers never see a ground truth pose
+  // with the drift of a different tick.
+  const ros::Time& current_timestamp = stamp;
   double delta_t = 0.0;
-  if (!last_ground_truth_pose_msg_.header.stamp.isZero()) {
-    delta_t =
-        (current_timestamp - last_ground_truth_pose_msg_.header.stamp).toSec();
+  {
+    std::shared_lock<std::shared_mutex> lock(state_mutex_);
+    if (!current_stamp_.isZero()) {
+      delta_t = (current_timestamp - current_stamp_).toSec();
+    }
   }
-  last_ground_truth_pose_msg_ = ground_truth_pose_msg;
   if (delta_t < 0.0) {
     LOG(WARNING) << "Time difference between current and last received pose "
                     "msg is negative. Skipping.";
+    std::unique_lock<std::shared_mutex> lock(state_mutex_);
+    current_ground_truth_pose_ = ground_truth_pose;
+    current_stamp_ = current_timestamp;
     return;
   }
 
-  // Get the ground truth pose
-  Transformation ground_truth_pose;
-  tf::transformMsgToKindr(ground_truth_pose_msg.transform, &ground_truth_pose);
-
-  // Draw a random velocity noise sample, used to simulate drift
+  // Draw a random velocity noise sample of the piecewise constant axes, used
+  // to simulate drift
   if (last_velocity_noise_sampling_time_ + velocity_noise_sampling_period_ <
       current_timestamp) {
     last_velocity_noise_sampling_time_ = current_timestamp;
 
     // Sample the linear velocity noise in body frame
-    const Transformation::Vector3 current_linear_velocity_noise_sample_B_ = {
-        velocity_noise_.x(), velocity_noise_.y(), velocity_noise_.z()};
+    const Eigen::Vector4d velocity_noise_sample =
+        velocity_noise_.samplePiecewiseConstant(&random_engine_);
     current_linear_velocity_noise_sample_W_ =
         ground_truth_pose.getRotation().rotate(
-            current_linear_velocity_noise_sample_B_);
+            Transformation::Vector3(velocity_noise_sample.head<3>()));
 
     // Sample the angular velocity noise directly in world frame,
     // since we only want to simulate drift on world frame yaw
     current_angular_velocity_noise_sample_W_ = {0.0, 0.0,
-                                                velocity_noise_.yaw()};
+                                                velocity_noise_sample[3]};
   }
 
   // Integrate the drift
@@ -68,40 +117,141 @@ void OdometryDriftSimulator::tick(
   drift_delta_W_vec << current_linear_velocity_noise_sample_W_,
       current_angular_velocity_noise_sample_W_;
   drift_delta_W_vec *= delta_t;
+  if (velocity_noise_.has_bias_axes) {
+    // The bias models are discretized exactly and directly yield their
+    // integral over delta_t, again linear in body and yaw in world frame
+    const Eigen::Vector4d bias_integral =
+        velocity_noise_.integrateBias(delta_t, &random_engine_);
+    drift_delta_W_vec.head<3>() += ground_truth_pose.getRotation().rotate(
+        Transformation::Vector3(bias_integral.head<3>()));
+    drift_delta_W_vec[5] += bias_integral[3];
+  }
   const Transformation drift_delta_W = Transformation::exp(drift_delta_W_vec);
-  integrated_pose_drift_ = drift_delta_W * integrated_pose_drift_;
+  const Transformation integrated_pose_drift =
+      drift_delta_W * integrated_pose_drift_;
 
   // Draw a random pose noise sample
-  Transformation::Vector6 pose_noise_B_vec;
-  pose_noise_B_vec << pose_noise_.x(), pose_noise_.y(), pose_noise_.z(),
-      pose_noise_.roll(), pose_noise_.pitch(), pose_noise_.yaw();
-  current_pose_noise_ = Transformation::exp(pose_noise_B_vec);
-
-  // Update the current simulated pose
+  const Transformation::Vector6 pose_noise_B_vec =
+      pose_noise_.sample(&random_engine_);
+  const Transformation pose_noise = Transformation::exp(pose_noise_B_vec);
+
+  // Update the current poses and the history
+  std::unique_lock<std::shared_mutex> lock(state_mutex_);
+  current_ground_truth_pose_ = ground_truth_pose;
+  current_stamp_ = current_timestamp;
+  integrated_pose_drift_ = integrated_pose_drift;
+  current_pose_noise_ = pose_noise;
   current_simulated_pose_ =
       integrated_pose_drift_ * ground_truth_pose * current_pose_noise_;
+  DriftState* state;
+  DriftState* newest =
+      drift_history_count_ == 0
+          ? nullptr
+          : &drift_history_[(drift_history_start_ + drift_history_count_ - 1) %
+                            drift_history_.size()];
+  if (newest && newest->stamp >= current_timestamp) {
+    if (newest->stamp > current_timestamp) {
+      // Keep the history ordered, this only happens after skipped ticks.
+      return;
+    }
+    state = newest;  // Same stamp as the last tick, overwrite it.
+  } else if (drift_history_count_ < drift_history_.size()) {
+    state = &drift_history_[(drift_history_start_ + drift_history_count_) %
+                            drift_history_.size()];
+    drift_history_count_++;
+  } else {
+    state = &drift_history_[drift_history_start_];
+    drift_history_start_ = (drift_history_start_ + 1) % drift_history_.size();
+  }
+  state->stamp = current_timestamp;
+  state->drift = integrated_pose_drift_;
+  state->noise = current_pose_noise_;
 }
 
-OdometryDriftSimulator::Transformation
-OdometryDriftSimulator::getGroundTruthPose() const {
-  Transformation ground_truth_pose;
-  tf::transformMsgToKindr(last_ground_truth_pose_msg_.transform,
-                          &ground_truth_pose);
-  return ground_truth_pose;
+void OdometryDriftSimulator::getDriftStateAt(const ros::Time& stamp,
+                                             Transformation* drift,
+                                             Transformation* noise) const {
+  // NOTE: Requires state_mutex_ to be locked by the caller.
+  if (stamp.isZero() || drift_history_count_ == 0) {
+    *drift = integrated_pose_drift_;
+    *noise = current_pose_noise_;
+    return;
+  }
+  auto at = [this](size_t i) -> const DriftState& {
+    return drift_history_[(drift_history_start_ + i) % drift_history_.size()];
+  };
+  const DriftState& newest = at(drift_history_count_ - 1);
+  if (stamp >= newest.stamp) {
+    // The drift can not be extrapolated, the newest state is the best guess.
+    *drift = newest.drift;
+    *noise = newest.noise;
+    return;
+  }
+  const DriftState& oldest = at(0);
+  if (stamp <= oldest.stamp) {
+    LOG_IF_EVERY_N(WARNING, stamp < oldest.stamp, 100)
+        << "Requested drift at " << stamp << " which is older than the "
+        << "history (" << oldest.stamp << "), consider increasing the "
+        << "history_size.";
+    *drift = oldest.drift;
+    *noise = oldest.noise;
+    return;
+  }
+
+  // Binary search the first state after the stamp. The stamps are strictly
+  // increasing and oldest < stamp < newest, so 0 < low < count.
+  size_t low = 1;
+  size_t high = drift_history_count_ - 1;
+  while (low < high) {
+    const size_t mid = (low + high) / 2;
+    if (at(mid).stamp > stamp) {
+      high = mid;
+    } else {
+      low = mid + 1;
+    }
+  }
+  const DriftState& before = at(low - 1);
+  const DriftState& after = at(low);
+  const double t =
+      (stamp - before.stamp).toSec() / (after.stamp - before.stamp).toSec();
+
+  // Interpolate the drift on SO(3) x R^3, which is accurate for the small
+  // changes between ticks. The pose noise is white, i.e. only defined at the
+  // ticks, so the closest sample is used.
+  *drift = Transformation(
+      Transformation::Rotation(before.drift.getEigenQuaternion().slerp(
+          t, after.drift.getEigenQuaternion())),
+      (1.0 - t) * before.drift.getPosition() + t * after.drift.getPosition());
+  *noise = t < 0.5 ? before.noise : after.noise;
+}
+
+geometry_msgs::TransformStamped OdometryDriftSimulator::toTransformMsg(
+    const Transformation& pose) const {
+  // NOTE: Requires state_mutex_ to be locked by the caller.
+  geometry_msgs::TransformStamped msg;
+  msg.header.stamp = current_stamp_;
+  msg.header.frame_id = frame_id_;
+  msg.child_frame_id = child_frame_id_;
+  tf::transformKindrToMsg(pose, &msg.transform);
+  return msg;
 }
 
 geometry_msgs::TransformStamped OdometryDriftSimulator::getSimulatedPoseMsg()
     const {
-  geometry_msgs::TransformStamped simulated_pose_msg =
-      last_ground_truth_pose_msg_;
-  tf::transformKindrToMsg(current_simulated_pose_,
-                          &simulated_pose_msg.transform);
-  return simulated_pose_msg;
+  std::shared_lock<std::shared_mutex> lock(state_mutex_);
+  return toTransformMsg(current_simulated_pose_);
+}
+
+geometry_msgs::TransformStamped OdometryDriftSimulator::getGroundTruthPoseMsg()
+    const {
+  std::shared_lock<std::shared_mutex> lock(state_mutex_);
+  return toTransformMsg(current_ground_truth_pose_);
 }
 
 OdometryDriftSimulator::Transformation
 OdometryDriftSimulator::convertDriftedToGroundTruthPose(
     const OdometryDriftSimulator::Transformation& simulated_pose) const {
+  std::shared_lock<std::shared_mutex> lock(state_mutex_);
   return integrated_pose_drift_.inverse() * simulated_pose *
          current_pose_noise_.inverse();
 }
@@ -109,17 +259,57 @@ OdometryDriftSimulator::convertDriftedToGroundTruthPose(
 OdometryDriftSimulator::Transformation
 OdometryDriftSimulator::convertGroundTruthToDriftedPose(
     const OdometryDriftSimulator::Transformation& ground_truth_pose) const {
+  std::shared_lock<std::shared_mutex> lock(state_mutex_);
   return integrated_pose_drift_ * ground_truth_pose * current_pose_noise_;
 }
 
+OdometryDriftSimulator::Transformation
+OdometryDriftSimulator::convertDriftedToGroundTruthPose(
+    const OdometryDriftSimulator::Transformation& simulated_pose,
+    const ros::Time& stamp) const {
+  Transformation drift, noise;
+  {
+    std::shared_lock<std::shared_mutex> lock(state_mutex_);
+    getDriftStateAt(stamp, &drift, &noise);
+  }
+  return drift.inverse() * simulated_pose * noise.inverse();
+}
+
+OdometryDriftSimulator::Transformation
+OdometryDriftSimulator::convertGroundTruthToDriftedPose(
+    const OdometryDriftSimulator::Transformation& ground_truth_pose,
+    const ros::Time& stamp) const {
+  Transformation drift, noise;
+  {
+    std::shared_lock<std::shared_mutex> lock(state_mutex_);
+    getDriftStateAt(stamp, &drift, &noise);
+  }
+  return drift * ground_truth_pose * noise;
+}
+
+void OdometryDriftSimulator::convertGroundTruthToDriftedPoses(
+    const TransformationVector& ground_truth_poses, const ros::Time& stamp,
+    TransformationVector* simulated_poses) const {
+  CHECK_NOTNULL(simulated_poses);
+  Transformation drift, noise;
+  {
+    std::shared_lock<std::shared_mutex> lock(state_mutex_);
+    getDriftStateAt(stamp, &drift, &noise);
+  }
+  simulated_poses->resize(ground_truth_poses.size());
+  for (size_t i = 0; i < ground_truth_poses.size(); ++i) {
+    (*simulated_poses)[i] = drift * ground_truth_poses[i] * noise;
+  }
+}
+
 geometry_msgs::TransformStamped
 OdometryDriftSimulator::convertDriftedToGroundTruthPoseMsg(
     const geometry_msgs::TransformStamped& simulated_pose_msg) const {
   Transformation simulated_pose;
   tf::transformMsgToKindr(simulated_pose_msg.transform, &simulated_pose);
 
-  const Transformation ground_truth_pose =
-      convertDriftedToGroundTruthPose(simulated_pose);
+  const Transformation ground_truth_pose = convertDriftedToGroundTruthPose(
+      simulated_pose, simulated_pose_msg.header.stamp);
 
   geometry_msgs::TransformStamped ground_truth_pose_msg = simulated_pose_msg;
   tf::transformKindrToMsg(ground_truth_pose, &ground_truth_pose_msg.transform);
@@ -132,21 +322,58 @@ OdometryDriftSimulator::convertGroundTruthToDriftedPoseMsg(
   Transformation ground_truth_pose;
   tf::transformMsgToKindr(ground_truth_pose_msg.transform, &ground_truth_pose);
 
-  const Transformation simulated_pose =
-      convertGroundTruthToDriftedPose(ground_truth_pose);
+  const Transformation simulated_pose = convertGroundTruthToDriftedPose(
+      ground_truth_pose, ground_truth_pose_msg.header.stamp);
 
   geometry_msgs::TransformStamped simulated_pose_msg = ground_truth_pose_msg;
   tf::transformKindrToMsg(simulated_pose, &simulated_pose_msg.transform);
   return simulated_pose_msg;
 }
 
-OdometryDriftSimulator::VelocityNoiseDistributions::VelocityNoiseDistributions(
-    const OdometryDriftSimulator::Config::NoiseConfigMap&
+OdometryDriftSimulator::VelocityNoiseModels::VelocityNoiseModels(
+    const OdometryDriftSimulator::Config::BiasNoiseConfigMap&
         velocity_noise_configs)
     : x(velocity_noise_configs.at("x")),
       y(velocity_noise_configs.at("y")),
       z(velocity_noise_configs.at("z")),
-      yaw(velocity_noise_configs.at("yaw")) {}
+      yaw(velocity_noise_configs.at("yaw")) {
+  has_bias_axes = !x.isPiecewiseConstant() || !y.isPiecewiseConstant() ||
+                  !z.isPiecewiseConstant() || !yaw.isPiecewiseConstant();
+}
+
+void OdometryDriftSimulator::VelocityNoiseModels::reset(RandomEngine* engine) {
+  x.reset(engine);
+  y.reset(engine);
+  z.reset(engine);
+  yaw.reset(engine);
+}
+
+Eigen::Vector4d
+OdometryDriftSimulator::VelocityNoiseModels::samplePiecewiseConstant(
+    RandomEngine* engine) const {
+  double samples[4];
+  engine->fillStandardNormal(samples, 4);
+  auto sample = [](const BiasNoiseModel& model, double standard_normal) {
+    return model.isPiecewiseConstant()
+               ? model.samplePiecewiseConstant(standard_normal)
+               : 0.0;
+  };
+  return Eigen::Vector4d(sample(x, samples[0]), sample(y, samples[1]),
+                         sample(z, samples[2]), sample(yaw, samples[3]));
+}
+
+Eigen::Vector4d OdometryDriftSimulator::VelocityNoiseModels::integrateBias(
+    double delta_t, RandomEngine* engine) {
+  if (delta_t <= 0.0) {
+    return Eigen::Vector4d::Zero();
+  }
+  double samples[8];
+  engine->fillStandardNormal(samples, 8);
+  return Eigen::Vector4d(x.integrate(delta_t, samples[0], samples[1]),
+                         y.integrate(delta_t, samples[2], samples[3]),
+                         z.integrate(delta_t, samples[4], samples[5]),
+                         yaw.integrate(delta_t, samples[6], samples[7]));
+}
 
 OdometryDriftSimulator::PoseNoiseDistributions::PoseNoiseDistributions(
     const OdometryDriftSimulator::Config::NoiseConfigMap& pose_noise_configs)
@@ -157,8 +384,20 @@ OdometryDriftSimulator::PoseNoiseDistributions::PoseNoiseDistributions(
       pitch(pose_noise_configs.at("pitch")),
       roll(pose_noise_configs.at("roll")) {}
 
+OdometryDriftSimulator::Transformation::Vector6
+OdometryDriftSimulator::PoseNoiseDistributions::sample(
+    RandomEngine* engine) const {
+  double samples[6];
+  engine->fillStandardNormal(samples, 6);
+  Transformation::Vector6 result;
+  result << x.fromStandardNormal(samples[0]), y.fromStandardNormal(samples[1]),
+      z.fromStandardNormal(samples[2]), roll.fromStandardNormal(samples[3]),
+      pitch.fromStandardNormal(samples[4]), yaw.fromStandardNormal(samples[5]);
+  return result;
+}
+
 void OdometryDriftSimulator::publishSimulatedPoseTf() const {
-  transform_broadcaster_.sendTransform(getSimulatedPoseMsg());
+  transform_broadcaster_->sendTransform(getSimulatedPoseMsg());
 }
 
 void OdometryDriftSimulator::publishGroundTruthPoseTf() const {
@@ -167,13 +406,16 @@ void OdometryDriftSimulator::publishGroundTruthPoseTf() const {
   geometry_msgs::TransformStamped ground_truth_pose_msg =
       getGroundTruthPoseMsg();
   ground_truth_pose_msg.child_frame_id += config_.ground_truth_frame_suffix;
-  transform_broadcaster_.sendTransform(ground_truth_pose_msg);
+  transform_broadcaster_->sendTransform(ground_truth_pose_msg);
 }
 
 void OdometryDriftSimulator::publishTfs() const {
   if (!started_publishing_) {
     return;
   }
+  if (!transform_broadcaster_) {
+    transform_broadcaster_ = std::make_unique<tf2_ros::TransformBroadcaster>();
+  }
 
   // Publish simulated pose TF
   publishSimulatedPoseTf();
@@ -194,11 +436,15 @@ OdometryDriftSimulator::Config OdometryDriftSimulator::Config::fromRosParams(
   nh.param("ground_truth_frame_suffix", config.ground_truth_frame_suffix,
            config.ground_truth_frame_suffix);
 
+  nh.param("seed", config.seed, config.seed);
+
+  nh.param("history_size", config.history_size, config.history_size);
+
   nh.param("velocity_noise_frequency_hz", config.velocity_noise_frequency_hz,
            config.velocity_noise_frequency_hz);
 
   for (auto& kv : config.velocity_noise) {
-    kv.second = NormalDistribution::Config::fromRosParams(
+    kv.second = BiasNoiseModel::Config::fromRosParams(
         ros::NodeHandle(nh, "velocity_noise/" + kv.first));
   }
   for (auto& kv : config.pose_noise) {
@@ -218,6 +464,16 @@ bool OdometryDriftSimulator::Config::isValid() const {
     is_valid = false;
   }
 
+  if (stream < 0) {
+    LOG(WARNING) << "The stream should be a non-negative int";
+    is_valid = false;
+  }
+
+  if (history_size <= 0) {
+    LOG(WARNING) << "The history_size should be a positive int";
+    is_valid = false;
+  }
+
   if (velocity_noise_frequency_hz <= 0.f) {
     LOG(WARNING)
         << "The velocity_noise_frequency_hz should be a positive float";
@@ -244,6 +500,9 @@ std::ostream& operator<<(std::ostream& os,
      << (config.publish_ground_truth_pose ? "true" : "false") << "\n"
      << "-- ground_truth_frame_suffix: " << config.ground_truth_frame_suffix
      << "\n"
+     << "-- seed: " << config.seed << "\n"
+     << "-- stream: " << config.stream << "\n"
+     << "-- history_size: " << config.history_size << "\n"
      << "-- velocity_noise_frequency_hz: " << config.velocity_noise_frequency_hz
      << "\n";
 
@@ -0,0 +1,52 @@
+#include "unreal_airsim/simulator_processing/processor_base.h"
+
+#include <memory>
+#include <string>
+
+#include "unreal_airsim/online_simulator/simulator.h"
+
+namespace unreal_airsim::simulator_processor {
+
+ProcessorBase::~ProcessorBase() { stopExecutor(); }
+
+void ProcessorBase::stopExecutor() {
+  if (executor_) {
+    executor_->stop();
+  }
+}
+
+bool ProcessorBase::setupExecutor(const ros::NodeHandle& nh,
+                                  const std::string& ns) {
+  ProcessorExecutor::Config config =
+      ProcessorExecutor::Config::fromRosParams(nh, ns);
+  if (!config.isValid("processors/" + name_ + "/")) {
+    return false;
+  }
+  executor_ = std::make_unique<ProcessorExecutor>(
+      config, name_, parent_->getProcessingPool());
+  return true;
+}
+
+void ProcessorBase::subscribeImage(
+    const ros::NodeHandle& nh, const std::string& topic, uint32_t queue_size,
+    const FrameDispatcher::ImageCallback& callback) {
+  input_topics_.push_back(nh.resolveName(topic));
+  parent_->getFrameDispatcher()->subscribe(nh, topic, queue_size, callback);
+}
+
+ros::Publisher ProcessorBase::advertiseImage(ros::NodeHandle* nh,
+                                             const std::string& topic,
+                                             uint32_t queue_size) {
+  ros::Publisher publisher =
+      nh->advertise<sensor_msgs::Image>(topic, queue_size);
+  parent_->getFrameDispatcher()->advertise(publisher);
+  output_topics_.push_back(publisher.getTopic());
+  return publisher;
+}
+
+void ProcessorBase::publishImage(const ros::Publisher& publisher,
+                                 const sensor_msgs::ImagePtr& msg) const {
+  parent_->getFrameDispatcher()->dispatch(publisher, msg);
+}
+
+}  // namespace unreal_airsim::simulator_processor
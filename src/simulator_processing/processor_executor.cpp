@@ -0,0 +1,251 @@
+#include "unreal_airsim/simulator_processing/processor_executor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+namespace unreal_airsim::simulator_processor {
+
+ProcessorExecutor::Config ProcessorExecutor::Config::fromRosParams(
+    const ros::NodeHandle& nh, const std::string& ns) {
+  Config config;
+  nh.param(ns + "cpu_affinity", config.cpu_affinity, config.cpu_affinity);
+  if (!config.cpu_affinity.empty()) {
+    config.num_threads = 1;
+  }
+  nh.param(ns + "num_threads", config.num_threads, config.num_threads);
+  return config;
+}
+
+bool ProcessorExecutor::Config::isValid(
+    const std::string& error_msg_prefix) const {
+  bool is_valid = true;
+  if (num_threads < 0) {
+    LOG(WARNING) << "The " << error_msg_prefix
+                 << "num_threads should be a non-negative int.";
+    is_valid = false;
+  }
+  if (num_threads == 0 && !cpu_affinity.empty()) {
+    LOG(WARNING) << "The " << error_msg_prefix
+                 << "cpu_affinity requires dedicated threads (num_threads>0).";
+    is_valid = false;
+  }
+  for (int cpu : cpu_affinity) {
+    if (cpu < 0) {
+      LOG(WARNING) << "The " << error_msg_prefix
+                   << "cpu_affinity should only contain non-negative ints.";
+      is_valid = false;
+    }
+  }
+  return is_valid;
+}
+
+ProcessorExecutor::ProcessorExecutor(const Config& config,
+                                     const std::string& name,
+                                     WorkStealingPool* pool)
+    : config_(config), name_(name), pool_(pool) {
+  CHECK(pool_ || !usesSharedPool())
+      << "ProcessorExecutor '" << name_ << "' requires a processing pool.";
+}
+
+ProcessorExecutor::~ProcessorExecutor() { stop(); }
+
+void ProcessorExecutor::start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (is_running_) {
+    return;
+  }
+  is_running_ = true;
+  if (usesSharedPool()) {
+    if (!callbacks_.empty() && !is_scheduled_) {
+      is_scheduled_ = true;
+      pool_->submit([this]() { runOnPool(); });
+    }
+    return;
+  }
+  for (int i = 0; i < config_.num_threads; ++i) {
+    threads_.emplace_back(&ProcessorExecutor::threadLoop, this);
+  }
+}
+
+void ProcessorExecutor::applyCpuAffinity() {
+  if (config_.cpu_affinity.empty()) {
+    return;
+  }
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : config_.cpu_affinity) {
+    CPU_SET(cpu, &cpu_set);
+  }
+  int error =
+      pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set);
+  LOG_IF(WARNING, error != 0)
+      << "Could not set the cpu_affinity of simulator_processor '" << name_
+      << "' (error " << error << ").";
+#else
+  LOG_FIRST_N(WARNING, 1)
+      << "The cpu_affinity of simulator_processor '" << name_
+      << "' is only supported on linux and will be ignored.";
+#endif
+}
+
+void ProcessorExecutor::stop() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    is_running_ = false;
+    callbacks_.clear();
+    retry_callbacks_.clear();
+    cv_.notify_all();
+    // Wait for a running pool task and a due retry to finish.
+    cv_.wait(lock,
+             [this]() { return !is_scheduled_ && !is_retry_scheduled_; });
+  }
+  for (std::thread& thread : threads_) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+  threads_.clear();
+}
+
+ProcessorExecutor::Statistics ProcessorExecutor::getAndResetStatistics() {
+  std::lock_guard<std::mutex> lock(statistics_mutex_);
+  Statistics result = statistics_;
+  statistics_ = Statistics();
+  return result;
+}
+
+void ProcessorExecutor::addCallback(const ros::CallbackInterfacePtr& callback,
+                                    uint64_t owner_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  requeueRetries();
+  callbacks_.push_back({callback, owner_id});
+  if (!is_running_) {
+    return;  // Will be executed once started.
+  }
+  if (!usesSharedPool()) {
+    cv_.notify_one();
+  } else if (!is_scheduled_) {
+    is_scheduled_ = true;
+    pool_->submit([this]() { runOnPool(); });
+  }
+}
+
+void ProcessorExecutor::removeByID(uint64_t owner_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto has_owner = [owner_id](const Entry& entry) {
+    return entry.owner_id == owner_id;
+  };
+  callbacks_.erase(
+      std::remove_if(callbacks_.begin(), callbacks_.end(), has_owner),
+      callbacks_.end());
+  retry_callbacks_.erase(std::remove_if(retry_callbacks_.begin(),
+                                        retry_callbacks_.end(), has_owner),
+                         retry_callbacks_.end());
+}
+
+void ProcessorExecutor::requeueRetries() {
+  callbacks_.insert(callbacks_.end(), retry_callbacks_.begin(),
+                    retry_callbacks_.end());
+  retry_callbacks_.clear();
+}
+
+void ProcessorExecutor::threadLoop() {
+  // Pin the thread before it runs any callback.
+  applyCpuAffinity();
+  while (true) {
+    Entry entry;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      auto has_work = [this]() { return !is_running_ || !callbacks_.empty(); };
+      if (retry_callbacks_.empty()) {
+        cv_.wait(lock, has_work);
+      } else if (!cv_.wait_for(lock, kRetryInterval, has_work)) {
+        requeueRetries();
+      }
+      if (!is_running_) {
+        return;
+      }
+      entry = callbacks_.front();
+      callbacks_.pop_front();
+    }
+    runCallback(entry);
+  }
+}
+
+void ProcessorExecutor::runOnPool() {
+  // Run a single callback per task, s.t. all stages progress evenly. The
+  // stage is only re-scheduled after the callback finished, which serializes
+  // the callbacks of the processor.
+  Entry entry;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!is_running_ || callbacks_.empty()) {
+      is_scheduled_ = false;
+      cv_.notify_all();
+      return;
+    }
+    entry = callbacks_.front();
+    callbacks_.pop_front();
+  }
+  runCallback(entry);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!is_running_ || callbacks_.empty()) {
+    is_scheduled_ = false;
+    cv_.notify_all();
+    return;
+  }
+  pool_->submit([this]() { runOnPool(); });
+}
+
+void ProcessorExecutor::retryOnPool() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  is_retry_scheduled_ = false;
+  if (is_running_) {
+    requeueRetries();
+    if (!callbacks_.empty() && !is_scheduled_) {
+      is_scheduled_ = true;
+      pool_->submit([this]() { runOnPool(); });
+    }
+  }
+  cv_.notify_all();
+}
+
+void ProcessorExecutor::runCallback(const Entry& entry) {
+  ros::CallbackInterface::CallResult result =
+      ros::CallbackInterface::TryAgain;
+  auto start = std::chrono::steady_clock::now();
+  if (entry.callback->ready()) {
+    result = entry.callback->call();
+  }
+  if (result == ros::CallbackInterface::TryAgain) {
+    // Retrying immediately would spin the thread or pool worker. Dedicated
+    // threads retry after waiting, on the pool the retry is scheduled.
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!is_running_) {
+      return;
+    }
+    retry_callbacks_.push_back(entry);
+    if (usesSharedPool() && !is_retry_scheduled_) {
+      is_retry_scheduled_ = true;
+      pool_->submitAfter(kRetryInterval, [this]() { retryOnPool(); });
+    }
+    return;
+  }
+  double duration = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+  std::lock_guard<std::mutex> lock(statistics_mutex_);
+  statistics_.num_calls++;
+  statistics_.total_time += duration;
+  statistics_.max_time = std::max(statistics_.max_time, duration);
+}
+
+}  // namespace unreal_airsim::simulator_processor
@@ -30,15 +30,25 @@ std::unique_ptr<ProcessorBase> ProcessorFactory::createFromRos(
                << name << "'. Available types are: " << typeList << ".";
     return nullptr;
   }
-  ProcessorBase* processor = getRegistryMap().at(type)();
+  std::unique_ptr<ProcessorBase> processor(getRegistryMap().at(type)());
   processor->parent_ = parent;
   processor->name_ = name;
-  if (!processor->setupFromRos(nh, ns)) {
+
+  // Every processor executes its callbacks on its own queue.
+  if (!processor->setupExecutor(nh, ns)) {
+    LOG(ERROR) << "Invalid executor config for simulator_processor '" << name
+               << "', it will be ignored.";
+    return nullptr;
+  }
+  ros::NodeHandle processor_nh(nh);
+  processor_nh.setCallbackQueue(processor->executor_->getCallbackQueue());
+  if (!processor->setupFromRos(processor_nh, ns)) {
     LOG(ERROR) << "Setup for simulator_processor '" << name
                << "' failed, it will be ignored.";
     return nullptr;
   }
-  return std::unique_ptr<ProcessorBase>(processor);
+  processor->executor_->start();
+  return processor;
 }
 
 }  // namespace unreal_airsim::simulator_processor
@@ -0,0 +1,169 @@
+#include "unreal_airsim/simulator_processing/work_stealing_pool.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+namespace unreal_airsim::simulator_processor {
+
+namespace {
+// The pool and index of the worker running on the current thread, if any.
+thread_local const WorkStealingPool* current_pool = nullptr;
+thread_local size_t current_index = 0;
+}  // namespace
+
+WorkStealingPool::WorkStealingPool(int num_threads)
+    : next_queue_(0), is_running_(true), num_sleeping_(0) {
+  if (num_threads <= 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    queues_.push_back(std::make_unique<WorkerQueue>());
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    workers_.emplace_back(&WorkStealingPool::workerLoop, this, i);
+  }
+  timer_thread_ = std::thread(&WorkStealingPool::timerLoop, this);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    is_running_ = false;
+  }
+  wake_cv_.notify_all();
+  {
+    std::lock_guard<std::mutex> lock(timer_mutex_);
+  }
+  timer_cv_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+  timer_thread_.join();
+  const size_t num_dropped = getNumQueuedTasks() + delayed_tasks_.size();
+  LOG_IF(WARNING, num_dropped > 0) << "WorkStealingPool: " << num_dropped
+                                   << " tasks were dropped on shutdown.";
+}
+
+void WorkStealingPool::submit(Task task) {
+  size_t index = current_pool == this
+                     ? current_index
+                     : next_queue_.fetch_add(1) % queues_.size();
+  {
+    WorkerQueue& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+    queue.size++;
+  }
+  // Only wake a worker if one is sleeping, busy workers find the task.
+  if (num_sleeping_ > 0) {
+    {
+      std::lock_guard<std::mutex> lock(wake_mutex_);
+    }
+    wake_cv_.notify_one();
+  }
+}
+
+void WorkStealingPool::submitAfter(Clock::duration delay, Task task) {
+  {
+    std::lock_guard<std::mutex> lock(timer_mutex_);
+    delayed_tasks_.emplace(Clock::now() + delay, std::move(task));
+  }
+  timer_cv_.notify_one();
+}
+
+bool WorkStealingPool::popTask(size_t index, Task* task) {
+  // Newest task of the own queue first.
+  {
+    WorkerQueue& own = *queues_[index];
+    if (own.size > 0) {
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.tasks.empty()) {
+        *task = std::move(own.tasks.back());
+        own.tasks.pop_back();
+        own.size--;
+        return true;
+      }
+    }
+  }
+  // Otherwise steal the oldest task of another worker.
+  for (size_t i = 1; i < queues_.size(); ++i) {
+    WorkerQueue& other = *queues_[(index + i) % queues_.size()];
+    if (other.size == 0) {
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(other.mutex);
+    if (!other.tasks.empty()) {
+      *task = std::move(other.tasks.front());
+      other.tasks.pop_front();
+      other.size--;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool WorkStealingPool::hasQueuedTasks() const {
+  return std::any_of(queues_.begin(), queues_.end(),
+                     [](const std::unique_ptr<WorkerQueue>& queue) {
+                       return queue->size > 0;
+                     });
+}
+
+size_t WorkStealingPool::getNumQueuedTasks() const {
+  size_t result = 0;
+  for (const auto& queue : queues_) {
+    result += queue->size;
+  }
+  return result;
+}
+
+void WorkStealingPool::workerLoop(size_t index) {
+  current_pool = this;
+  current_index = index;
+  while (is_running_) {
+    Task task;
+    if (popTask(index, &task)) {
+      task();
+      continue;
+    }
+    // Sleep until tasks are queued. A task stolen by another worker in the
+    // meantime only causes another scan, not a spin, as the queue sizes are
+    // exact.
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    num_sleeping_++;
+    wake_cv_.wait(lock, [this] { return !is_running_ || hasQueuedTasks(); });
+    num_sleeping_--;
+  }
+}
+
+void WorkStealingPool::timerLoop() {
+  std::unique_lock<std::mutex> lock(timer_mutex_);
+  while (is_running_) {
+    if (delayed_tasks_.empty()) {
+      timer_cv_.wait(lock);
+      continue;
+    }
+    const auto due = delayed_tasks_.begin();
+    if (timer_cv_.wait_until(lock, due->first) != std::cv_status::timeout) {
+      continue;  // A new task may be due earlier.
+    }
+    // Hand all due tasks to the workers.
+    std::vector<Task> due_tasks;
+    const Clock::time_point now = Clock::now();
+    while (!delayed_tasks_.empty() && delayed_tasks_.begin()->first <= now) {
+      due_tasks.push_back(std::move(delayed_tasks_.begin()->second));
+      delayed_tasks_.erase(delayed_tasks_.begin());
+    }
+    lock.unlock();
+    for (Task& task : due_tasks) {
+      submit(std::move(task));
+    }
+    lock.lock();
+  }
+}
+
+}  // namespace unreal_airsim::simulator_processor
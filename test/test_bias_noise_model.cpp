@@ -0,0 +1,103 @@
+#include <cmath>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "unreal_airsim/simulator_processing/odometry_drift_simulator/bias_noise_model.h"
+#include "unreal_airsim/simulator_processing/odometry_drift_simulator/random_engine.h"
+
+namespace unreal_airsim {
+namespace {
+
+BiasNoiseModel::Config makeConfig(const std::string& type, double mean,
+                                  double stddev,
+                                  double correlation_time = 1.0) {
+  BiasNoiseModel::Config config;
+  config.type = type;
+  config.mean = mean;
+  config.stddev = stddev;
+  config.correlation_time = correlation_time;
+  return config;
+}
+
+// Integrate the model over num_steps steps of delta_t, reset for each trial,
+// and return the sample mean and variance of the total integral.
+void sampleIntegral(const BiasNoiseModel::Config& config, double delta_t,
+                    int num_steps, int num_trials, double* mean,
+                    double* variance) {
+  BiasNoiseModel model(config);
+  RandomEngine engine(42);
+  double sum = 0.0, sum_squared = 0.0;
+  for (int trial = 0; trial < num_trials; ++trial) {
+    model.reset(&engine);
+    double integral = 0.0;
+    for (int step = 0; step < num_steps; ++step) {
+      const double n1 = engine.standardNormal();
+      const double n2 = engine.standardNormal();
+      integral += model.integrate(delta_t, n1, n2);
+    }
+    sum += integral;
+    sum_squared += integral * integral;
+  }
+  *mean = sum / num_trials;
+  *variance = sum_squared / num_trials - *mean * *mean;
+}
+
+TEST(BiasNoiseModelTest, RejectsUnknownType) {
+  const BiasNoiseModel::Config config = makeConfig("gaus_markov", 0.0, 1.0);
+  EXPECT_FALSE(config.isValid());
+  EXPECT_DEATH(BiasNoiseModel model(config), "Unknown BiasNoiseModel type");
+}
+
+TEST(BiasNoiseModelTest, ValidatesParameters) {
+  EXPECT_TRUE(makeConfig("piecewise_constant", 0.0, 0.0).isValid());
+  EXPECT_TRUE(makeConfig("random_walk", 0.0, 1.0, -1.0).isValid());
+  EXPECT_FALSE(makeConfig("random_walk", 0.0, -1.0).isValid());
+  EXPECT_TRUE(makeConfig("gauss_markov", 0.0, 1.0, 2.0).isValid());
+  EXPECT_FALSE(makeConfig("gauss_markov", 0.0, 1.0, 0.0).isValid());
+}
+
+TEST(BiasNoiseModelTest, PiecewiseConstantScalesSamples) {
+  BiasNoiseModel model(makeConfig("piecewise_constant", 0.5, 2.0));
+  EXPECT_TRUE(model.isPiecewiseConstant());
+  EXPECT_DOUBLE_EQ(model.samplePiecewiseConstant(0.0), 0.5);
+  EXPECT_DOUBLE_EQ(model.samplePiecewiseConstant(-1.5), -2.5);
+  EXPECT_EQ(model.integrate(0.1, 1.0, 1.0), 0.0);
+}
+
+TEST(BiasNoiseModelTest, GaussMarkovIntegralMatchesStationaryVariance) {
+  // For a stationary Gauss-Markov bias the integral over T has variance
+  // 2 sigma^2 tau^2 (x - 1 + exp(-x)) with x = T / tau, independent of how
+  // T is split into steps.
+  const double sigma = 0.3, tau = 2.0, total_time = 1.0;
+  const double x = total_time / tau;
+  const double expected =
+      2.0 * sigma * sigma * tau * tau * (x - 1.0 + std::exp(-x));
+  const int kNumTrials = 100000;
+  for (const int num_steps : {1, 10}) {
+    double mean, variance;
+    sampleIntegral(makeConfig("gauss_markov", 0.0, sigma, tau),
+                   total_time / num_steps, num_steps, kNumTrials, &mean,
+                   &variance);
+    EXPECT_NEAR(mean, 0.0, 4.0 * std::sqrt(expected / kNumTrials));
+    EXPECT_NEAR(variance, expected, 0.02 * expected) << num_steps;
+  }
+}
+
+TEST(BiasNoiseModelTest, RandomWalkIntegralMatchesVariance) {
+  // A random walk starting at zero has an integral over T with variance
+  // sigma^2 T^3 / 3, and the mean contributes mean * T.
+  const double sigma = 0.5, mean_bias = 0.2, delta_t = 0.1;
+  const int kNumSteps = 10, kNumTrials = 100000;
+  const double total_time = delta_t * kNumSteps;
+  const double expected = sigma * sigma * std::pow(total_time, 3) / 3.0;
+  double mean, variance;
+  sampleIntegral(makeConfig("random_walk", mean_bias, sigma), delta_t,
+                 kNumSteps, kNumTrials, &mean, &variance);
+  EXPECT_NEAR(mean, mean_bias * total_time,
+              4.0 * std::sqrt(expected / kNumTrials));
+  EXPECT_NEAR(variance, expected, 0.02 * expected);
+}
+
+}  // namespace
+}  // namespace unreal_airsim
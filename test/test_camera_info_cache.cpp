@@ -0,0 +1,100 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "unreal_airsim/online_simulator/camera_info_cache.h"
+
+namespace unreal_airsim {
+namespace {
+
+class CameraInfoCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    const ::testing::TestInfo* test_info =
+        ::testing::UnitTest::GetInstance()->current_test_info();
+    file_path_ = std::string("/tmp/unreal_airsim_camera_info_cache_test_") +
+                 test_info->name() + ".txt";
+    std::remove(file_path_.c_str());
+  }
+
+  void TearDown() override { std::remove(file_path_.c_str()); }
+
+  static msr::airlib::CameraInfo makeInfo(float offset) {
+    msr::airlib::CameraInfo info;
+    info.pose.position = msr::airlib::Vector3r(offset, 2.f, -3.f);
+    info.pose.orientation =
+        msr::airlib::Quaternionr(0.5f, -0.5f, 0.5f, -0.5f);
+    info.fov = 90.f + offset;
+    for (int row = 0; row < 4; ++row) {
+      for (int col = 0; col < 4; ++col) {
+        info.proj_mat.matrix[row][col] = offset + 0.1f * (4 * row + col);
+      }
+    }
+    return info;
+  }
+
+  std::string file_path_;
+};
+
+TEST_F(CameraInfoCacheTest, RoundTrip) {
+  CameraInfoCache cache(file_path_);
+  CameraInfoCache::CameraInfoMap infos;
+  infos["drone_1/front"] = makeInfo(1.f / 3.f);
+  infos["drone_2/down"] = makeInfo(-7.25f);
+  ASSERT_TRUE(cache.save(42, infos));
+
+  CameraInfoCache::CameraInfoMap loaded;
+  ASSERT_TRUE(cache.load(42, &loaded));
+  ASSERT_EQ(loaded.size(), infos.size());
+  for (const auto& name_info : infos) {
+    const msr::airlib::CameraInfo& expected = name_info.second;
+    const msr::airlib::CameraInfo& actual = loaded.at(name_info.first);
+    EXPECT_EQ(actual.pose.position, expected.pose.position);
+    EXPECT_EQ(actual.pose.orientation.coeffs(),
+              expected.pose.orientation.coeffs());
+    EXPECT_EQ(actual.fov, expected.fov);
+    for (int row = 0; row < 4; ++row) {
+      for (int col = 0; col < 4; ++col) {
+        EXPECT_EQ(actual.proj_mat.matrix[row][col],
+                  expected.proj_mat.matrix[row][col]);
+      }
+    }
+  }
+}
+
+TEST_F(CameraInfoCacheTest, RejectsDifferentKey) {
+  CameraInfoCache cache(file_path_);
+  CameraInfoCache::CameraInfoMap infos;
+  infos["drone_1/front"] = makeInfo(1.f);
+  ASSERT_TRUE(cache.save(1, infos));
+  CameraInfoCache::CameraInfoMap loaded;
+  EXPECT_FALSE(cache.load(2, &loaded));
+  EXPECT_TRUE(loaded.empty());
+}
+
+TEST_F(CameraInfoCacheTest, RejectsMissingAndCorruptFiles) {
+  CameraInfoCache cache(file_path_);
+  CameraInfoCache::CameraInfoMap loaded;
+  EXPECT_FALSE(cache.load(1, &loaded));
+
+  CameraInfoCache::CameraInfoMap infos;
+  infos["drone_1/front"] = makeInfo(1.f);
+  ASSERT_TRUE(cache.save(1, infos));
+  std::ofstream(file_path_, std::ios::app) << "drone_1/broken 1 2 3\n";
+  EXPECT_FALSE(cache.load(1, &loaded));
+  EXPECT_TRUE(loaded.empty());
+}
+
+TEST(CameraInfoCacheKeyTest, IsFnv1a) {
+  // Reference values of the 64 bit FNV-1a hash.
+  EXPECT_EQ(CameraInfoCache::computeKey(""), 0xcbf29ce484222325ull);
+  EXPECT_EQ(CameraInfoCache::computeKey("a"), 0xaf63dc4c8601ec8cull);
+  EXPECT_EQ(CameraInfoCache::computeKey("foobar"), 0x85944171f73967e8ull);
+  EXPECT_NE(CameraInfoCache::computeKey("FOV_Degrees: 90"),
+            CameraInfoCache::computeKey("FOV_Degrees: 91"));
+}
+
+}  // namespace
+}  // namespace unreal_airsim
@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+#include <gtest/gtest.h>
+
+#include "unreal_airsim/compact_pointcloud.h"
+
+namespace unreal_airsim {
+namespace {
+
+sensor_msgs::PointField makeField(const std::string& name, uint32_t offset,
+                                  uint8_t datatype) {
+  sensor_msgs::PointField field;
+  field.name = name;
+  field.offset = offset;
+  field.datatype = datatype;
+  field.count = 1;
+  return field;
+}
+
+// Cloud with FLOAT32 x, y, z and optional FLOAT32 rgb and UINT8 id fields.
+sensor_msgs::PointCloud2 makeCloud(const std::vector<Eigen::Vector3f>& points,
+                                   bool use_color, bool use_id) {
+  sensor_msgs::PointCloud2 cloud;
+  cloud.height = 1;
+  cloud.width = points.size();
+  cloud.is_bigendian = false;
+  cloud.is_dense = false;
+  cloud.fields = {makeField("x", 0, sensor_msgs::PointField::FLOAT32),
+                  makeField("y", 4, sensor_msgs::PointField::FLOAT32),
+                  makeField("z", 8, sensor_msgs::PointField::FLOAT32)};
+  uint32_t offset = 12;
+  if (use_color) {
+    cloud.fields.push_back(
+        makeField("rgb", offset, sensor_msgs::PointField::FLOAT32));
+    offset += 4;
+  }
+  if (use_id) {
+    cloud.fields.push_back(
+        makeField("id", offset, sensor_msgs::PointField::UINT8));
+    offset += 1;
+  }
+  cloud.point_step = offset;
+  cloud.row_step = cloud.point_step * cloud.width;
+  cloud.data.assign(cloud.row_step, 0);
+  for (size_t i = 0; i < points.size(); ++i) {
+    uint8_t* point = cloud.data.data() + i * cloud.point_step;
+    std::memcpy(point, points[i].data(), 3 * sizeof(float));
+    if (use_color) {
+      point[12] = i % 256;        // b
+      point[13] = (3 * i) % 256;  // g
+      point[14] = (7 * i) % 256;  // r
+    }
+    if (use_id) {
+      point[offset - 1] = i % 13;
+    }
+  }
+  return cloud;
+}
+
+Eigen::Vector3f getPoint(const sensor_msgs::PointCloud2& cloud, size_t i) {
+  Eigen::Vector3f point;
+  std::memcpy(point.data(), cloud.data.data() + i * cloud.point_step,
+              3 * sizeof(float));
+  return point;
+}
+
+std::vector<Eigen::Vector3f> randomPoints(size_t num_points, float range) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> distribution(-range, range);
+  std::vector<Eigen::Vector3f> points(num_points);
+  for (Eigen::Vector3f& point : points) {
+    point = Eigen::Vector3f(distribution(generator), distribution(generator),
+                            distribution(generator));
+  }
+  return points;
+}
+
+TEST(CompactPointcloudTest, RoundTripIsWithinErrorBound) {
+  const std::vector<Eigen::Vector3f> points = randomPoints(1000, 50.f);
+  const sensor_msgs::PointCloud2 cloud = makeCloud(points, false, false);
+  sensor_msgs::PointCloud2 compact, decoded;
+  compact_pointcloud::EncodingStatistics statistics;
+  const float resolution = compact_pointcloud::kDefaultResolution;
+  ASSERT_TRUE(
+      compact_pointcloud::encode(cloud, resolution, &compact, &statistics));
+  EXPECT_EQ(compact.point_step, 6u);
+  EXPECT_EQ(compact.data.size(), points.size() * 6u);
+  EXPECT_EQ(statistics.num_points, points.size());
+  EXPECT_EQ(statistics.num_dropped, 0u);
+  EXPECT_LE(statistics.max_error, statistics.error_bound);
+  EXPECT_FLOAT_EQ(statistics.error_bound, std::sqrt(3.f) / 2.f * resolution);
+
+  ASSERT_TRUE(compact_pointcloud::decode(compact, &decoded));
+  ASSERT_EQ(decoded.width, points.size());
+  float max_error = 0.f;
+  for (size_t i = 0; i < points.size(); ++i) {
+    const Eigen::Vector3f error = getPoint(decoded, i) - points[i];
+    EXPECT_LE(error.cwiseAbs().maxCoeff(), 0.5f * resolution + 1e-5f);
+    max_error = std::max(max_error, error.norm());
+  }
+  EXPECT_NEAR(max_error, statistics.max_error, 1e-5f);
+}
+
+TEST(CompactPointcloudTest, RoundTripKeepsColorAndLabels) {
+  const std::vector<Eigen::Vector3f> points = randomPoints(300, 10.f);
+  const sensor_msgs::PointCloud2 cloud = makeCloud(points, true, true);
+  sensor_msgs::PointCloud2 compact, decoded;
+  ASSERT_TRUE(compact_pointcloud::encode(cloud, 0.01f, &compact));
+  EXPECT_EQ(compact.point_step, 10u);
+  ASSERT_TRUE(compact_pointcloud::decode(compact, &decoded));
+  ASSERT_EQ(decoded.width, points.size());
+  ASSERT_EQ(decoded.point_step, 17u);
+  for (size_t i = 0; i < points.size(); ++i) {
+    const uint8_t* in = cloud.data.data() + i * cloud.point_step;
+    const uint8_t* out = decoded.data.data() + i * decoded.point_step;
+    EXPECT_EQ(std::memcmp(in + 12, out + 12, 3), 0);
+    EXPECT_EQ(in[16], out[16]);
+  }
+}
+
+TEST(CompactPointcloudTest, DropsInvalidAndOutOfRangePoints) {
+  const float resolution = 0.001f;
+  const float max_range = 32767.f * resolution;
+  std::vector<Eigen::Vector3f> points = {
+      Eigen::Vector3f(1.f, 2.f, 3.f),
+      Eigen::Vector3f(max_range + 0.01f, 0.f, 0.f),
+      Eigen::Vector3f(0.f, std::numeric_limits<float>::quiet_NaN(), 0.f),
+      Eigen::Vector3f(0.f, 0.f, -std::numeric_limits<float>::infinity()),
+      Eigen::Vector3f(-max_range, max_range, 0.f)};
+  const sensor_msgs::PointCloud2 cloud = makeCloud(points, false, false);
+  sensor_msgs::PointCloud2 compact, decoded;
+  compact_pointcloud::EncodingStatistics statistics;
+  ASSERT_TRUE(
+      compact_pointcloud::encode(cloud, resolution, &compact, &statistics));
+  EXPECT_EQ(statistics.num_points, 2u);
+  EXPECT_EQ(statistics.num_dropped, 3u);
+  ASSERT_TRUE(compact_pointcloud::decode(compact, &decoded));
+  ASSERT_EQ(decoded.width, 2u);
+  EXPECT_TRUE(getPoint(decoded, 0).isApprox(points[0], 1e-3f));
+  EXPECT_TRUE(getPoint(decoded, 1).isApprox(points[4], 1e-3f));
+}
+
+TEST(CompactPointcloudTest, ResolutionIsCarriedInTheFieldList) {
+  const sensor_msgs::PointCloud2 cloud =
+      makeCloud(randomPoints(10, 1.f), false, false);
+  float resolution = 0.f;
+  EXPECT_FALSE(compact_pointcloud::isCompact(cloud, &resolution));
+
+  sensor_msgs::PointCloud2 compact;
+  ASSERT_TRUE(compact_pointcloud::encode(cloud, 0.0123f, &compact));
+  ASSERT_TRUE(compact_pointcloud::isCompact(compact, &resolution));
+  EXPECT_EQ(resolution, 0.0123f);
+  const sensor_msgs::PointField& field = compact.fields.back();
+  EXPECT_EQ(field.count, 0u);
+  EXPECT_EQ(field.name.compare(
+                0, compact_pointcloud::kResolutionFieldPrefix.size(),
+                compact_pointcloud::kResolutionFieldPrefix),
+            0);
+}
+
+TEST(CompactPointcloudTest, RejectsInvalidInput) {
+  sensor_msgs::PointCloud2 cloud =
+      makeCloud(randomPoints(10, 1.f), false, false);
+  sensor_msgs::PointCloud2 compact, decoded;
+  EXPECT_FALSE(compact_pointcloud::encode(cloud, 0.f, &compact));
+  EXPECT_FALSE(compact_pointcloud::decode(cloud, &decoded));
+  cloud.fields[2].datatype = sensor_msgs::PointField::FLOAT64;
+  EXPECT_FALSE(compact_pointcloud::encode(cloud, 0.01f, &compact));
+  cloud.fields.pop_back();
+  EXPECT_FALSE(compact_pointcloud::encode(cloud, 0.01f, &compact));
+}
+
+}  // namespace
+}  // namespace unreal_airsim
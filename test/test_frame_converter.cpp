@@ -0,0 +1,158 @@
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <Eigen/Geometry>
+#include <gtest/gtest.h>
+
+#include "unreal_airsim/frame_converter.h"
+
+namespace unreal_airsim {
+namespace {
+
+constexpr double kTolerance = 1e-9;
+constexpr float kFloatTolerance = 1e-4f;
+
+// The scalar path converts via rotation matrices, so q and -q are both valid.
+bool isSameRotation(const Eigen::Quaterniond& a, const Eigen::Quaterniond& b) {
+  return a.coeffs().isApprox(b.coeffs(), kTolerance) ||
+         a.coeffs().isApprox(-b.coeffs(), kTolerance);
+}
+
+// The batch paths specialize on the structure of the setup, so every test
+// runs on the identity, a yaw only and a general rotation.
+class FrameConverterTest : public ::testing::TestWithParam<int> {
+ protected:
+  void SetUp() override {
+    switch (GetParam()) {
+      case 0:
+        converter_.reset();
+        break;
+      case 1:
+        converter_.setupFromYaw(0.7);
+        break;
+      default:
+        converter_.setupFromQuat(
+            Eigen::Quaterniond(Eigen::AngleAxisd(
+                0.4, Eigen::Vector3d(1.0, -2.0, 0.5).normalized())));
+        break;
+    }
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> value(-10.0, 10.0);
+    for (int i = 0; i < 100; ++i) {
+      points_.emplace_back(value(rng), value(rng), value(rng));
+      orientations_.push_back(
+          Eigen::Quaterniond(value(rng), value(rng), value(rng), value(rng))
+              .normalized());
+    }
+  }
+
+  FrameConverter converter_;
+  std::vector<Eigen::Vector3d> points_;
+  std::vector<Eigen::Quaterniond> orientations_;
+};
+
+TEST_P(FrameConverterTest, BatchPointsMatchScalar) {
+  std::vector<Eigen::Vector3d> to_ros = points_;
+  std::vector<Eigen::Vector3d> to_airsim = points_;
+  converter_.airsimToRos(to_ros.data(), to_ros.size());
+  converter_.rosToAirsim(to_airsim.data(), to_airsim.size());
+  for (size_t i = 0; i < points_.size(); ++i) {
+    Eigen::Vector3d expected = points_[i];
+    converter_.airsimToRos(&expected);
+    EXPECT_TRUE(to_ros[i].isApprox(expected, kTolerance)) << i;
+    expected = points_[i];
+    converter_.rosToAirsim(&expected);
+    EXPECT_TRUE(to_airsim[i].isApprox(expected, kTolerance)) << i;
+  }
+}
+
+TEST_P(FrameConverterTest, BatchFloatPointsMatchScalar) {
+  std::vector<Eigen::Vector3f> to_ros, to_airsim;
+  for (const Eigen::Vector3d& point : points_) {
+    to_ros.push_back(point.cast<float>());
+    to_airsim.push_back(point.cast<float>());
+  }
+  converter_.airsimToRos(to_ros.data(), to_ros.size());
+  converter_.rosToAirsim(to_airsim.data(), to_airsim.size());
+  for (size_t i = 0; i < points_.size(); ++i) {
+    Eigen::Vector3d expected = points_[i];
+    converter_.airsimToRos(&expected);
+    EXPECT_LT((to_ros[i] - expected.cast<float>()).norm(), kFloatTolerance);
+    expected = points_[i];
+    converter_.rosToAirsim(&expected);
+    EXPECT_LT((to_airsim[i] - expected.cast<float>()).norm(),
+              kFloatTolerance);
+  }
+}
+
+TEST_P(FrameConverterTest, BatchOrientationsMatchScalar) {
+  std::vector<Eigen::Quaterniond> to_ros = orientations_;
+  std::vector<Eigen::Quaterniond> to_airsim = orientations_;
+  converter_.airsimToRos(to_ros.data(), to_ros.size());
+  converter_.rosToAirsim(to_airsim.data(), to_airsim.size());
+  for (size_t i = 0; i < orientations_.size(); ++i) {
+    Eigen::Quaterniond expected = orientations_[i];
+    converter_.airsimToRos(&expected);
+    EXPECT_TRUE(isSameRotation(to_ros[i], expected)) << i;
+    expected = orientations_[i];
+    converter_.rosToAirsim(&expected);
+    EXPECT_TRUE(isSameRotation(to_airsim[i], expected)) << i;
+  }
+}
+
+TEST_P(FrameConverterTest, RoundTripIsIdentity) {
+  std::vector<Eigen::Vector3d> points = points_;
+  converter_.airsimToRos(points.data(), points.size());
+  converter_.rosToAirsim(points.data(), points.size());
+  std::vector<Eigen::Quaterniond> orientations = orientations_;
+  converter_.rosToAirsim(orientations.data(), orientations.size());
+  converter_.airsimToRos(orientations.data(), orientations.size());
+  for (size_t i = 0; i < points_.size(); ++i) {
+    EXPECT_TRUE(points[i].isApprox(points_[i], kTolerance)) << i;
+    EXPECT_TRUE(isSameRotation(orientations[i], orientations_[i])) << i;
+  }
+}
+
+TEST_P(FrameConverterTest, MessagesMatchEigen) {
+  geometry_msgs::Pose pose;
+  pose.position.x = points_[0].x();
+  pose.position.y = points_[0].y();
+  pose.position.z = points_[0].z();
+  pose.orientation.w = orientations_[0].w();
+  pose.orientation.x = orientations_[0].x();
+  pose.orientation.y = orientations_[0].y();
+  pose.orientation.z = orientations_[0].z();
+  converter_.airsimToRos(&pose);
+  Eigen::Vector3d position = points_[0];
+  Eigen::Quaterniond orientation = orientations_[0];
+  converter_.airsimToRos(&position);
+  converter_.airsimToRos(&orientation);
+  EXPECT_NEAR(pose.position.x, position.x(), kTolerance);
+  EXPECT_NEAR(pose.position.y, position.y(), kTolerance);
+  EXPECT_NEAR(pose.position.z, position.z(), kTolerance);
+  EXPECT_TRUE(isSameRotation(
+      Eigen::Quaterniond(pose.orientation.w, pose.orientation.x,
+                         pose.orientation.y, pose.orientation.z),
+      orientation));
+}
+
+INSTANTIATE_TEST_CASE_P(Setups, FrameConverterTest,
+                        ::testing::Values(0, 1, 2));
+
+TEST(FrameConverterAxesTest, AxesOnlyMatchIdentityConversion) {
+  std::vector<float> xyz = {1.f, 2.f, 3.f, -4.f, 5.f, -6.f};
+  FrameConverter::airsimAxesToRos(xyz.data(), 2);
+  const FrameConverter identity;
+  for (size_t i = 0; i < 2; ++i) {
+    Eigen::Vector3d expected(i == 0 ? 1.0 : -4.0, i == 0 ? 2.0 : 5.0,
+                             i == 0 ? 3.0 : -6.0);
+    identity.airsimToRos(&expected);
+    EXPECT_FLOAT_EQ(xyz[3 * i], expected.x());
+    EXPECT_FLOAT_EQ(xyz[3 * i + 1], expected.y());
+    EXPECT_FLOAT_EQ(xyz[3 * i + 2], expected.z());
+  }
+}
+
+}  // namespace
+}  // namespace unreal_airsim
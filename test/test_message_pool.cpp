@@ -0,0 +1,127 @@
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <sensor_msgs/Image.h>
+
+#include "unreal_airsim/online_simulator/message_pool.h"
+
+namespace unreal_airsim {
+namespace {
+
+using ImagePool = MessagePool<sensor_msgs::Image>;
+
+TEST(MessagePoolTest, ReusesReleasedBuffers) {
+  ImagePool pool;
+  const uint8_t* buffer;
+  {
+    ImagePool::MsgPtr msg = pool.acquire(1000);
+    ASSERT_EQ(msg->data.size(), 1000u);
+    msg->height = 10;
+    msg->encoding = "mono8";
+    buffer = msg->data.data();
+  }
+  ImagePool::MsgPtr msg = pool.acquire(500);
+  EXPECT_EQ(msg->data.data(), buffer);
+  EXPECT_EQ(msg->data.size(), 500u);
+  // All other fields are reset.
+  EXPECT_EQ(msg->height, 0u);
+  EXPECT_TRUE(msg->encoding.empty());
+
+  const MessagePoolStatistics statistics = pool.getAndResetStatistics();
+  EXPECT_EQ(statistics.num_hits, 1u);
+  EXPECT_EQ(statistics.num_misses, 1u);
+}
+
+TEST(MessagePoolTest, GrowsTooSmallBuffers) {
+  ImagePool pool;
+  pool.acquire(100);
+  ImagePool::MsgPtr msg = pool.acquire(200);
+  EXPECT_EQ(msg->data.size(), 200u);
+  const MessagePoolStatistics statistics = pool.getAndResetStatistics();
+  EXPECT_EQ(statistics.num_hits, 0u);
+  EXPECT_EQ(statistics.num_misses, 2u);
+  EXPECT_EQ(statistics.current_bytes, msg->data.capacity());
+}
+
+TEST(MessagePoolTest, TracksCurrentAndPeakBytes) {
+  ImagePool pool(2);
+  {
+    std::vector<ImagePool::MsgPtr> msgs;
+    for (int i = 0; i < 3; ++i) {
+      msgs.push_back(pool.acquire(100));
+    }
+    const MessagePoolStatistics statistics = pool.getAndResetStatistics();
+    EXPECT_EQ(statistics.current_bytes, 300u);
+    EXPECT_EQ(statistics.peak_bytes, 300u);
+  }
+  // Only max_pooled messages are kept, the peak is reset to the current.
+  MessagePoolStatistics statistics = pool.getAndResetStatistics();
+  EXPECT_EQ(statistics.num_hits + statistics.num_misses, 0u);
+  EXPECT_EQ(statistics.current_bytes, 200u);
+  EXPECT_EQ(statistics.peak_bytes, 300u);
+  statistics = pool.getAndResetStatistics();
+  EXPECT_EQ(statistics.peak_bytes, 200u);
+}
+
+TEST(MessagePoolTest, AccountsForGrowthByHolders) {
+  ImagePool pool;
+  {
+    ImagePool::MsgPtr msg = pool.acquire(100);
+    msg->data.resize(1000);
+  }
+  EXPECT_GE(pool.getAndResetStatistics().current_bytes, 1000u);
+  ImagePool::MsgPtr msg = pool.acquire(1000);
+  EXPECT_EQ(pool.getAndResetStatistics().num_hits, 1u);
+}
+
+TEST(MessagePoolTest, MessagesMayOutliveThePool) {
+  ImagePool::MsgPtr msg;
+  {
+    ImagePool pool;
+    msg = pool.acquire(100);
+  }
+  msg->data[99] = 1;
+  msg.reset();
+}
+
+TEST(MessagePoolTest, IsThreadSafe) {
+  ImagePool pool(4);
+  constexpr int kNumThreads = 4;
+  constexpr int kNumIterations = 1000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&pool, t]() {
+      for (int i = 0; i < kNumIterations; ++i) {
+        ImagePool::MsgPtr msg = pool.acquire(64 + (i % 8));
+        msg->data[0] = static_cast<uint8_t>(t);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  const MessagePoolStatistics statistics = pool.getAndResetStatistics();
+  EXPECT_EQ(statistics.num_hits + statistics.num_misses,
+            static_cast<size_t>(kNumThreads * kNumIterations));
+  EXPECT_LE(statistics.num_misses, static_cast<size_t>(2 * kNumThreads * 8));
+}
+
+TEST(MessagePoolStatisticsTest, SumsCountsButNotPeaks) {
+  MessagePoolStatistics total;
+  MessagePoolStatistics pool;
+  pool.num_hits = 1;
+  pool.num_misses = 2;
+  pool.current_bytes = 100;
+  pool.peak_bytes = 150;
+  total += pool;
+  total += pool;
+  EXPECT_EQ(total.num_hits, 2u);
+  EXPECT_EQ(total.num_misses, 4u);
+  EXPECT_EQ(total.current_bytes, 200u);
+  EXPECT_EQ(total.peak_bytes, 0u);
+}
+
+}  // namespace
+}  // namespace unreal_airsim
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+
+#include "unreal_airsim/simulator_processing/odometry_drift_simulator/odometry_drift_simulator.h"
+
+namespace unreal_airsim {
+namespace {
+
+using Transformation = OdometryDriftSimulator::Transformation;
+
+OdometryDriftSimulator::Config makeConfig(int history_size) {
+  OdometryDriftSimulator::Config config;
+  config.seed = 7;
+  config.history_size = history_size;
+  config.velocity_noise_frequency_hz = 10.f;
+  config.velocity_noise["x"].stddev = 0.5;
+  config.velocity_noise["y"].stddev = 0.5;
+  config.velocity_noise["yaw"].stddev = 0.2;
+  return config;
+}
+
+void expectNear(const Transformation& expected, const Transformation& actual) {
+  EXPECT_NEAR((expected.getPosition() - actual.getPosition()).norm(), 0.0,
+              1e-9);
+  EXPECT_NEAR(expected.getEigenQuaternion().angularDistance(
+                  actual.getEigenQuaternion()),
+              0.0, 1e-9);
+}
+
+// Ticks with the identity as ground truth pose, s.t. the simulated pose is
+// the drift as long as there is no pose noise.
+class OdometryDriftHistoryTest : public ::testing::Test {
+ protected:
+  void tick(OdometryDriftSimulator* simulator, double time) {
+    simulator->tick(Transformation(), ros::Time(time));
+    drifts_.push_back(simulator->getSimulatedPose());
+  }
+
+  Transformation driftAt(const OdometryDriftSimulator& simulator,
+                         double time) const {
+    return simulator.convertGroundTruthToDriftedPose(Transformation(),
+                                                     ros::Time(time));
+  }
+
+  OdometryDriftSimulator::TransformationVector drifts_;
+};
+
+TEST_F(OdometryDriftHistoryTest, ReturnsTheDriftOfEachTick) {
+  OdometryDriftSimulator simulator(makeConfig(100));
+  for (int i = 0; i < 10; ++i) {
+    tick(&simulator, 1.0 + 0.1 * i);
+  }
+  // The drift actually changes between the ticks.
+  EXPECT_GT(drifts_.back().getPosition().norm(), 0.0);
+  for (int i = 0; i < 10; ++i) {
+    expectNear(drifts_[i], driftAt(simulator, 1.0 + 0.1 * i));
+  }
+}
+
+TEST_F(OdometryDriftHistoryTest, InterpolatesBetweenTicks) {
+  OdometryDriftSimulator simulator(makeConfig(100));
+  for (int i = 0; i < 4; ++i) {
+    tick(&simulator, 1.0 + 0.1 * i);
+  }
+  const double t = 0.25;
+  const Transformation& before = drifts_[1];
+  const Transformation& after = drifts_[2];
+  const Transformation expected(
+      Transformation::Rotation(before.getEigenQuaternion().slerp(
+          t, after.getEigenQuaternion())),
+      (1.0 - t) * before.getPosition() + t * after.getPosition());
+  expectNear(expected, driftAt(simulator, 1.1 + 0.1 * t));
+}
+
+TEST_F(OdometryDriftHistoryTest, ClampsToTheHistory) {
+  OdometryDriftSimulator simulator(makeConfig(3));
+  for (int i = 0; i < 5; ++i) {
+    tick(&simulator, 1.0 + 0.1 * i);
+  }
+  // Only the last 3 ticks are kept, newer stamps use the newest drift.
+  expectNear(drifts_[2], driftAt(simulator, 1.0));
+  expectNear(drifts_[2], driftAt(simulator, 1.2));
+  expectNear(drifts_[4], driftAt(simulator, 10.0));
+  // Unset stamps use the current drift.
+  expectNear(drifts_[4], driftAt(simulator, 0.0));
+}
+
+TEST_F(OdometryDriftHistoryTest, KeepsTheHistoryOrdered) {
+  OdometryDriftSimulator simulator(makeConfig(100));
+  tick(&simulator, 1.0);
+  tick(&simulator, 1.1);
+  tick(&simulator, 1.2);
+  // A repeated stamp overwrites the newest state, an older one is skipped.
+  tick(&simulator, 1.2);
+  simulator.tick(Transformation(), ros::Time(1.15));
+  expectNear(drifts_[3], driftAt(simulator, 1.2));
+  expectNear(drifts_[1], driftAt(simulator, 1.1));
+}
+
+TEST_F(OdometryDriftHistoryTest, ConversionsAreInverse) {
+  OdometryDriftSimulator::Config config = makeConfig(100);
+  config.pose_noise["x"].stddev = 0.01;
+  config.pose_noise["yaw"].stddev = 0.01;
+  OdometryDriftSimulator simulator(config);
+  for (int i = 0; i < 5; ++i) {
+    tick(&simulator, 1.0 + 0.1 * i);
+  }
+  const Transformation pose(
+      Transformation::Rotation(
+          Eigen::Quaterniond(Eigen::AngleAxisd(0.3, Eigen::Vector3d::UnitZ()))),
+      Eigen::Vector3d(1.0, -2.0, 0.5));
+  for (double time : {1.0, 1.13, 1.25, 1.4}) {
+    const ros::Time stamp(time);
+    expectNear(pose, simulator.convertDriftedToGroundTruthPose(
+                         simulator.convertGroundTruthToDriftedPose(pose, stamp),
+                         stamp));
+  }
+}
+
+TEST_F(OdometryDriftHistoryTest, SeedDeterminesTheDrift) {
+  OdometryDriftSimulator simulator(makeConfig(100));
+  OdometryDriftSimulator same(makeConfig(100));
+  for (int i = 0; i < 5; ++i) {
+    const ros::Time stamp(1.0 + 0.1 * i);
+    simulator.tick(Transformation(), stamp);
+    same.tick(Transformation(), stamp);
+    expectNear(simulator.getSimulatedPose(), same.getSimulatedPose());
+  }
+}
+
+}  // namespace
+}  // namespace unreal_airsim
@@ -0,0 +1,118 @@
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "unreal_airsim/simulator_processing/odometry_drift_simulator/random_engine.h"
+
+namespace unreal_airsim {
+namespace {
+
+TEST(RandomEngineTest, SequenceIsDeterminedBySeed) {
+  RandomEngine engine(42), same(42), other(43);
+  bool differs = false;
+  for (int i = 0; i < 100; ++i) {
+    const uint64_t value = engine();
+    EXPECT_EQ(value, same());
+    differs |= value != other();
+  }
+  EXPECT_TRUE(differs);
+
+  // Reseeding restarts the sequence.
+  RandomEngine reseeded(7);
+  reseeded();
+  reseeded.seed(42);
+  RandomEngine reference(42);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(reseeded(), reference());
+  }
+}
+
+TEST(RandomEngineTest, JumpDerivesNonOverlappingStreams) {
+  RandomEngine jumped(42);
+  jumped.jump();
+  RandomEngine stream(42, 1);
+  RandomEngine base(42);
+  std::unordered_set<uint64_t> base_values;
+  for (int i = 0; i < 10000; ++i) {
+    base_values.insert(base());
+  }
+  for (int i = 0; i < 10000; ++i) {
+    const uint64_t value = jumped();
+    EXPECT_EQ(value, stream());
+    EXPECT_EQ(base_values.count(value), 0u);
+  }
+
+  // Jumps compose, stream 2 is two jumps from the seed.
+  RandomEngine twice(42);
+  twice.jump();
+  twice.jump();
+  RandomEngine stream_2(42, 2);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(twice(), stream_2());
+  }
+}
+
+TEST(RandomEngineTest, UniformIsInUnitInterval) {
+  RandomEngine engine(1);
+  constexpr int kNumSamples = 100000;
+  double sum = 0.0;
+  for (int i = 0; i < kNumSamples; ++i) {
+    const double sample = engine.uniform();
+    ASSERT_GE(sample, 0.0);
+    ASSERT_LT(sample, 1.0);
+    sum += sample;
+  }
+  // Standard error of the mean is 1 / sqrt(12 * n) ~ 1e-3.
+  EXPECT_NEAR(sum / kNumSamples, 0.5, 5e-3);
+}
+
+TEST(RandomEngineTest, StandardNormalStatistics) {
+  RandomEngine engine(2);
+  constexpr int kNumSamples = 200000;
+  double sum = 0.0, sum_squared = 0.0;
+  int num_within_one_sigma = 0;
+  for (int i = 0; i < kNumSamples; ++i) {
+    const double sample = engine.standardNormal();
+    sum += sample;
+    sum_squared += sample * sample;
+    num_within_one_sigma += std::fabs(sample) < 1.0;
+  }
+  const double mean = sum / kNumSamples;
+  const double variance = sum_squared / kNumSamples - mean * mean;
+  // Standard errors are ~2e-3 for the mean and ~3e-3 for the variance.
+  EXPECT_NEAR(mean, 0.0, 0.01);
+  EXPECT_NEAR(variance, 1.0, 0.015);
+  EXPECT_NEAR(static_cast<double>(num_within_one_sigma) / kNumSamples,
+              std::erf(1.0 / std::sqrt(2.0)), 5e-3);
+}
+
+TEST(RandomEngineTest, BatchesMatchSingleDraws) {
+  // Odd batch sizes keep the spare sample of the last pair.
+  RandomEngine batched(3), single(3);
+  for (size_t n : {1u, 3u, 4u, 5u, 2u, 7u}) {
+    std::vector<double> samples(n);
+    batched.fillStandardNormal(samples.data(), n);
+    for (double sample : samples) {
+      EXPECT_EQ(sample, single.standardNormal());
+    }
+  }
+}
+
+TEST(RandomEngineTest, WorksWithStandardDistributions) {
+  RandomEngine engine(4);
+  std::uniform_int_distribution<int> distribution(0, 9);
+  std::vector<int> counts(10, 0);
+  for (int i = 0; i < 10000; ++i) {
+    counts[distribution(engine)]++;
+  }
+  for (int count : counts) {
+    EXPECT_NEAR(count, 1000, 150);
+  }
+}
+
+}  // namespace
+}  // namespace unreal_airsim
@@ -0,0 +1,154 @@
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "unreal_airsim/shared_memory_image.h"
+
+namespace unreal_airsim {
+namespace {
+
+class SharedMemoryImageTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    segment_name_ = SharedImageWriter::segmentName(
+        "/test_" + std::to_string(getpid()) + "/" +
+        ::testing::UnitTest::GetInstance()->current_test_info()->name());
+  }
+
+  static sensor_msgs::Image makeImage(uint8_t value, size_t width = 16) {
+    sensor_msgs::Image image;
+    image.height = 2;
+    image.width = width;
+    image.encoding = "mono8";
+    image.step = width;
+    image.data.resize(2 * width);
+    for (size_t i = 0; i < image.data.size(); ++i) {
+      image.data[i] = static_cast<uint8_t>(value + i);
+    }
+    return image;
+  }
+
+  static bool holds(const std::shared_ptr<const uint8_t>& data,
+                    const sensor_msgs::Image& image) {
+    return data &&
+           std::memcmp(data.get(), image.data.data(), image.data.size()) == 0;
+  }
+
+  std::string segment_name_;
+};
+
+TEST_F(SharedMemoryImageTest, SegmentNameIsPosixName) {
+  EXPECT_EQ(SharedImageWriter::segmentName("/drone/camera/image"),
+            "/unreal_airsim_drone_camera_image");
+}
+
+TEST_F(SharedMemoryImageTest, RoundTrip) {
+  SharedImageWriter writer(segment_name_, 2, 64);
+  ASSERT_TRUE(writer.isValid());
+  const sensor_msgs::Image image = makeImage(7);
+  SharedImage descriptor;
+  ASSERT_TRUE(writer.write(image, &descriptor));
+  EXPECT_EQ(descriptor.segment, segment_name_);
+  EXPECT_EQ(descriptor.height, image.height);
+  EXPECT_EQ(descriptor.width, image.width);
+  EXPECT_EQ(descriptor.encoding, image.encoding);
+  EXPECT_EQ(descriptor.step, image.step);
+  EXPECT_EQ(descriptor.size, image.data.size());
+
+  SharedImageReader reader;
+  EXPECT_TRUE(holds(reader.read(descriptor), image));
+  // Frames can be read repeatedly until they are overwritten.
+  EXPECT_TRUE(holds(reader.read(descriptor), image));
+}
+
+TEST_F(SharedMemoryImageTest, RejectsOversizedImages) {
+  SharedImageWriter writer(segment_name_, 2, 16);
+  SharedImage descriptor;
+  EXPECT_FALSE(writer.write(makeImage(0, 16), &descriptor));
+  EXPECT_TRUE(writer.write(makeImage(0, 8), &descriptor));
+}
+
+TEST_F(SharedMemoryImageTest, OverwrittenFramesAreUnavailable) {
+  SharedImageWriter writer(segment_name_, 2, 64);
+  SharedImageReader reader;
+  SharedImage first, second, third;
+  ASSERT_TRUE(writer.write(makeImage(1), &first));
+  ASSERT_TRUE(writer.write(makeImage(2), &second));
+  ASSERT_TRUE(writer.write(makeImage(3), &third));
+  EXPECT_EQ(third.slot, first.slot);
+  EXPECT_EQ(reader.read(first), nullptr);
+  EXPECT_TRUE(holds(reader.read(second), makeImage(2)));
+  EXPECT_TRUE(holds(reader.read(third), makeImage(3)));
+}
+
+TEST_F(SharedMemoryImageTest, ReferencedFramesAreNotOverwritten) {
+  SharedImageWriter writer(segment_name_, 2, 64);
+  SharedImageReader reader;
+  SharedImage held, other;
+  ASSERT_TRUE(writer.write(makeImage(1), &held));
+  std::shared_ptr<const uint8_t> data = reader.read(held);
+  ASSERT_TRUE(holds(data, makeImage(1)));
+
+  // Writes skip the referenced slot.
+  for (uint8_t i = 2; i < 6; ++i) {
+    ASSERT_TRUE(writer.write(makeImage(i), &other));
+    EXPECT_NE(other.slot, held.slot);
+  }
+  EXPECT_TRUE(holds(data, makeImage(1)));
+  EXPECT_TRUE(holds(reader.read(held), makeImage(1)));
+
+  // Frames are dropped while all slots are referenced.
+  std::shared_ptr<const uint8_t> other_data = reader.read(other);
+  ASSERT_TRUE(other_data);
+  SharedImage dropped;
+  EXPECT_FALSE(writer.write(makeImage(9), &dropped));
+
+  // Released slots are reused.
+  data.reset();
+  ASSERT_TRUE(writer.write(makeImage(9), &dropped));
+  EXPECT_EQ(dropped.slot, held.slot);
+  EXPECT_EQ(reader.read(held), nullptr);
+}
+
+TEST_F(SharedMemoryImageTest, ReplacedSegmentSurvivesOldWriter) {
+  // E.g. a camera whose frames grew: the new writer is created before the
+  // old one is destroyed.
+  auto writer = std::make_unique<SharedImageWriter>(segment_name_, 2, 64);
+  SharedImage old_descriptor;
+  ASSERT_TRUE(writer->write(makeImage(1), &old_descriptor));
+  auto replacement =
+      std::make_unique<SharedImageWriter>(segment_name_, 2, 128);
+  ASSERT_TRUE(replacement->isValid());
+  writer = std::move(replacement);
+
+  SharedImageReader reader;
+  SharedImage descriptor;
+  const sensor_msgs::Image image = makeImage(5, 64);
+  ASSERT_TRUE(writer->write(image, &descriptor));
+  EXPECT_NE(descriptor.segment_id, old_descriptor.segment_id);
+  EXPECT_EQ(reader.read(old_descriptor), nullptr);
+  EXPECT_TRUE(holds(reader.read(descriptor), image));
+}
+
+TEST_F(SharedMemoryImageTest, ReaderRemapsRecreatedSegments) {
+  SharedImageReader reader;
+  SharedImage descriptor;
+  {
+    SharedImageWriter writer(segment_name_, 2, 64);
+    ASSERT_TRUE(writer.write(makeImage(1), &descriptor));
+    EXPECT_TRUE(holds(reader.read(descriptor), makeImage(1)));
+  }
+  // The segment is recreated under the same name with a new id.
+  SharedImageWriter writer(segment_name_, 2, 64);
+  ASSERT_TRUE(writer.write(makeImage(2), &descriptor));
+  EXPECT_TRUE(holds(reader.read(descriptor), makeImage(2)));
+}
+
+}  // namespace
+}  // namespace unreal_airsim
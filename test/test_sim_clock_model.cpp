@@ -0,0 +1,131 @@
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include "unreal_airsim/online_simulator/sim_clock_model.h"
+
+namespace unreal_airsim {
+namespace {
+
+class SimClockModelTest : public ::testing::Test {
+ protected:
+  using WallTime = SimClockModel::WallTime;
+
+  WallTime wall(double seconds) const {
+    return start_ + std::chrono::duration_cast<WallTime::duration>(
+                        std::chrono::duration<double>(seconds));
+  }
+
+  static uint64_t ns(double seconds) {
+    return static_cast<uint64_t>(seconds * 1e9);
+  }
+
+  static double seconds(uint64_t ns) { return static_cast<double>(ns) * 1e-9; }
+
+  const WallTime start_ = std::chrono::steady_clock::now();
+};
+
+TEST_F(SimClockModelTest, ReturnsZeroUntilInitialized) {
+  SimClockModel model;
+  EXPECT_FALSE(model.isInitialized());
+  EXPECT_EQ(model.getSimTime(wall(0.0)), 0u);
+  model.addSample(wall(0.0), ns(100.0));
+  EXPECT_TRUE(model.isInitialized());
+  EXPECT_EQ(model.getSimTime(wall(0.0)), ns(100.0));
+}
+
+TEST_F(SimClockModelTest, FitsClockSpeed) {
+  SimClockModel model;
+  // ClockSpeed 2, sampled every 0.2s.
+  for (int i = 0; i <= 10; ++i) {
+    model.addSample(wall(0.2 * i), ns(100.0 + 0.4 * i));
+  }
+  EXPECT_NEAR(model.getRate(), 2.0, 1e-6);
+  EXPECT_NEAR(seconds(model.getSimTime(wall(2.1))), 104.2, 1e-6);
+  EXPECT_EQ(model.getNumResyncs(), 0u);
+}
+
+TEST_F(SimClockModelTest, StaysMonotonicUnderJitter) {
+  SimClockModel::Config config;
+  config.resync_threshold = 0.01;
+  SimClockModel model(config);
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> jitter(-0.002, 0.002);
+  uint64_t previous = 0;
+  for (int i = 0; i < 5000; ++i) {
+    const double t = 0.002 * i;
+    if (i % 100 == 0) {
+      model.addSample(wall(t + jitter(rng)), ns(50.0 + t));
+    }
+    const uint64_t sim_time = model.getSimTime(wall(t));
+    EXPECT_GE(sim_time, previous);
+    EXPECT_NEAR(seconds(sim_time), 50.0 + t, config.resync_threshold);
+    previous = sim_time;
+  }
+}
+
+TEST_F(SimClockModelTest, HoldsTimeWhilePaused) {
+  SimClockModel model;
+  model.addSample(wall(0.0), ns(10.0));
+  model.addSample(wall(0.2), ns(10.2));
+  model.addSample(wall(0.4), ns(10.2));
+  EXPECT_TRUE(model.isPaused());
+  EXPECT_EQ(model.getRate(), 0.0);
+  EXPECT_EQ(model.getSimTime(wall(0.6)), ns(10.2));
+
+  // Resuming restarts from the new sample with the previous rate.
+  model.addSample(wall(1.0), ns(10.3));
+  EXPECT_FALSE(model.isPaused());
+  EXPECT_NEAR(seconds(model.getSimTime(wall(1.1))), 10.4, 1e-6);
+}
+
+TEST_F(SimClockModelTest, ResyncsOnLargeResiduals) {
+  SimClockModel model;
+  for (int i = 0; i <= 5; ++i) {
+    model.addSample(wall(0.2 * i), ns(20.0 + 0.2 * i));
+  }
+  // The simulator skipped ahead by 0.5s.
+  model.addSample(wall(1.2), ns(21.7));
+  EXPECT_EQ(model.getNumResyncs(), 1u);
+  EXPECT_NEAR(seconds(model.getSimTime(wall(1.3))), 21.8, 1e-6);
+}
+
+TEST_F(SimClockModelTest, OnlyLargeBackwardJumpsGoBackInTime) {
+  SimClockModel model;
+  model.addSample(wall(0.0), ns(30.0));
+  model.addSample(wall(0.2), ns(30.2));
+  EXPECT_EQ(model.getSimTime(wall(0.2)), ns(30.2));
+
+  // A small jump back is held at the last returned time.
+  model.addSample(wall(0.4), ns(30.1));
+  EXPECT_EQ(model.getSimTime(wall(0.4)), ns(30.2));
+
+  // A level reset is passed through.
+  model.addSample(wall(0.6), ns(1.0));
+  EXPECT_EQ(model.getSimTime(wall(0.6)), ns(1.0));
+}
+
+TEST_F(SimClockModelTest, StopsExtrapolatingWhenStale) {
+  SimClockModel::Config config;
+  config.max_extrapolation = 0.5;
+  SimClockModel model(config);
+  model.addSample(wall(0.0), ns(40.0));
+  model.addSample(wall(0.2), ns(40.2));
+  EXPECT_FALSE(model.isStale(wall(0.6)));
+  EXPECT_NEAR(seconds(model.getSimTime(wall(0.6))), 40.6, 1e-6);
+
+  // Held at the end of the extrapolation horizon.
+  EXPECT_TRUE(model.isStale(wall(5.0)));
+  EXPECT_NEAR(seconds(model.getSimTime(wall(5.0))), 40.7, 1e-6);
+  EXPECT_NEAR(seconds(model.getSimTime(wall(9.0))), 40.7, 1e-6);
+
+  // A new sample restarts the clock.
+  model.addSample(wall(10.0), ns(41.0));
+  EXPECT_FALSE(model.isStale(wall(10.1)));
+  EXPECT_NEAR(seconds(model.getSimTime(wall(10.1))), 41.1, 1e-6);
+}
+
+}  // namespace
+}  // namespace unreal_airsim
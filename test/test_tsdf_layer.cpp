@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "unreal_airsim/simulator_processing/ground_truth_map/tsdf_layer.h"
+#include "unreal_airsim/simulator_processing/work_stealing_pool.h"
+
+namespace unreal_airsim {
+namespace {
+
+constexpr int kWidth = 64;
+constexpr int kHeight = 48;
+constexpr float kWallDepth = 2.f;  // m
+
+// Planar wall at kWallDepth with a 90 degree horizontal fov.
+class TsdfLayerTest : public ::testing::Test {
+ protected:
+  TsdfLayerTest() : depth_(kWidth * kHeight, kWallDepth) {
+    frame_.data = depth_.data();
+    frame_.width = kWidth;
+    frame_.height = kHeight;
+    frame_.row_stride = kWidth;
+    frame_.focal_length = kWidth / 2.f;
+    frame_.vx = kWidth / 2.f;
+    frame_.vy = kHeight / 2.f;
+  }
+
+  TsdfLayer::Config config_;
+  std::vector<float> depth_;
+  TsdfLayer::DepthFrame frame_;
+};
+
+TEST_F(TsdfLayerTest, ConfigRejectsTruncationBeyondBlock) {
+  EXPECT_TRUE(config_.isValid());
+  config_.truncation_distance = config_.voxel_size * config_.voxels_per_side;
+  EXPECT_FALSE(config_.isValid());
+  config_.truncation_distance = 0.f;
+  EXPECT_FALSE(config_.isValid());
+}
+
+TEST_F(TsdfLayerTest, IntegratesTruncatedProjectiveDistance) {
+  TsdfLayer layer(config_);
+  layer.integrateDepthFrame(frame_, Eigen::Isometry3f::Identity());
+  ASSERT_GT(layer.getNumberOfBlocks(), 0u);
+
+  // Voxel centers are at odd multiples of half the voxel size.
+  const float half_voxel = 0.5f * config_.voxel_size;
+  const Eigen::Vector3f in_front(half_voxel, half_voxel, 1.925f);
+  const TsdfLayer::Voxel* voxel = layer.getVoxelPtr(in_front);
+  ASSERT_NE(voxel, nullptr);
+  EXPECT_NEAR(voxel->distance, kWallDepth - in_front.z(), 1e-4f);
+  EXPECT_FLOAT_EQ(voxel->weight, 1.f);
+
+  voxel = layer.getVoxelPtr(Eigen::Vector3f(half_voxel, half_voxel, 2.125f));
+  ASSERT_NE(voxel, nullptr);
+  EXPECT_NEAR(voxel->distance, -0.125f, 1e-4f);
+
+  // Free space is truncated, voxels far behind the surface are not updated.
+  voxel = layer.getVoxelPtr(Eigen::Vector3f(half_voxel, half_voxel, 1.625f));
+  ASSERT_NE(voxel, nullptr);
+  EXPECT_FLOAT_EQ(voxel->distance, config_.truncation_distance);
+  voxel = layer.getVoxelPtr(Eigen::Vector3f(half_voxel, half_voxel, 2.375f));
+  ASSERT_NE(voxel, nullptr);
+  EXPECT_FLOAT_EQ(voxel->weight, 0.f);
+
+  // Blocks that do not intersect the truncation band are not allocated.
+  EXPECT_EQ(layer.getVoxelPtr(Eigen::Vector3f(0.f, 0.f, 0.5f)), nullptr);
+}
+
+TEST_F(TsdfLayerTest, AveragesRepeatedObservations) {
+  TsdfLayer layer(config_);
+  const Eigen::Vector3f point(0.025f, 0.025f, 1.975f);
+  layer.integrateDepthFrame(frame_, Eigen::Isometry3f::Identity());
+  std::fill(depth_.begin(), depth_.end(), kWallDepth + 0.1f);
+  layer.integrateDepthFrame(frame_, Eigen::Isometry3f::Identity());
+  const TsdfLayer::Voxel* voxel = layer.getVoxelPtr(point);
+  ASSERT_NE(voxel, nullptr);
+  EXPECT_FLOAT_EQ(voxel->weight, 2.f);
+  EXPECT_NEAR(voxel->distance, 0.5f * (0.025f + 0.125f), 1e-4f);
+}
+
+TEST_F(TsdfLayerTest, ParallelIntegrationMatchesSerial) {
+  simulator_processor::WorkStealingPool pool(4);
+  TsdfLayer parallel(config_, &pool);
+  TsdfLayer serial(config_);
+  for (int i = 0; i < 5; ++i) {
+    Eigen::Isometry3f T_W_C = Eigen::Isometry3f::Identity();
+    T_W_C.translation() = Eigen::Vector3f(0.07f * i, -0.03f * i, 0.02f * i);
+    T_W_C.linear() =
+        Eigen::AngleAxisf(0.05f * i, Eigen::Vector3f::UnitY()).matrix();
+    parallel.integrateDepthFrame(frame_, T_W_C);
+    serial.integrateDepthFrame(frame_, T_W_C);
+  }
+  ASSERT_EQ(parallel.getNumberOfBlocks(), serial.getNumberOfBlocks());
+  int num_observed = 0;
+  for (float x = -2.f; x < 2.f; x += config_.voxel_size) {
+    for (float z = 1.f; z < 3.f; z += config_.voxel_size) {
+      const Eigen::Vector3f point(x, 0.1f, z);
+      const TsdfLayer::Voxel* expected = serial.getVoxelPtr(point);
+      const TsdfLayer::Voxel* voxel = parallel.getVoxelPtr(point);
+      ASSERT_EQ(expected == nullptr, voxel == nullptr);
+      if (!voxel) {
+        continue;
+      }
+      EXPECT_EQ(voxel->distance, expected->distance);
+      EXPECT_EQ(voxel->weight, expected->weight);
+      num_observed += voxel->weight > 0.f;
+    }
+  }
+  EXPECT_GT(num_observed, 0);
+}
+
+}  // namespace
+}  // namespace unreal_airsim
@@ -0,0 +1,126 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "unreal_airsim/simulator_processing/work_stealing_pool.h"
+
+namespace unreal_airsim::simulator_processor {
+namespace {
+
+// Counts down completed tasks, s.t. tests can wait for all of them.
+class Latch {
+ public:
+  explicit Latch(int count) : count_(count) {}
+
+  void countDown() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--count_ == 0) {
+      cv_.notify_all();
+    }
+  }
+
+  bool waitFor(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, timeout, [this]() { return count_ <= 0; });
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  int count_;
+};
+
+constexpr std::chrono::milliseconds kTimeout(5000);
+
+TEST(WorkStealingPoolTest, RunsAllSubmittedTasks) {
+  WorkStealingPool pool(4);
+  EXPECT_EQ(pool.getNumThreads(), 4);
+  constexpr int kNumTasks = 10000;
+  std::atomic<int> num_run{0};
+  Latch latch(kNumTasks);
+  for (int i = 0; i < kNumTasks; ++i) {
+    pool.submit([&]() {
+      num_run++;
+      latch.countDown();
+    });
+  }
+  ASSERT_TRUE(latch.waitFor(kTimeout));
+  EXPECT_EQ(num_run, kNumTasks);
+}
+
+TEST(WorkStealingPoolTest, RunsTasksSubmittedFromWorkers) {
+  // Every task spawns two children up to a depth, the tasks of one worker are
+  // stolen by the others.
+  WorkStealingPool pool(4);
+  constexpr int kDepth = 12;
+  constexpr int kNumTasks = (1 << (kDepth + 1)) - 1;
+  std::atomic<int> num_run{0};
+  Latch latch(kNumTasks);
+  std::function<void(int)> spawn = [&](int depth) {
+    num_run++;
+    if (depth < kDepth) {
+      pool.submit([&, depth]() { spawn(depth + 1); });
+      pool.submit([&, depth]() { spawn(depth + 1); });
+    }
+    latch.countDown();
+  };
+  pool.submit([&]() { spawn(0); });
+  ASSERT_TRUE(latch.waitFor(kTimeout));
+  EXPECT_EQ(num_run, kNumTasks);
+}
+
+TEST(WorkStealingPoolTest, IdleWorkersDoNotSpin) {
+  WorkStealingPool pool(4);
+  Latch latch(100);
+  for (int i = 0; i < 100; ++i) {
+    pool.submit([&]() { latch.countDown(); });
+  }
+  ASSERT_TRUE(latch.waitFor(kTimeout));
+
+  // All workers are idle, the process should hardly use any cpu time.
+  const std::clock_t start = std::clock();
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  const double cpu_time =
+      static_cast<double>(std::clock() - start) / CLOCKS_PER_SEC;
+  EXPECT_LT(cpu_time, 0.05);
+}
+
+TEST(WorkStealingPoolTest, DelayedTasksRunAfterTheirDelay) {
+  WorkStealingPool pool(2);
+  using Clock = WorkStealingPool::Clock;
+  const Clock::time_point start = Clock::now();
+  Clock::time_point first_run, second_run;
+  Latch latch(2);
+  pool.submitAfter(std::chrono::milliseconds(60), [&]() {
+    second_run = Clock::now();
+    latch.countDown();
+  });
+  pool.submitAfter(std::chrono::milliseconds(20), [&]() {
+    first_run = Clock::now();
+    latch.countDown();
+  });
+  ASSERT_TRUE(latch.waitFor(kTimeout));
+  EXPECT_GE(first_run - start, std::chrono::milliseconds(20));
+  EXPECT_GE(second_run - start, std::chrono::milliseconds(60));
+  EXPECT_LT(first_run, second_run);
+}
+
+TEST(WorkStealingPoolTest, DropsPendingDelayedTasksOnDestruction) {
+  std::atomic<bool> has_run{false};
+  const auto start = std::chrono::steady_clock::now();
+  {
+    WorkStealingPool pool(2);
+    pool.submitAfter(std::chrono::seconds(10), [&]() { has_run = true; });
+  }
+  EXPECT_FALSE(has_run);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+}
+
+}  // namespace
+}  // namespace unreal_airsim::simulator_processor